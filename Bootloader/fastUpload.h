@@ -0,0 +1,32 @@
+/* JTS: fast upload protocol (shared with HostTools/fastUpload) */
+/* Only built into the bootloader when FAST_UPLOAD is defined (see Makefile "atmega328" target) */
+
+#ifndef fastUpload_h
+#define fastUpload_h
+
+/*
+ * 1: host sends (at BAUD_RATE, like any STK500 command):
+ *    FAST_UPLOAD_COMMAND, numPages (uint8), CRC (uint16, little endian), CRC_EOP
+ *    CRC is _crc_ccitt_update() (starting at FAST_UPLOAD_CRC_INITIAL_VALUE) over all numPages pages
+ * 2: bootloader replies STK_INSYNC, erases the reset vector page, then switches to FAST_UPLOAD_BAUD_RATE
+ *    host switches to FAST_UPLOAD_BAUD_RATE once it receives STK_INSYNC (so host always sends first at the new rate)
+ * 3: host sends each page (FAST_UPLOAD_PAGE_BYTES bytes, starting at address 0, unused bytes 0xFF)
+ *    bootloader replies FAST_UPLOAD_READY as soon as it starts writing that page, then host sends the next page
+ *    so each page is written while the next page is received
+ * 4: after the last page, bootloader reads back the whole image and checks its CRC
+ *    reset vector page is only written if CRC matches, so firmware doesn't run unless the whole image is valid
+ * 5: bootloader sends STK_OK (CRC matches) or STK_FAILED, then resets
+ *    after STK_FAILED, every reset runs the bootloader (instead of the firmware) until an upload succeeds
+ */
+
+#define FAST_UPLOAD_COMMAND    0x46   // 'F' (not used by STK500)
+#define FAST_UPLOAD_READY      '+'
+#define FAST_UPLOAD_BAUD_RATE  1000000L // 0% error at 16 MHz (U2X) //CH340 supports up to 2 Mbaud
+
+#define FAST_UPLOAD_PAGE_BYTES 128    // ATmega328p SPM_PAGESIZE
+#define FAST_UPLOAD_APP_END    0x7C00 // bootloader start (1024 byte boot section)
+#define FAST_UPLOAD_MAX_PAGES  (FAST_UPLOAD_APP_END / FAST_UPLOAD_PAGE_BYTES)
+
+#define FAST_UPLOAD_CRC_INITIAL_VALUE 0xFFFF
+
+#endif
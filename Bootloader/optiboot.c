@@ -132,6 +132,13 @@
 /**********************************************************/
 /* Edit History:					  */
 /*							  */
+/* 4.6 JTS: fast upload (FAST_UPLOAD, see fastUpload.h):  */
+/*          1 Mbaud, CRC-verified, 1024 byte boot.        */
+/* 4.5 JTS: fast boot; only wait for upload after an      */
+/*          external reset or while button is pressed.    */
+/*          Reset cause is passed to firmware in GPIOR0.  */
+/*          External reset still waits up to 1 s, so      */
+/*          opening the serial port stops MCM outputs.    */
 /* 4.4 WestfW: add initialization of address to keep      */
 /*             the compiler happy.  Change SC'ed targets. */
 /*             Return the SW version via READ PARAM       */
@@ -144,7 +151,7 @@
 /**********************************************************/
 
 #define OPTIBOOT_MAJVER 4
-#define OPTIBOOT_MINVER 4
+#define OPTIBOOT_MINVER 6
 
 #define MAKESTR(a) #a
 #define MAKEVER(a, b) MAKESTR(a*256+b)
@@ -167,6 +174,14 @@ asm("  .section .version\n"
 #include "pin_defs.h"
 #include "stk500.h"
 
+#ifdef FAST_UPLOAD
+#include <util/crc16.h>
+#include "fastUpload.h"
+#if SPM_PAGESIZE != FAST_UPLOAD_PAGE_BYTES
+#error "fastUpload.h page size does not match SPM_PAGESIZE"
+#endif
+#endif
+
 #ifdef LED_START_FLASHES
 #undef LED_START_FLASHES //undefine LED blinking (to make more room)
 #endif
@@ -231,6 +246,10 @@ void watchdogConfig(uint8_t x);
 void uartDelay() __attribute__ ((naked));
 #endif
 void appStart() __attribute__ ((naked));
+#ifdef FAST_UPLOAD
+void fastUpload(uint8_t numPages, uint16_t expectedCRC) __attribute__ ((noreturn));
+void fastUpload_writePage(uint8_t *bufPtr, uint16_t address);
+#endif
 
 #if defined(__AVR_ATmega168__)
 #define RAMSTART (0x100)
@@ -256,6 +275,9 @@ void appStart() __attribute__ ((naked));
 /* These definitions are NOT zero initialised, but that doesn't matter */
 /* This allows us to drop the zero init code, saving us memory */
 #define buff    ((uint8_t*)(RAMSTART))
+#ifdef FAST_UPLOAD
+#define pageZeroBuff ((uint8_t*)(RAMSTART+SPM_PAGESIZE)) // held until image CRC is verified
+#endif
 #ifdef VIRTUAL_BOOT_PARTITION
 #define rstVect (*(uint16_t*)(RAMSTART+SPM_PAGESIZE*2+4))
 #define wdtVect (*(uint16_t*)(RAMSTART+SPM_PAGESIZE*2+6))
@@ -288,16 +310,21 @@ int main(void) {
   SP=RAMEND;  // This is done by hardware reset
 #endif
   
-  // ch = MCUSR;
+  ch = MCUSR;
   MCUSR = 0; //prevent watchdog brownout infinite loop
-  // if (!(ch & _BV(EXTRF))) appStart(); // Adaboot no-wait mod
-
-  // JTS: check push button state //Arduino pin A3 = 328p PINC3 (LOW = pressed)
-  // The button must be pressed to update firmware 
+  GPIOR0 = ch; //JTS: MCUSR is now zero, so pass reset cause to firmware (see hal_resetCause_getAndClear())
+
+  // JTS: fast boot
+  // Only wait for an upload after an external reset (e.g. USB auto-reset), or when the push button is pressed
+  // Power-on, brownout, and watchdog resets (including the one that ends each upload) jump directly to main firmware
+  // External reset still waits up to WATCHDOG_1S (avrdude's first sync can take several hundred ms), so opening the
+  // serial port while driving (which toggles DTR) leaves the MCM outputs undriven for up to ~1 s
+  // Arduino pin A3 = 328p PINC3 (LOW = pressed)
   if ( (PINC & (1<<PINC3)) != 0 )
   { 
-    //button isn't pressed; jump directly to main firmware
-    appStart();
+    //button isn't pressed
+    //an erased reset vector means there's no firmware (e.g. a fast upload failed its CRC check)
+    if ( (ch != _BV(EXTRF)) && (pgm_read_word_near(0) != 0xFFFF) ) appStart();
   }
 
 #if LED_START_FLASHES > 0
@@ -503,6 +530,25 @@ int main(void) {
       watchdogConfig(WATCHDOG_16MS);
       verifySpace();
     }
+#ifdef FAST_UPLOAD
+    else if (ch == FAST_UPLOAD_COMMAND) {
+      // JTS: fast upload (see fastUpload.h)
+      uint8_t numPages = getch();
+      uint16_t expectedCRC = getch();
+      expectedCRC |= getch() << 8;
+
+      // Page count out of range is treated like a bad command (see verifySpace())
+      if ((uint8_t)(numPages - 1) >= FAST_UPLOAD_MAX_PAGES) {
+        watchdogConfig(WATCHDOG_16MS);
+        while (1)
+          ;
+      }
+
+      UCSR0A = _BV(U2X0) | _BV(TXC0); // clear TXC0, so we know when STK_INSYNC has been sent
+      verifySpace();
+      fastUpload(numPages, expectedCRC); // never returns
+    }
+#endif
     else {
       // This covers the response to commands like STK_ENTER_PROGMODE
       verifySpace();
@@ -511,6 +557,89 @@ int main(void) {
   }
 }
 
+#ifdef FAST_UPLOAD
+void fastUpload(uint8_t numPages, uint16_t expectedCRC) {
+  uint8_t *bufPtr;
+  uint16_t address;
+  uint16_t readAddress;
+  uint16_t crc;
+  uint8_t ch;
+  uint8_t length;
+
+  // Firmware won't run until the whole image is verified (see main())
+  __boot_page_erase_short(0);
+
+  // Host switches baud rate once it receives STK_INSYNC
+  while (!(UCSR0A & _BV(TXC0)))
+    ;
+  UBRR0L = (uint8_t)( (F_CPU + FAST_UPLOAD_BAUD_RATE * 4L) / (FAST_UPLOAD_BAUD_RATE * 8L) - 1 );
+
+  address = 0;
+  do {
+    bufPtr = (address == 0) ? pageZeroBuff : buff;
+    length = SPM_PAGESIZE;
+    do *bufPtr++ = getch();
+    while (--length);
+
+    // Reset vector page is written last, after CRC check
+    if (address != 0) fastUpload_writePage(buff, address);
+
+    // Host sends next page while this page is written
+    putch(FAST_UPLOAD_READY);
+
+    address += SPM_PAGESIZE;
+  } while (--numPages);
+
+  boot_spm_busy_wait();
+  boot_rww_enable();
+
+  // Check what was actually written (reset vector page is still in RAM)
+  crc = FAST_UPLOAD_CRC_INITIAL_VALUE;
+  bufPtr = pageZeroBuff;
+  for (readAddress = 0; readAddress < address; readAddress++) {
+    if (readAddress < SPM_PAGESIZE) ch = *bufPtr++;
+    else ch = pgm_read_byte_near(readAddress);
+    crc = _crc_ccitt_update(crc, ch);
+  }
+
+  ch = STK_FAILED;
+  if (crc == expectedCRC) {
+    fastUpload_writePage(pageZeroBuff, 0); // already erased
+    boot_spm_busy_wait();
+    boot_rww_enable();
+    ch = STK_OK;
+  }
+  putch(ch);
+
+  // Reset (runs new firmware if upload succeeded)
+  watchdogConfig(WATCHDOG_16MS);
+  while (1)
+    ;
+}
+
+// Returns as soon as page write starts
+void fastUpload_writePage(uint8_t *bufPtr, uint16_t address) {
+  uint8_t ch;
+
+  boot_spm_busy_wait(); // previous page write
+  if (address != 0) {
+    __boot_page_erase_short((uint16_t)(void*)address);
+    boot_spm_busy_wait();
+  }
+
+  ch = SPM_PAGESIZE / 2;
+  do {
+    uint16_t a;
+    a = *bufPtr++;
+    a |= (*bufPtr++) << 8;
+    __boot_page_fill_short((uint16_t)(void*)address,a);
+    address += 2;
+  } while (--ch);
+
+  __boot_page_write_short((uint16_t)(void*)(address - SPM_PAGESIZE));
+}
+#endif
+
 void putch(char ch) {
 #ifndef SOFT_UART
   while (!(UCSR0A & _BV(UDRE0)));
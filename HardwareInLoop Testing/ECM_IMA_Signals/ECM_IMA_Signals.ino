@@ -1,3 +1,5 @@
+#include "playback.h"
+
 #define USER_INPUT_BUFFER_SIZE 32
 #define STRING_TERMINATION_CHARACTER 0
 
@@ -7,8 +9,68 @@
 #define PIN_MAMODE1_PWM 11
 #define PIN_MAMODE2     12
 
+//LiControl's MCM outputs (measured during playback)
+#define PIN_MCM_CMDPWR    8 //ICP1
+#define PIN_MCM_MAMODE1  A0 //analog comparator (vs 1.1 V bandgap) drives ICP1 when measuring this signal
+#define PIN_MCM_MAMODE2   7 //PCINT23
+
+#define CAPTURE_CMDPWR      0
+#define CAPTURE_MAMODE1     1
+#define CAPTURE_MAMODE2     2 //stored as 0 or 1000 permille, so all outputs compare the same way
+#define CAPTURE_NUM_OUTPUTS 3
+#define CAPTURE_TIMEOUT_TICKS          4 //no edges for this long: duty is 0% or 100%
+#define CAPTURE_CHANGE_PERMILLE       20 //smaller duty changes are measurement jitter
+#define CAPTURE_SETTLED_ms            50 //outputs unchanged this long after a record are reported as settled
+#define CAPTURE_TIMER_COUNTS_PER_TICK 1024 //Timer1 counts at 2 MHz
+
 uint8_t line[USER_INPUT_BUFFER_SIZE]; //Stores user text as it's read from serial buffer
 
+#define PLAYBACK_OFF     0 //text commands
+#define PLAYBACK_LOADING 1 //filling buffer before starting
+#define PLAYBACK_RUNNING 2 //Timer1 ISR applying records
+#define PLAYBACK_DONE    3 //end record applied (or aborted)
+
+//ring buffer: main loop writes records at head, ISR applies them from tail
+uint8_t playbackBuffer[PLAYBACK_BUFFER_RECORDS][PLAYBACK_RECORD_BYTES];
+volatile uint8_t playbackHead = 0; //free running (indices are masked)
+volatile uint8_t playbackTail = 0;
+volatile uint8_t playbackState = PLAYBACK_OFF;
+
+//written by ISR
+volatile uint16_t ticksSinceApplied = 0;
+volatile uint16_t numUnderruns = 0; //records applied late because they weren't received in time
+volatile uint16_t worstLate_ticks = 0;
+volatile uint32_t numRecordsApplied = 0;
+volatile uint32_t numTicks = 0; //Timer1 overflows during playback
+volatile uint32_t recordApplied_halfus = 0;
+
+//written by capture ISRs //times are Timer1 counts (0.5 us), see captureTime_halfus()
+volatile uint8_t  captureSource = CAPTURE_CMDPWR; //ICP1 alternates between signals after each complete PWM period
+volatile uint8_t  captureNumEdges = 0;
+volatile uint32_t captureRise_halfus = 0;
+volatile uint32_t captureFall_halfus = 0;
+volatile uint8_t  ticksSinceCaptureEdge = 0;
+volatile uint16_t measuredDuty_permille[CAPTURE_NUM_OUTPUTS];
+volatile uint32_t measuredAt_halfus[CAPTURE_NUM_OUTPUTS]; //start of measured PWM period (or MAMODE2 edge)
+
+//only used by main loop
+uint8_t receivedRecord[PLAYBACK_RECORD_BYTES];
+uint8_t numRecordBytes = 0;
+uint8_t numRecordsCredited = 0; //free running, compared to playbackTail
+bool isEndReceived = false;
+uint32_t latestByte_ms = 0; //or latest time the ring held records (host has no credit then, so it can't send)
+uint16_t numReportsDropped = 0; //serial TX buffer was full
+
+//response to latest record (only used by main loop)
+struct outputMeasurement { uint16_t duty_permille[CAPTURE_NUM_OUTPUTS]; uint32_t at_halfus[CAPTURE_NUM_OUTPUTS]; };
+bool isResponseTracked = false;
+uint32_t trackedRecord = 0; //numRecordsApplied when tracking started
+uint32_t trackedRecord_halfus = 0;
+outputMeasurement latestOutputs;
+uint32_t latestChange_halfus = 0;
+bool isResponseSeen = false;
+uint32_t response_halfus = 0;
+
 //////////////////////////////////////////////////////////////////////////////////
 
 void setup()
@@ -30,6 +92,359 @@ void setup()
 
 //////////////////////////////////////////////////////////////////////////////////
 
+//Timer1 time of a captured count //interrupts must be disabled
+uint32_t captureTime_halfus(uint16_t counts)
+{
+  uint32_t ticks = numTicks;
+  if( (TIFR1 & (1 << TOV1)) && (counts < (CAPTURE_TIMER_COUNTS_PER_TICK / 2)) ) { ticks++; } //overflow ISR hasn't run yet
+
+  return (ticks * CAPTURE_TIMER_COUNTS_PER_TICK) + counts;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//ICP1 is either the CMDPWR pin, or the analog comparator output (which is low when MAMODE1 is high)
+void capture_selectSource(uint8_t source)
+{
+  captureSource = source;
+  captureNumEdges = 0;
+  ticksSinceCaptureEdge = 0;
+
+  if(source == CAPTURE_MAMODE1) { ACSR |=  (1 << ACIC); TCCR1B &= ~(1 << ICES1); } //first edge is MAMODE1 rising (comparator falling)
+  else                          { ACSR &= ~(1 << ACIC); TCCR1B |=  (1 << ICES1); } //first edge is CMDPWR rising
+
+  TIFR1 = (1 << ICF1); //changing source or edge can flag a capture
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//measures one PWM period (rising, falling, rising), then switches to the other signal
+//LiControl's MAMODE1 is only high for ~5 us at prestart/assist (31.4 kHz), so the opposite edge is armed before any math
+ISR(TIMER1_CAPT_vect)
+{
+  uint16_t edge_counts = ICR1;
+  uint8_t edgeSelect = TCCR1B ^ (1 << ICES1);
+  TCCR1B = edgeSelect; //capture opposite edge next
+  TIFR1 = (1 << ICF1);
+
+  uint32_t edge_halfus = captureTime_halfus(edge_counts);
+  bool isComparatorRising = !(edgeSelect & (1 << ICES1)); //edge just captured
+  bool isSignalRising = (captureSource == CAPTURE_MAMODE1) ? !isComparatorRising : isComparatorRising;
+
+  ticksSinceCaptureEdge = 0;
+
+  if(isSignalRising == false)        { if(captureNumEdges == 1) { captureFall_halfus = edge_halfus; captureNumEdges = 2; } }
+  else if(captureNumEdges != 2)      { captureRise_halfus = edge_halfus; captureNumEdges = 1; }
+  else
+  {
+    uint32_t period_halfus = edge_halfus - captureRise_halfus;
+    measuredDuty_permille[captureSource] = (uint16_t)( (captureFall_halfus - captureRise_halfus) * 1000 / period_halfus );
+    measuredAt_halfus[captureSource] = captureRise_halfus;
+    capture_selectSource( (captureSource == CAPTURE_CMDPWR) ? CAPTURE_MAMODE1 : CAPTURE_CMDPWR );
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//called from Timer1 overflow ISR
+void capture_checkTimeout(void)
+{
+  if(++ticksSinceCaptureEdge < CAPTURE_TIMEOUT_TICKS) { return; }
+
+  //signal is static
+  bool isHigh;
+  if(captureSource == CAPTURE_MAMODE1) { isHigh = !(ACSR & (1 << ACO)); }
+  else                                 { isHigh = digitalRead(PIN_MCM_CMDPWR); }
+
+  measuredDuty_permille[captureSource] = isHigh ? 1000 : 0;
+  measuredAt_halfus[captureSource] = numTicks * CAPTURE_TIMER_COUNTS_PER_TICK;
+  capture_selectSource( (captureSource == CAPTURE_CMDPWR) ? CAPTURE_MAMODE1 : CAPTURE_CMDPWR );
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+ISR(PCINT2_vect)
+{
+  uint16_t duty_permille = digitalRead(PIN_MCM_MAMODE2) ? 1000 : 0;
+  if(duty_permille == measuredDuty_permille[CAPTURE_MAMODE2]) { return; } //another PORTD pin
+
+  measuredDuty_permille[CAPTURE_MAMODE2] = duty_permille;
+  measuredAt_halfus[CAPTURE_MAMODE2] = captureTime_halfus(TCNT1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//configures pins & analog comparator for measuring LiControl's outputs
+void capture_begin(void)
+{
+  pinMode(PIN_MCM_CMDPWR, INPUT);
+  pinMode(PIN_MCM_MAMODE2, INPUT);
+
+  //analog comparator: bandgap (+) vs MAMODE1 (-) //ADC must be off for comparator to use ADC mux
+  ADCSRA &= ~(1 << ADEN);
+  ADCSRB |= (1 << ACME);
+  ADMUX = (PIN_MCM_MAMODE1 - A0); //MUX bits
+  DIDR0 |= (1 << (PIN_MCM_MAMODE1 - A0));
+  ACSR = (1 << ACBG);
+
+  PCMSK2 |= (1 << PCINT23);
+  PCICR |= (1 << PCIE2);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//run with Timer1 interrupts off
+void capture_start(void)
+{
+  numTicks = 0;
+
+  for(uint8_t ii = 0; ii < CAPTURE_NUM_OUTPUTS; ii++) { measuredDuty_permille[ii] = 0; measuredAt_halfus[ii] = 0; }
+  measuredDuty_permille[CAPTURE_MAMODE2] = digitalRead(PIN_MCM_MAMODE2) ? 1000 : 0;
+
+  capture_selectSource(CAPTURE_CMDPWR);
+  isResponseTracked = false;
+  trackedRecord = 0;
+  numReportsDropped = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+outputMeasurement capture_getOutputs(void)
+{
+  outputMeasurement outputs;
+
+  cli();
+  for(uint8_t ii = 0; ii < CAPTURE_NUM_OUTPUTS; ii++)
+  {
+    outputs.duty_permille[ii] = measuredDuty_permille[ii];
+    outputs.at_halfus[ii] = measuredAt_halfus[ii];
+  }
+  sei();
+
+  return outputs;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//returns true if any output changed by more than measurement jitter //changed_halfus is when the earliest of those changes was measured
+bool capture_isChanged(const outputMeasurement &latest, const outputMeasurement &previous, uint32_t &changed_halfus)
+{
+  bool isChanged = false;
+
+  for(uint8_t ii = 0; ii < CAPTURE_NUM_OUTPUTS; ii++)
+  {
+    int16_t change = (int16_t)latest.duty_permille[ii] - (int16_t)previous.duty_permille[ii];
+    if( (change <= CAPTURE_CHANGE_PERMILLE) && (change >= -CAPTURE_CHANGE_PERMILLE) ) { continue; }
+
+    if( (isChanged == false) || ((int32_t)(latest.at_halfus[ii] - changed_halfus) < 0) ) { changed_halfus = latest.at_halfus[ii]; }
+    isChanged = true;
+  }
+
+  return isChanged;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//only sent when it fits in serial TX buffer, so reporting never delays playback
+void capture_report(bool isSettled)
+{
+  char report[48];
+  char latency[12] = "-";
+
+  if(isResponseSeen == true) { ultoa((response_halfus - trackedRecord_halfus) / 2, latency, 10); }
+
+  snprintf_P(report, sizeof(report), PSTR("\n" PLAYBACK_RESPONSE_PREFIX "%lu,%s,%u,%u,%u,%u"), trackedRecord - 1, latency,
+    latestOutputs.duty_permille[CAPTURE_CMDPWR], latestOutputs.duty_permille[CAPTURE_MAMODE1], (latestOutputs.duty_permille[CAPTURE_MAMODE2] != 0), isSettled);
+
+  if(Serial.availableForWrite() >= (int)strlen(report)) { Serial.print(report); }
+  else if(numReportsDropped < UINT16_MAX)               { numReportsDropped++;  }
+
+  isResponseTracked = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//tracks LiControl's response to the latest record applied
+void capture_handler(void)
+{
+  cli();
+  uint32_t record = numRecordsApplied;
+  uint32_t record_halfus = recordApplied_halfus;
+  uint32_t now_halfus = numTicks * CAPTURE_TIMER_COUNTS_PER_TICK;
+  sei();
+
+  outputMeasurement outputs = capture_getOutputs();
+
+  if(record != trackedRecord)
+  {
+    if(isResponseTracked == true) { capture_report(false); } //next record applied before outputs settled
+
+    //outputs measured before this record was applied are the baseline
+    trackedRecord = record;
+    trackedRecord_halfus = record_halfus;
+    latestOutputs = outputs;
+    latestChange_halfus = record_halfus;
+    isResponseSeen = false;
+    isResponseTracked = true;
+  }
+
+  if(isResponseTracked == false) { return; } //already reported
+
+  uint32_t changed_halfus;
+  if( capture_isChanged(outputs, latestOutputs, changed_halfus) && ((int32_t)(changed_halfus - record_halfus) >= 0) )
+  {
+    if(isResponseSeen == false) { response_halfus = changed_halfus; isResponseSeen = true; }
+    latestOutputs = outputs;
+    latestChange_halfus = changed_halfus;
+  }
+
+  if( (now_halfus - latestChange_halfus) > (CAPTURE_SETTLED_ms * 2000UL) ) { capture_report(true); }
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//runs once per CMDPWR PWM period (PLAYBACK_TICK_us)
+ISR(TIMER1_OVF_vect)
+{
+  if(playbackState != PLAYBACK_RUNNING) { return; }
+
+  numTicks++;
+  if(ticksSinceApplied < UINT16_MAX) { ticksSinceApplied++; }
+  capture_checkTimeout();
+
+  while(playbackTail != playbackHead) //records with zero delay are applied together
+  {
+    const uint8_t *record = playbackBuffer[playbackTail & (PLAYBACK_BUFFER_RECORDS - 1)];
+    uint16_t delay_ticks = record[0] | (record[1] << 8);
+    uint16_t cmdpwr_flags = record[2] | (record[3] << 8);
+
+    if(ticksSinceApplied < delay_ticks) { return; } //not due yet
+
+    if(ticksSinceApplied > delay_ticks)
+    {
+      //record arrived after it was due
+      numUnderruns++;
+      if( (ticksSinceApplied - delay_ticks) > worstLate_ticks ) { worstLate_ticks = ticksSinceApplied - delay_ticks; }
+    }
+
+    //analogWrite() is too slow for an ISR, and its PWM connection is already made (see playback_start())
+    OCR1B = cmdpwr_flags & PLAYBACK_CMDPWR_MASK; //PIN_CMDPWR_PWM
+    OCR2A = record[4]; //PIN_MAMODE1_PWM
+    if(cmdpwr_flags & PLAYBACK_FLAG_MAMODE2) { PORTB |=  (1 << PORTB4); } //PIN_MAMODE2
+    else                                     { PORTB &= ~(1 << PORTB4); }
+
+    playbackTail++;
+    numRecordsApplied++;
+    recordApplied_halfus = numTicks * CAPTURE_TIMER_COUNTS_PER_TICK; //TCNT1 is ~0 (overflow just occurred)
+    ticksSinceApplied = 0;
+
+    if(cmdpwr_flags & PLAYBACK_FLAG_END) { playbackState = PLAYBACK_DONE; return; }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+void playback_start(void)
+{
+  capture_begin();
+  capture_start();
+
+  //connect PWM to pins (ISR only writes OCR registers)
+  analogWrite(PIN_CMDPWR_PWM, 511); //10b counter
+  analogWrite(PIN_MAMODE1_PWM, 127); //8b counter
+  digitalWrite(PIN_MAMODE2, HIGH);
+
+  playbackHead = 0;
+  playbackTail = 0;
+  numUnderruns = 0;
+  worstLate_ticks = 0;
+  numRecordsApplied = 0;
+  numRecordBytes = 0;
+  numRecordsCredited = 0;
+  isEndReceived = false;
+
+  //host waits for ready text before sending records, so anything already received is a line ending (e.g. '\n' after '\r')
+  delay(10);
+  while(Serial.available()) { Serial.read(); }
+
+  latestByte_ms = millis();
+  playbackState = PLAYBACK_LOADING;
+
+  Serial.print(F(PLAYBACK_READY_TEXT));
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//ISR is stopped before this is called
+void playback_printReport(bool isAborted)
+{
+  Serial.print(F(PLAYBACK_DONE_TEXT));
+  if(isAborted == true) { Serial.print(F(" (aborted: no data)")); }
+  Serial.print(F(": records: "));
+  Serial.print(numRecordsApplied);
+  Serial.print(F(", underruns: "));
+  Serial.print(numUnderruns);
+  Serial.print(F(", worst late (us): "));
+  Serial.print((uint32_t)worstLate_ticks * PLAYBACK_TICK_us);
+  Serial.print(F(", responses dropped: "));
+  Serial.print(numReportsDropped);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+//moves binary records from serial buffer into ring buffer, and grants host more records as ISR frees space
+void playback_handler(void)
+{
+  //start once buffer is full (host has no more credit), or entire stream fits in buffer
+  if( (playbackState == PLAYBACK_LOADING) &&
+      ( ((uint8_t)(playbackHead - playbackTail) == PLAYBACK_BUFFER_RECORDS) || (isEndReceived == true) ) )
+  {
+    ticksSinceApplied = 0;
+    playbackState = PLAYBACK_RUNNING;
+    TIMSK1 |= (1 << TOIE1) | (1 << ICIE1);
+  }
+
+  while( (Serial.available()) && (isEndReceived == false) )
+  {
+    receivedRecord[numRecordBytes++] = Serial.read();
+    latestByte_ms = millis();
+
+    if(numRecordBytes == PLAYBACK_RECORD_BYTES)
+    {
+      //host never sends more records than there's space for
+      memcpy(playbackBuffer[playbackHead & (PLAYBACK_BUFFER_RECORDS - 1)], receivedRecord, PLAYBACK_RECORD_BYTES);
+      playbackHead++; //ISR can now apply record
+      numRecordBytes = 0;
+
+      if(receivedRecord[3] & (PLAYBACK_FLAG_END >> 8)) { isEndReceived = true; }
+    }
+  }
+
+  //grant host more records as ISR frees space
+  if(playbackState == PLAYBACK_RUNNING) { capture_handler(); }
+
+  if( (uint8_t)(playbackTail - numRecordsCredited) >= PLAYBACK_CREDIT_RECORDS )
+  {
+    Serial.write(PLAYBACK_CREDIT_CHARACTER);
+    numRecordsCredited += PLAYBACK_CREDIT_RECORDS;
+  }
+
+  //a full ring can take much longer than PLAYBACK_TIMEOUT_ms to apply (e.g. long holds), so only time out once it runs dry
+  if( (playbackState == PLAYBACK_RUNNING) && (playbackTail != playbackHead) ) { latestByte_ms = millis(); }
+
+  bool isAborted = ( (isEndReceived == false) && ((millis() - latestByte_ms) > PLAYBACK_TIMEOUT_ms) );
+
+  if( (playbackState == PLAYBACK_DONE) || (isAborted == true) )
+  {
+    TIMSK1 &= ~( (1 << TOIE1) | (1 << ICIE1) );
+    if(isResponseTracked == true) { capture_report(false); } //last record
+    playback_printReport(isAborted);
+    playbackState = PLAYBACK_OFF; //outputs hold last record's values
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
 void printStringStoredInArray(const uint8_t *s)
 {
   while (*s) { Serial.write(*s++); } //write each character until '0' (EOL character)
@@ -73,6 +488,9 @@ void USB_userInterface_executeUserInput(void)
       digitalWrite(PIN_MAMODE2, HIGH);
       Serial.print("\nIMA idle");
     }
+
+    //'$P' //stream binary records (see playback.h)
+    else if(line[1] == 'P') { playback_start(); }
     
     //'$Axxx' or '$Rxxx'//assist or regen in percent
     else if( (line[1] == 'A') || (line[1] == 'R') )
@@ -113,7 +531,7 @@ void USB_userInterface_handler(void)
   static uint8_t numCharactersReceived = 0; //char_counter
   static uint8_t inputFlags = 0; //stores state as input text is processed (e.g. whether inside a comment or not)
 
-  while( Serial.available() )
+  while( Serial.available() && (playbackState == PLAYBACK_OFF) ) //'$P' switches to binary records
   {
     //user-typed characters are waiting in serial buffer
 
@@ -158,5 +576,6 @@ void USB_userInterface_handler(void)
 
 void loop()
 {
-  USB_userInterface_handler();
+  if(playbackState == PLAYBACK_OFF) { USB_userInterface_handler(); }
+  else                              { playback_handler();          }
 }
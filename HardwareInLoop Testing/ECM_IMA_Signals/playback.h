@@ -0,0 +1,36 @@
+//'$P' streaming playback format (shared with HostTools/hilPlayback)
+
+#ifndef playback_h
+  #define playback_h
+
+  //after '$P', host sends binary records (little endian) until a record with PLAYBACK_FLAG_END:
+  //[delay_ticks (uint16)][CMDPWR_counts (10b) | flags (uint16)][MAMODE1_counts (uint8)]
+  //each record is applied delay_ticks after the previous record (the first record's delay starts when playback starts)
+  #define PLAYBACK_RECORD_BYTES 5
+  #define PLAYBACK_TICK_us    512 //Timer1 overflow (10b fast PWM, clk/8) //outputs can only change once per PWM period anyway
+  #define PLAYBACK_CMDPWR_MASK  0x03FF
+  #define PLAYBACK_FLAG_MAMODE2 0x8000 //MAMODE2 high (regen/standby)
+  #define PLAYBACK_FLAG_END     0x4000 //last record (its outputs are still applied)
+
+  //flow control: host may initially send PLAYBACK_BUFFER_RECORDS records...
+  //...then PLAYBACK_CREDIT_RECORDS more each time it receives PLAYBACK_CREDIT_CHARACTER
+  #define PLAYBACK_BUFFER_RECORDS  128 //must be a power of two
+  #define PLAYBACK_CREDIT_RECORDS   16
+  #define PLAYBACK_CREDIT_CHARACTER '+'
+
+  //playback aborts if the end record hasn't arrived, and the host sent nothing for this long while loading, or since the buffer ran dry
+  //host waits this long (plus the duration of every record it's sent that hasn't been credited yet) for each credit
+  #define PLAYBACK_TIMEOUT_ms 2000
+
+  //during playback, generator also measures LiControl's MCM outputs, and sends one line per response:
+  //"#R,<record>,<latency_us>,<CMDPWR_permille>,<MAMODE1_permille>,<MAMODE2>,<isSettled>"
+  //record: index (from 0) of the record that caused the response
+  //latency_us: from record applied to the start of the first PWM period that changed ('-' if outputs didn't change)
+  //CMDPWR/MAMODE1 duty and MAMODE2 level: after outputs stopped changing (or when next record was applied, if isSettled is 0)
+  #define PLAYBACK_RESPONSE_PREFIX "#R,"
+
+  //sent when playback is ready for records, and after it ends
+  #define PLAYBACK_READY_TEXT "\nPlayback ready"
+  #define PLAYBACK_DONE_TEXT  "\nPlayback done"
+
+#endif
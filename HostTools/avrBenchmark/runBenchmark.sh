@@ -0,0 +1,38 @@
+#!/bin/bash
+#Copyright 2022-2023(c) John Sullivan
+
+#builds the firmware with RUN_BENCHMARKS, runs it under simavr, and writes the cycle count report to <outputDir>/avrBenchmark.csv
+#usage: runBenchmark.sh <arduino-cli> <simavr> <outputDir> [baseline.csv]
+#with a baseline, each function's mean cycle count is also compared against that earlier report
+
+set -e -o pipefail
+
+ARDUINO_CLI="$1"
+SIMAVR="$2"
+OUTPUT_DIR="$3"
+BASELINE="$4"
+SKETCH_DIR="$(cd "$(dirname "$0")/../../muddersMIMA_firmware" && pwd)"
+
+mkdir -p "$OUTPUT_DIR"
+
+"$ARDUINO_CLI" compile --fqbn arduino:avr:nano \
+	--build-property "compiler.cpp.extra_flags=-DRUN_BENCHMARKS" \
+	--output-dir "$OUTPUT_DIR" "$SKETCH_DIR"
+
+#simavr logs UART output on stderr, and exits once hal_halt() sleeps with interrupts disabled
+timeout 300 "$SIMAVR" -m atmega328p -f 16000000 "$OUTPUT_DIR/muddersMIMA_firmware.ino.elf" 2>&1 \
+	| sed 's/\x1b\[[0-9;]*m//g' > "$OUTPUT_DIR/simavr.log" || true
+
+awk '/#BENCHMARK_END/ { found = 1; exit } inReport { print } /#BENCHMARK_START/ { inReport = 1 } END { exit !found }' \
+	"$OUTPUT_DIR/simavr.log" > "$OUTPUT_DIR/avrBenchmark.csv" \
+	|| { echo "error: no complete benchmark report (see $OUTPUT_DIR/simavr.log)"; exit 1; }
+
+cat "$OUTPUT_DIR/avrBenchmark.csv"
+
+if [ -n "$BASELINE" ]; then
+	echo
+	echo "mean cycles: baseline -> now"
+	awk -F, 'NR == FNR { if(FNR > 1) { baseline[$1] = $5 }; next }
+		FNR > 1 && ($1 in baseline) { printf "%-42s %8d -> %8d (%+d)\n", $1, baseline[$1], $5, $5 - baseline[$1] }' \
+		"$BASELINE" "$OUTPUT_DIR/avrBenchmark.csv"
+fi
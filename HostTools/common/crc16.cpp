@@ -0,0 +1,16 @@
+//Copyright 2022-2023(c) John Sullivan
+
+#include "crc16.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t crc_ccitt_update(uint16_t crc, uint8_t data)
+{
+	crc ^= data;
+	for(uint8_t ii = 0; ii < 8; ii++)
+	{
+		if(crc & 0x0001) { crc = (crc >> 1) ^ 0x8408; }
+		else             { crc = (crc >> 1);          }
+	}
+	return crc;
+}
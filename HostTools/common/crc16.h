@@ -0,0 +1,13 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//CRC16 used by the firmware and bootloader (binary telemetry, image check, fast upload)
+
+#ifndef crc16_h
+	#define crc16_h
+
+	#include <stdint.h>
+
+	uint16_t crc_ccitt_update(uint16_t crc, uint8_t data); //identical to avr-libc's _crc_ccitt_update()
+
+#endif
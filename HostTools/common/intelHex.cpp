@@ -0,0 +1,103 @@
+//Copyright 2022-2023(c) John Sullivan
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intelHex.h"
+
+#define HEX_BYTES_PER_RECORD 16
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t intelHex_byte(const char *text)
+{
+	char digits[3] = { text[0], text[1], 0 };
+	return (uint8_t)strtoul(digits, NULL, 16);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool intelHex_load(const char *path, std::vector<uint8_t> &image, uint32_t endAddress, const char *endAddressName)
+{
+	FILE *file = fopen(path, "r");
+	if(file == NULL) { fprintf(stderr, "can't open %s\n", path); return false; }
+
+	char line[600];
+	uint32_t lineNumber = 0;
+	uint32_t addressOffset = 0; //from extended address records
+	bool isEndOfFile = false;
+
+	while( (isEndOfFile == false) && (fgets(line, sizeof(line), file) != NULL) )
+	{
+		lineNumber++;
+		size_t length = strcspn(line, "\r\n");
+		if(length == 0) { continue; }
+
+		if( (line[0] != ':') || (length < 11) || ((length % 2) == 0) ) { fprintf(stderr, "%s:%u: not an Intel HEX record\n", path, lineNumber); fclose(file); return false; }
+
+		std::vector<uint8_t> bytes;
+		uint8_t checksum = 0;
+		for(size_t ii = 1; ii < length; ii += 2) { bytes.push_back(intelHex_byte(&line[ii])); checksum += bytes.back(); }
+
+		uint8_t numDataBytes = bytes[0];
+		if( (checksum != 0) || (bytes.size() != (size_t)numDataBytes + 5) ) { fprintf(stderr, "%s:%u: bad record checksum or length\n", path, lineNumber); fclose(file); return false; }
+
+		uint32_t address = addressOffset + ((bytes[1] << 8) | bytes[2]);
+		const uint8_t *data = &bytes[4];
+
+		switch(bytes[3])
+		{
+			case 0x00: //data
+				if(address + numDataBytes > endAddress)
+				{
+					fprintf(stderr, "%s:%u: data at 0x%04X overlaps %s (data must end below 0x%04X)\n", path, lineNumber, address, endAddressName, endAddress);
+					fclose(file);
+					return false;
+				}
+				if(image.size() < address + numDataBytes) { image.resize(address + numDataBytes, 0xFF); }
+				memcpy(&image[address], data, numDataBytes);
+				break;
+
+			case 0x01: isEndOfFile = true; break;
+			case 0x02: addressOffset = ((data[0] << 8) | data[1]) << 4;  break; //extended segment address
+			case 0x04: addressOffset = ((data[0] << 8) | data[1]) << 16; break; //extended linear address
+			default: break; //start address records don't matter
+		}
+	}
+	fclose(file);
+
+	if(image.empty()) { fprintf(stderr, "%s: no data\n", path); return false; }
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void intelHex_writeRecord(FILE *file, uint16_t address, uint8_t recordType, const uint8_t *data, uint8_t numBytes)
+{
+	uint8_t checksum = numBytes + (address >> 8) + (address & 0xFF) + recordType;
+
+	fprintf(file, ":%02X%04X%02X", numBytes, address, recordType);
+	for(uint8_t ii = 0; ii < numBytes; ii++) { fprintf(file, "%02X", data[ii]); checksum += data[ii]; }
+	fprintf(file, "%02X\n", (uint8_t)(0x100 - checksum));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool intelHex_save(const char *path, const std::vector<uint8_t> &image)
+{
+	FILE *file = fopen(path, "w");
+	if(file == NULL) { fprintf(stderr, "can't open %s\n", path); return false; }
+
+	for(size_t address = 0; address < image.size(); address += HEX_BYTES_PER_RECORD)
+	{
+		size_t numBytes = image.size() - address;
+		if(numBytes > HEX_BYTES_PER_RECORD) { numBytes = HEX_BYTES_PER_RECORD; }
+		intelHex_writeRecord(file, (uint16_t)address, 0x00, &image[address], (uint8_t)numBytes);
+	}
+	intelHex_writeRecord(file, 0, 0x01, NULL, 0);
+
+	fclose(file);
+	return true;
+}
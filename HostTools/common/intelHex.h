@@ -0,0 +1,20 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Intel HEX files (avr-gcc/Arduino firmware images)
+
+#ifndef intelHex_h
+	#define intelHex_h
+
+	#include <stdint.h>
+	#include <vector>
+
+	//reads an Intel HEX file into image (gaps are 0xFF)
+	//data ending above endAddress is rejected (endAddressName is printed in the error, e.g. "the bootloader")
+	//returns false (after printing why) if the file can't be read, is malformed, or has no data
+	bool intelHex_load(const char *path, std::vector<uint8_t> &image, uint32_t endAddress, const char *endAddressName);
+
+	//writes image as 16 byte data records, starting at address 0
+	bool intelHex_save(const char *path, const std::vector<uint8_t> &image);
+
+#endif
@@ -0,0 +1,223 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//uploads firmware using the bootloader's fast upload protocol (Bootloader/fastUpload.h)
+//usage: fastUpload <firmware.hex> [<serial port>] [--bad-crc]
+//without a serial port, only checks the image (and estimates upload time)
+//--bad-crc: sends the wrong CRC, to test that the bootloader rejects the image (firmware then won't run until an upload succeeds)
+//opening the port resets LiControl (USB auto-reset), so the bootloader waits for an upload without the button being pressed
+//returns 1 if the image is invalid, or the upload fails
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+
+#include "crc16.h"
+#include "intelHex.h"
+#include "../../Bootloader/stk500.h"
+#include "../../Bootloader/fastUpload.h"
+
+#define STK500_BAUD_RATE 115200
+
+#define SYNC_TIMEOUT_ms  1000 //bootloader only waits this long after reset (watchdog)
+#define SYNC_INTERVAL_ms   50
+#define PAGE_TIMEOUT_ms   100 //bootloader replies once page write starts (erase & previous write take ~9 ms)
+#define RESULT_TIMEOUT_ms 500 //bootloader reads back the whole image before replying
+
+//page erase & write each take up to 4.5 ms (ATmega328p datasheet: tWD_FLASH)
+#define FLASH_ERASE_us 4500
+#define FLASH_WRITE_us 4500
+#define BITS_PER_BYTE    10   //8N1
+
+//per page, avrdude sends: load address (4), program page (4 + page + 1), load address (4), read page (5) //replies: 2 + 2 + 2 + (page + 2)
+#define STK500_BYTES_PER_PAGE (4 + 4 + FAST_UPLOAD_PAGE_BYTES + 1 + 4 + 5 + 2 + 2 + 2 + FAST_UPLOAD_PAGE_BYTES + 2)
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool configureSerialPort(int fileDescriptor, speed_t baudRate)
+{
+	struct termios settings;
+
+	if(tcgetattr(fileDescriptor, &settings) != 0) { return false; }
+
+	cfmakeraw(&settings);
+	cfsetispeed(&settings, baudRate);
+	cfsetospeed(&settings, baudRate);
+	settings.c_cc[VMIN]  = 0;
+	settings.c_cc[VTIME] = 0;
+
+	return (tcsetattr(fileDescriptor, TCSADRAIN, &settings) == 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns -1 on timeout
+int receiveByte(int fileDescriptor, uint32_t timeout_ms)
+{
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET(fileDescriptor, &readSet);
+	struct timeval timeout = { (time_t)(timeout_ms / 1000), (suseconds_t)((timeout_ms % 1000) * 1000) };
+
+	if(select(fileDescriptor + 1, &readSet, NULL, NULL, &timeout) <= 0) { return -1; }
+
+	uint8_t data;
+	if(read(fileDescriptor, &data, 1) != 1) { return -1; }
+
+	return data;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool sendBytes(int fileDescriptor, const uint8_t *bytes, size_t numBytes)
+{
+	if(write(fileDescriptor, bytes, numBytes) != (ssize_t)numBytes) { perror("write"); return false; }
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t elapsed_ms(const struct timeval &start)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (uint32_t)((now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//repeats STK_GET_SYNC until bootloader replies (like avrdude)
+bool syncBootloader(int fileDescriptor)
+{
+	const uint8_t getSync[] = { STK_GET_SYNC, CRC_EOP };
+	struct timeval start;
+	gettimeofday(&start, NULL);
+
+	while(elapsed_ms(start) < SYNC_TIMEOUT_ms)
+	{
+		if(sendBytes(fileDescriptor, getSync, sizeof(getSync)) == false) { return false; }
+
+		if( (receiveByte(fileDescriptor, SYNC_INTERVAL_ms) == STK_INSYNC) && (receiveByte(fileDescriptor, SYNC_INTERVAL_ms) == STK_OK) )
+		{
+			tcflush(fileDescriptor, TCIFLUSH); //replies to earlier attempts
+			return true;
+		}
+	}
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool upload(const char *port, const std::vector<uint8_t> &image, uint16_t crc)
+{
+#ifndef B1000000
+	fprintf(stderr, "this OS doesn't support %ld baud\n", FAST_UPLOAD_BAUD_RATE);
+	return false;
+#else
+	#if FAST_UPLOAD_BAUD_RATE != 1000000L
+		#error "update termios baud rate to match FAST_UPLOAD_BAUD_RATE"
+	#endif
+
+	int fileDescriptor = open(port, O_RDWR | O_NOCTTY);
+	if(fileDescriptor < 0) { perror(port); return false; }
+	if(configureSerialPort(fileDescriptor, B115200) == false) { fprintf(stderr, "%s: not a serial port\n", port); close(fileDescriptor); return false; }
+
+	struct timeval start;
+	gettimeofday(&start, NULL);
+
+	if(syncBootloader(fileDescriptor) == false) { fprintf(stderr, "%s: no reply from bootloader (try holding the button down)\n", port); close(fileDescriptor); return false; }
+
+	size_t numPages = image.size() / FAST_UPLOAD_PAGE_BYTES;
+	const uint8_t command[] = { FAST_UPLOAD_COMMAND, (uint8_t)numPages, (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8), CRC_EOP };
+	if(sendBytes(fileDescriptor, command, sizeof(command)) == false) { close(fileDescriptor); return false; }
+
+	if(receiveByte(fileDescriptor, SYNC_INTERVAL_ms) != STK_INSYNC)
+	{
+		fprintf(stderr, "%s: bootloader doesn't support fast upload (use avrdude instead)\n", port);
+		close(fileDescriptor);
+		return false;
+	}
+
+	if(configureSerialPort(fileDescriptor, B1000000) == false) { fprintf(stderr, "%s: can't set %ld baud\n", port, FAST_UPLOAD_BAUD_RATE); close(fileDescriptor); return false; }
+
+	for(size_t page = 0; page < numPages; page++)
+	{
+		if(sendBytes(fileDescriptor, &image[page * FAST_UPLOAD_PAGE_BYTES], FAST_UPLOAD_PAGE_BYTES) == false) { close(fileDescriptor); return false; }
+
+		if(receiveByte(fileDescriptor, PAGE_TIMEOUT_ms) != FAST_UPLOAD_READY)
+		{
+			fprintf(stderr, "%s: bootloader stopped responding at page %u\n", port, (unsigned)page);
+			close(fileDescriptor);
+			return false;
+		}
+	}
+
+	int result = receiveByte(fileDescriptor, RESULT_TIMEOUT_ms);
+	close(fileDescriptor);
+
+	if(result != STK_OK)
+	{
+		if(result == STK_FAILED) { fprintf(stderr, "upload failed: CRC mismatch (firmware won't run until an upload succeeds)\n"); }
+		else                     { fprintf(stderr, "upload failed: no result from bootloader\n"); }
+		return false;
+	}
+
+	printf("upload OK: %u pages in %u ms\n", (unsigned)numPages, elapsed_ms(start));
+	return true;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+	const char *hexPath = NULL;
+	const char *port = NULL;
+	bool isBadCRC = false;
+
+	for(int ii = 1; ii < argc; ii++)
+	{
+		if     (strcmp(argv[ii], "--bad-crc") == 0)            { isBadCRC = true; }
+		else if( (argv[ii][0] != '-') && (hexPath == NULL) ) { hexPath = argv[ii]; }
+		else if( (argv[ii][0] != '-') && (port == NULL) )    { port = argv[ii]; }
+		else { hexPath = NULL; break; }
+	}
+
+	if(hexPath == NULL)
+	{
+		fprintf(stderr, "usage: %s <firmware.hex> [<serial port>] [--bad-crc]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<uint8_t> image;
+	if(intelHex_load(hexPath, image, FAST_UPLOAD_APP_END, "the bootloader") == false) { return 1; }
+
+	//bootloader writes whole pages
+	size_t numPaddedPages = (image.size() + FAST_UPLOAD_PAGE_BYTES - 1) / FAST_UPLOAD_PAGE_BYTES;
+	image.resize(numPaddedPages * FAST_UPLOAD_PAGE_BYTES, 0xFF);
+
+	uint16_t crc = FAST_UPLOAD_CRC_INITIAL_VALUE;
+	for(size_t ii = 0; ii < image.size(); ii++) { crc = crc_ccitt_update(crc, image[ii]); }
+
+	uint32_t numPages = image.size() / FAST_UPLOAD_PAGE_BYTES;
+	printf("%s: pages: %u, bytes: %u, crc: 0x%04X\n", hexPath, numPages, (unsigned)image.size(), crc);
+
+	//STK500: erase overlaps page transfer, write doesn't //fast upload: write overlaps next page's transfer, erase doesn't
+	uint32_t stk500Page_us = (uint32_t)((uint64_t)STK500_BYTES_PER_PAGE * BITS_PER_BYTE * 1000000 / STK500_BAUD_RATE) + FLASH_WRITE_us;
+	uint32_t fastTransfer_us = (uint32_t)((uint64_t)FAST_UPLOAD_PAGE_BYTES * BITS_PER_BYTE * 1000000 / FAST_UPLOAD_BAUD_RATE);
+	uint32_t fastPage_us = FLASH_ERASE_us + ((fastTransfer_us > FLASH_WRITE_us) ? fastTransfer_us : FLASH_WRITE_us);
+	printf("estimated upload time: STK500 (avrdude): %u ms, fast upload: %u ms\n", numPages * stk500Page_us / 1000, numPages * fastPage_us / 1000);
+
+	if(port == NULL) { return 0; } //image check only
+	if(isBadCRC == true) { crc = ~crc; }
+
+	return (upload(port, image, crc) == true) ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Linux stand-in for the subset of the Arduino AVR core used by muddersMIMA_firmware
+//PROGMEM data lives in ordinary RAM, so every pgm_read_xxx() and xxx_P() function is a plain memory access
+//all pin/timer/serial behavior is simulated by hal_host.cpp (see hostHardware.h)
+
+#ifndef hostArduino_h
+	#define hostArduino_h
+
+	#include <stdint.h>
+	#include <stddef.h>
+	#include <stdlib.h>
+	#include <string.h>
+	#include <math.h>
+
+	typedef bool    boolean;
+	typedef uint8_t byte;
+
+	#define HIGH 0x1
+	#define LOW  0x0
+
+	#define INPUT        0x0
+	#define OUTPUT       0x1
+	#define INPUT_PULLUP 0x2
+
+	#define DEC 10
+	#define HEX 16
+
+	//Arduino Nano pin numbers
+	static const uint8_t A0 = 14;
+	static const uint8_t A1 = 15;
+	static const uint8_t A2 = 16;
+	static const uint8_t A3 = 17;
+	static const uint8_t A4 = 18;
+	static const uint8_t A5 = 19;
+	static const uint8_t A6 = 20;
+	static const uint8_t A7 = 21;
+	#define NUM_DIGITAL_PINS 22
+
+	#define PIN_SPI_SS   10
+	#define PIN_SPI_MOSI 11
+	#define PIN_SPI_MISO 12
+	#define PIN_SPI_SCK  13
+
+	//MCUSR bits (see hal_resetCause_getAndClear())
+	#define PORF  0
+	#define EXTRF 1
+	#define BORF  2
+	#define WDRF  3
+
+	#define PROGMEM
+	#define PGM_P const char *
+	#define PSTR(s) (s)
+	class __FlashStringHelper;
+	#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+	#define pgm_read_byte(address)  (*(const uint8_t  *)(address))
+	#define pgm_read_word(address)  (*(const uint16_t *)(address))
+	#define pgm_read_dword(address) (*(const uint32_t *)(address))
+	#define pgm_read_ptr(address)   (*(void * const   *)(address))
+	#define memcpy_P  memcpy
+	#define strcmp_P  strcmp
+	#define strncmp_P strncmp
+	#define strlen_P  strlen
+
+	//ISRs are ordinary functions, which hal_host.cpp calls when the simulated interrupt fires
+	#define ISR(vector) extern "C" void vector(void)
+	void hostHardware_interruptsDisable(void);
+	void hostHardware_interruptsEnable(void);
+	#define cli() hostHardware_interruptsDisable()
+	#define sei() hostHardware_interruptsEnable()
+	#define noInterrupts() cli()
+	#define interrupts()   sei()
+
+	#define lowByte(w)  ((uint8_t)((w) & 0xFF))
+	#define highByte(w) ((uint8_t)((w) >> 8))
+	#define bit(b)      (1UL << (b))
+	#define _BV(b)      (1 << (b))
+	#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+	long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+	unsigned long millis(void);
+	unsigned long micros(void);
+	void delay(unsigned long ms);
+	void delayMicroseconds(unsigned int us);
+
+	void pinMode(uint8_t pin, uint8_t mode);
+	void digitalWrite(uint8_t pin, uint8_t value);
+	int  digitalRead(uint8_t pin);
+	int  analogRead(uint8_t pin);
+	void analogWrite(uint8_t pin, int value);
+
+	class HardwareSerial
+	{
+		public:
+			void begin(unsigned long baud);
+			void end(void);
+			int available(void);
+			int peek(void);
+			int read(void);
+			int availableForWrite(void);
+			void flush(void);
+			size_t write(uint8_t character);
+			size_t write(const uint8_t *buffer, size_t numBytes);
+			size_t print(const __FlashStringHelper *flashString);
+			size_t print(const char *string);
+			operator bool() { return true; }
+	};
+
+	extern HardwareSerial Serial;
+
+	//defined by the sketch
+	void setup(void);
+	void loop(void);
+
+#endif
@@ -0,0 +1,18 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Linux stand-in for avr-libc's <avr/wdt.h> (the host build has no watchdog)
+
+#ifndef hostWdt_h
+	#define hostWdt_h
+
+	#define WDTO_15MS  0
+	#define WDTO_250MS 4
+	#define WDTO_1S    6
+	#define WDTO_2S    7
+
+	#define wdt_enable(timeout)
+	#define wdt_disable()
+	#define wdt_reset()
+
+#endif
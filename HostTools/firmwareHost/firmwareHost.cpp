@@ -0,0 +1,65 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//runs the firmware on Linux against the simulated Nano in hal_host.cpp
+//usage: firmwareHost [--loops N] [--command '$XXX']... [--keyon] [--rpm N] [--libcm MODE,ASSIST,REGEN,SOC]
+//each command is typed (followed by newline) after setup(), and serial output is printed to stdout
+//--keyon: ECM sends idle IMA signals from boot (otherwise key is OFF)
+//--rpm:   tachometer runs at N RPM from boot
+//--libcm: LiBCM sends this frame after setup() (checksum is added), slowly enough that tachometer edges land mid-frame
+
+#include "muddersMIMA.h"
+#include "hostHardware.h"
+#include <stdio.h>
+
+#define LIBCM_BYTE_SPACING_us 2000 //frame spans several tachometer edges at typical RPM
+
+//one transaction, while CS is low
+void sendLiBCMFrame(const uint8_t *payload)
+{
+	uint8_t checksum = 0;
+	for(uint8_t ii = 0; ii < LIBCM_FRAME_LENGTH_BYTES - 2; ii++) { checksum -= payload[ii]; }
+
+	hostHardware_setDigitalInput(PIN_SPI_CS, LOW);
+	hostHardware_spiReceiveByte(LIBCM_FRAME_SYNC);
+	for(uint8_t ii = 0; ii < LIBCM_FRAME_LENGTH_BYTES - 2; ii++)
+	{
+		hostHardware_advanceTime_us(LIBCM_BYTE_SPACING_us);
+		hostHardware_spiReceiveByte(payload[ii]);
+	}
+	hostHardware_advanceTime_us(LIBCM_BYTE_SPACING_us);
+	hostHardware_spiReceiveByte(checksum);
+	hostHardware_setDigitalInput(PIN_SPI_CS, HIGH);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t numLoops = 100;
+	uint8_t libcmPayload[LIBCM_FRAME_LENGTH_BYTES - 2];
+	bool isLiBCMFrameQueued = NO;
+
+	hostHardware_serialEcho(YES);
+	hostHardware_setDigitalInput(PIN_SPI_CS, HIGH); //LiBCM idle
+
+	for(int ii = 1; ii < argc; ii++)
+	{
+		if     ( (strcmp(argv[ii], "--loops") == 0)   && (ii + 1 < argc) ) { numLoops = strtoul(argv[++ii], NULL, 10); }
+		else if( (strcmp(argv[ii], "--command") == 0) && (ii + 1 < argc) ) { hostHardware_serialInput(argv[++ii]); hostHardware_serialInput("\n"); }
+		else if(  strcmp(argv[ii], "--keyon") == 0)                        { hostHardware_setAnalogInput(PIN_MAMODE1_ECM, ADC_NUM_COUNTS_10b / 2); hostHardware_setDigitalInput(PIN_MAMODE2_ECM, HIGH); }
+		else if( (strcmp(argv[ii], "--rpm") == 0)     && (ii + 1 < argc) ) { hostHardware_setTachometer_rpm((uint16_t)strtoul(argv[++ii], NULL, 10)); }
+		else if( (strcmp(argv[ii], "--libcm") == 0)   && (ii + 1 < argc) &&
+		         (sscanf(argv[++ii], "%hhu,%hhu,%hhu,%hhu", &libcmPayload[0], &libcmPayload[1], &libcmPayload[2], &libcmPayload[3]) == 4) ) { isLiBCMFrameQueued = YES; }
+		else
+		{
+			fprintf(stderr, "usage: %s [--loops N] [--command '$XXX']... [--keyon] [--rpm N] [--libcm MODE,ASSIST,REGEN,SOC]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	setup();
+	if(isLiBCMFrameQueued == YES) { sendLiBCMFrame(libcmPayload); }
+	for(uint32_t ii = 0; ii < numLoops; ii++) { loop(); }
+
+	fflush(stdout);
+	return 0;
+}
@@ -0,0 +1,447 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Linux backend for hal.h, plus the Arduino core subset declared in Arduino.h
+//a single thread simulates the Nano: interrupts only fire while simulated time advances (or when a test injects an event)
+
+#include "muddersMIMA.h"
+#include "hostHardware.h"
+#include <stdio.h>
+#include <string>
+
+extern "C" void PCINT0_vect(void);
+extern "C" void TIMER1_OVF_vect(void);
+extern "C" void TIMER0_COMPA_vect(void);
+extern "C" void SPI_STC_vect(void);
+
+uint32_t host_time_us = 0;
+uint32_t host_nextTimer0_us = HOSTHARDWARE_TIMER0_PERIOD_us;
+uint32_t host_nextTimer1_us = HOSTHARDWARE_TIMER1_PERIOD_us;
+uint32_t host_nextTachEdge_us = 0;
+uint32_t host_tachHalfPeriod_us = 0; //0: tachometer stopped
+uint32_t host_nextTick_us = 1000;
+void (*host_tickCallback)(void) = NULL;
+bool host_isTickPending = NO; //tick occurred during ISR
+
+//interrupt flags are set by hardware events, and cleared when the ISR runs
+bool host_areInterruptsEnabled = YES;
+bool host_isInISR = NO;
+bool host_isAsleep = NO;
+bool host_isPCINT0_enabled = NO;  bool host_isPCINT0_flagged = NO;
+bool host_isTimer1_enabled = NO;  bool host_isTimer1_flagged = NO;
+bool host_isTimer0_enabled = NO;  bool host_isTimer0_flagged = NO;
+bool host_isSPI_enabled    = NO;  bool host_isSPI_flagged    = NO;
+
+uint8_t host_pinMode[NUM_DIGITAL_PINS];
+bool    host_outputLevel[NUM_DIGITAL_PINS];
+bool    host_inputLevel[NUM_DIGITAL_PINS];
+bool    host_isInputDriven[NUM_DIGITAL_PINS];
+uint8_t host_pwm[NUM_DIGITAL_PINS];
+uint32_t host_outputChanged_us[NUM_DIGITAL_PINS];
+uint16_t host_analogCounts[8];
+
+uint8_t host_spiData = 0;
+
+struct hostEeprom
+{
+	uint8_t bytes[HOSTHARDWARE_EEPROM_SIZE_BYTES];
+	hostEeprom() { memset(bytes, 0xFF, sizeof(bytes)); }
+};
+hostEeprom host_eeprom;
+uint32_t host_eepromReadyAt_us = 0;
+
+uint8_t host_resetCause = (1 << PORF);
+
+std::string host_serialRx;
+std::string host_serialTx;
+bool host_isSerialEchoed = NO;
+uint8_t host_serialTxBuffer_numBytes = 0;
+uint32_t host_serialTxDrained_us = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//same priority order as the 328p vector table
+void host_dispatchInterrupts(void)
+{
+	while(host_areInterruptsEnabled == YES)
+	{
+		void (*isr)(void) = NULL;
+
+		if     (host_isPCINT0_enabled && host_isPCINT0_flagged) { host_isPCINT0_flagged = NO; isr = PCINT0_vect;       }
+		else if(host_isTimer1_enabled && host_isTimer1_flagged) { host_isTimer1_flagged = NO; isr = TIMER1_OVF_vect;   }
+		else if(host_isTimer0_enabled && host_isTimer0_flagged) { host_isTimer0_flagged = NO; isr = TIMER0_COMPA_vect; }
+		else if(host_isSPI_enabled    && host_isSPI_flagged   ) { host_isSPI_flagged    = NO; isr = SPI_STC_vect;      }
+		else { return; }
+
+		host_areInterruptsEnabled = NO; //AVR disables interrupts inside ISRs
+		host_isInISR = YES;
+		isr();
+		host_isInISR = NO;
+		host_areInterruptsEnabled = YES;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hostHardware_interruptsDisable(void) { host_areInterruptsEnabled = NO; }
+void hostHardware_interruptsEnable(void)  { host_areInterruptsEnabled = YES; host_dispatchInterrupts(); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void host_runTickCallback(void)
+{
+	static bool isCallbackRunning = NO;
+
+	if( (host_isTickPending == NO) || (host_isInISR == YES) || (isCallbackRunning == YES) ) { return; }
+
+	host_isTickPending = NO;
+	isCallbackRunning = YES;
+	host_tickCallback();
+	isCallbackRunning = NO;
+}
+
+void hostHardware_setTickCallback_1ms(void (*callback)(void))
+{
+	host_tickCallback = callback;
+	host_nextTick_us = host_time_us - (host_time_us % 1000) + 1000;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//also called from inside ISRs (e.g. micros()), in which case any new interrupts are dispatched after the ISR returns
+void hostHardware_advanceTime_us(uint32_t duration_us)
+{
+	uint32_t end_us = host_time_us + duration_us;
+
+	while(true)
+	{
+		uint32_t nextEvent_us = host_nextTimer1_us;
+		if((int32_t)(host_nextTimer0_us - nextEvent_us) < 0) { nextEvent_us = host_nextTimer0_us; }
+		if( (host_tachHalfPeriod_us != 0) && ((int32_t)(host_nextTachEdge_us - nextEvent_us) < 0) ) { nextEvent_us = host_nextTachEdge_us; }
+		if( (host_tickCallback != NULL) && ((int32_t)(host_nextTick_us - nextEvent_us) < 0) ) { nextEvent_us = host_nextTick_us; }
+
+		if((int32_t)(nextEvent_us - end_us) > 0) { break; }
+
+		if((int32_t)(nextEvent_us - host_time_us) > 0) { host_time_us = nextEvent_us; }
+
+		if(nextEvent_us == host_nextTimer1_us) { host_isTimer1_flagged = YES; host_nextTimer1_us += HOSTHARDWARE_TIMER1_PERIOD_us; }
+		if(nextEvent_us == host_nextTimer0_us) { host_isTimer0_flagged = YES; host_nextTimer0_us += HOSTHARDWARE_TIMER0_PERIOD_us; }
+		if( (host_tachHalfPeriod_us != 0) && (nextEvent_us == host_nextTachEdge_us) )
+		{
+			host_nextTachEdge_us += host_tachHalfPeriod_us;
+			hostHardware_setDigitalInput(PIN_NEP, !digitalRead(PIN_NEP)); //dispatches PCINT0_vect
+		}
+		if( (host_tickCallback != NULL) && (nextEvent_us == host_nextTick_us) )
+		{
+			host_nextTick_us += 1000;
+			host_isTickPending = YES;
+		}
+
+		host_runTickCallback();
+
+		host_dispatchInterrupts();
+	}
+
+	if((int32_t)(end_us - host_time_us) > 0) { host_time_us = end_us; }
+
+	host_runTickCallback(); //tick that occurred inside an ISR
+}
+
+uint32_t hostHardware_getTime_us(void) { return host_time_us; }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long micros(void) { hostHardware_advanceTime_us(HOSTHARDWARE_TIME_PER_CALL_us); return host_time_us; }
+unsigned long millis(void) { hostHardware_advanceTime_us(HOSTHARDWARE_TIME_PER_CALL_us); return host_time_us / 1000; }
+
+void delay(unsigned long ms)            { hostHardware_advanceTime_us(ms * 1000); }
+void delayMicroseconds(unsigned int us) { hostHardware_advanceTime_us(us);        }
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+	return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	if(pin >= NUM_DIGITAL_PINS) { return; }
+
+	if     (mode == INPUT_PULLUP) { host_outputLevel[pin] = HIGH; } //PORTx bit also selects pullup
+	else if(mode == INPUT)        { host_outputLevel[pin] = LOW;  }
+
+	host_pinMode[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+	if(pin >= NUM_DIGITAL_PINS) { return; }
+
+	uint8_t newPWM = (value != LOW) ? 255 : 0; //digitalWrite() stops PWM
+	if(newPWM != host_pwm[pin]) { host_outputChanged_us[pin] = host_time_us; }
+
+	host_outputLevel[pin] = (value != LOW);
+	host_pwm[pin] = newPWM;
+}
+
+int digitalRead(uint8_t pin)
+{
+	if(pin >= NUM_DIGITAL_PINS)          { return LOW; }
+	if(host_pinMode[pin] == OUTPUT)      { return host_outputLevel[pin]; }
+	if(host_isInputDriven[pin] == YES)   { return host_inputLevel[pin];  }
+	if(host_pinMode[pin] == INPUT_PULLUP) { return HIGH; }
+
+	return LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+	uint8_t channel = (pin >= A0) ? (pin - A0) : pin;
+	if(channel >= 8) { return 0; }
+
+	hostHardware_advanceTime_us(HOSTHARDWARE_ANALOG_READ_us);
+
+	return host_analogCounts[channel];
+}
+
+//same as Arduino core: pin becomes an output, and 0/255 are static levels
+void analogWrite(uint8_t pin, int value)
+{
+	if(pin >= NUM_DIGITAL_PINS) { return; }
+
+	host_pinMode[pin] = OUTPUT;
+
+	if(value < 0)   { value = 0;   }
+	if(value > 255) { value = 255; }
+
+	if(value != host_pwm[pin]) { host_outputChanged_us[pin] = host_time_us; }
+
+	host_pwm[pin] = (uint8_t)value;
+	host_outputLevel[pin] = (value >= 128);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hostHardware_setDigitalInput(uint8_t pin, bool level)
+{
+	if(pin >= NUM_DIGITAL_PINS) { return; }
+
+	bool previousLevel = digitalRead(pin);
+
+	host_inputLevel[pin] = level;
+	host_isInputDriven[pin] = YES;
+
+	if( ((pin == PIN_NEP) || ((pin == PIN_SPI_CS) && host_isSPI_enabled)) && (digitalRead(pin) != previousLevel) )
+	{
+		host_isPCINT0_flagged = YES;
+		host_dispatchInterrupts();
+	}
+}
+
+//three tachometer pulses per two engine revolutions
+void hostHardware_setTachometer_rpm(uint16_t rpm)
+{
+	if(rpm == 0) { host_tachHalfPeriod_us = 0; return; }
+
+	uint32_t halfPeriod_us = (uint32_t)(ONE_MINUTE_IN_MICROSECONDS * NUM_ENGINE_REVOLUTIONS_PER_CYCLE / NUM_TACHOMETER_PULSES_PER_CYCLE / 2) / rpm;
+
+	if(host_tachHalfPeriod_us == 0) { host_nextTachEdge_us = host_time_us + halfPeriod_us; } //otherwise current half period finishes first
+	host_tachHalfPeriod_us = halfPeriod_us;
+}
+
+void hostHardware_setAnalogInput(uint8_t pin, uint16_t counts)
+{
+	uint8_t channel = (pin >= A0) ? (pin - A0) : pin;
+	if(channel < 8) { host_analogCounts[channel] = counts & 0x3FF; }
+}
+
+bool    hostHardware_getDigitalOutput(uint8_t pin) { return (pin < NUM_DIGITAL_PINS) ? host_outputLevel[pin] : LOW; }
+uint8_t hostHardware_getPinMode(uint8_t pin)       { return (pin < NUM_DIGITAL_PINS) ? host_pinMode[pin]     : INPUT; }
+uint8_t hostHardware_getPWM(uint8_t pin)           { return (pin < NUM_DIGITAL_PINS) ? host_pwm[pin]         : 0; }
+uint32_t hostHardware_getOutputChangeTime_us(uint8_t pin) { return (pin < NUM_DIGITAL_PINS) ? host_outputChanged_us[pin] : 0; }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hostHardware_spiReceiveByte(uint8_t data)
+{
+	host_spiData = data;
+	host_isSPI_flagged = YES;
+	host_dispatchInterrupts();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t *hostHardware_eeprom(void) { return host_eeprom.bytes; }
+void hostHardware_setResetCause(uint8_t mcusr) { host_resetCause = mcusr; }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hostHardware_serialInput(const char *text) { host_serialRx += text; }
+void hostHardware_serialEcho(bool isEnabled) { host_isSerialEchoed = isEnabled; }
+const char *hostHardware_serialOutput_get(void) { return host_serialTx.c_str(); }
+void hostHardware_serialOutput_clear(void) { host_serialTx.clear(); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//TX buffer empties at the USB UART's baud rate
+void host_serialTxBuffer_drain(void)
+{
+	uint32_t numBytesSent = (host_time_us - host_serialTxDrained_us) / HOSTHARDWARE_SERIAL_BYTE_us;
+
+	if(numBytesSent >= host_serialTxBuffer_numBytes)
+	{
+		host_serialTxBuffer_numBytes = 0;
+		host_serialTxDrained_us = host_time_us;
+	}
+	else
+	{
+		host_serialTxBuffer_numBytes -= numBytesSent;
+		host_serialTxDrained_us += numBytesSent * HOSTHARDWARE_SERIAL_BYTE_us;
+	}
+}
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) { (void)baud; }
+void HardwareSerial::end(void) { ; }
+void HardwareSerial::flush(void) { hostHardware_advanceTime_us(host_serialTxBuffer_numBytes * HOSTHARDWARE_SERIAL_BYTE_us); host_serialTxBuffer_drain(); }
+
+int HardwareSerial::available(void) { return (int)host_serialRx.size(); }
+int HardwareSerial::peek(void)      { return host_serialRx.empty() ? -1 : (uint8_t)host_serialRx[0]; }
+
+int HardwareSerial::read(void)
+{
+	if(host_serialRx.empty()) { return -1; }
+
+	uint8_t character = host_serialRx[0];
+	host_serialRx.erase(0, 1);
+
+	return character;
+}
+
+int HardwareSerial::availableForWrite(void)
+{
+	host_serialTxBuffer_drain();
+
+	return HOSTHARDWARE_SERIAL_TX_BUFFER_BYTES - host_serialTxBuffer_numBytes;
+}
+
+//blocks (in simulated time) when TX buffer is full... same as Arduino core
+size_t HardwareSerial::write(uint8_t character)
+{
+	while(availableForWrite() == 0) { hostHardware_advanceTime_us(HOSTHARDWARE_SERIAL_BYTE_us); }
+
+	host_serialTxBuffer_numBytes++;
+	host_serialTx += (char)character;
+	if(host_isSerialEchoed == YES) { putchar(character); }
+
+	return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t numBytes)
+{
+	for(size_t ii = 0; ii < numBytes; ii++) { write(buffer[ii]); }
+
+	return numBytes;
+}
+
+size_t HardwareSerial::print(const char *string) { return write((const uint8_t *)string, strlen(string)); }
+size_t HardwareSerial::print(const __FlashStringHelper *flashString) { return print(reinterpret_cast<const char *>(flashString)); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//hal.h
+
+void hal_pwmTimers_begin(void) { ; } //PWM frequency isn't simulated
+
+void hal_engineRPM_interruptBegin(void) { host_isPCINT0_enabled = YES; host_isPCINT0_flagged = NO; }
+
+void    hal_spiSlave_begin(void)           { host_isSPI_enabled = YES; host_isSPI_flagged = NO; }
+uint8_t hal_spiSlave_getReceivedByte(void) { return host_spiData; }
+bool    hal_spiSlave_isChipSelected(void)  { return (digitalRead(PIN_SPI_CS) == LOW); }
+
+void hal_timer1Overflow_enableInterrupt(void)  { host_isTimer1_flagged = NO; host_isTimer1_enabled = YES; }
+void hal_timer1Overflow_disableInterrupt(void) { host_isTimer1_enabled = NO; }
+
+void hal_timer0CompareA_enableInterrupt(uint8_t compareCounts) { (void)compareCounts; host_isTimer0_flagged = NO; host_isTimer0_enabled = YES; }
+void hal_timer0CompareA_disableInterrupt(void) { host_isTimer0_enabled = NO; }
+
+void hal_brakePWM_connect(void)             { analogWrite(PIN_BRAKE, 0);      } //host analogWrite() only records the duty cycle
+void hal_brakePWM_setCounts(uint8_t counts) { analogWrite(PIN_BRAKE, counts); }
+
+uint8_t hal_resetCause_getAndClear(void)
+{
+	uint8_t resetCause = host_resetCause;
+	host_resetCause = 0;
+
+	return resetCause;
+}
+
+//firmware isn't in (simulated) flash, so imageCheck.cpp reports an empty, unstamped image
+uint16_t hal_flash_imageSize_bytes(void)            { return 0; }
+uint8_t  hal_flash_readByte(uint16_t flashAddress) { (void)flashAddress; return 0xFF; }
+
+//skip ahead to next millisecond (nothing the firmware polls changes faster)
+void hal_idle(void) { hostHardware_advanceTime_us(1000 - (host_time_us % 1000)); }
+
+//levels the 328p's pin change interrupts see (PIN_MAMODE1_ECM is simulated as analog counts)
+uint8_t host_wakePinLevels(void)
+{
+	return (digitalRead(PIN_MAMODE2_ECM) << 0) | (digitalRead(PIN_USER_MOMENTARY) << 1) | ((host_analogCounts[PIN_MAMODE1_ECM - A0] >= 512) << 2);
+}
+
+//time skips ahead 1 ms at a time (so simulation models keep running) until a wake source changes
+//unlike the 328p, millis() and timer interrupts keep running while asleep
+bool hal_powerDown_untilPinChange(void)
+{
+	if( (host_tickCallback == NULL) && host_serialRx.empty() )
+	{
+		//nothing can change an input (e.g. firmwareHost), so the firmware would sleep forever
+		fflush(stdout);
+		exit(EXIT_SUCCESS);
+	}
+
+	uint8_t levelsBeforeSleep = host_wakePinLevels();
+	bool wasWokenByPinChange = NO;
+
+	host_isAsleep = YES;
+	for(uint16_t ii = 0; (ii < HAL_POWERDOWN_WATCHDOG_ms) && (wasWokenByPinChange == NO); ii++)
+	{
+		hostHardware_advanceTime_us(1000);
+
+		if(host_serialRx.empty() == NO) { host_serialRx.erase(0, 1); wasWokenByPinChange = YES; } //UART is stopped, so the character that woke the CPU is lost
+		if(host_wakePinLevels() != levelsBeforeSleep) { wasWokenByPinChange = YES; }
+	}
+	host_isAsleep = NO;
+
+	return wasWokenByPinChange; //NO: watchdog
+}
+
+bool hostHardware_isAsleep(void) { return host_isAsleep; }
+
+bool    hal_eeprom_isReady(void) { return ((int32_t)(host_time_us - host_eepromReadyAt_us) >= 0); }
+uint8_t hal_eeprom_readByte(uint16_t eepromAddress) { return host_eeprom.bytes[eepromAddress % HOSTHARDWARE_EEPROM_SIZE_BYTES]; }
+
+void hal_eeprom_writeByte(uint16_t eepromAddress, uint8_t value)
+{
+	host_eeprom.bytes[eepromAddress % HOSTHARDWARE_EEPROM_SIZE_BYTES] = value;
+	host_eepromReadyAt_us = host_time_us + HOSTHARDWARE_EEPROM_WRITE_us;
+}
+
+void hal_eeprom_readBlock(void *destination, uint16_t eepromAddress, uint8_t numBytes)
+{
+	for(uint8_t ii = 0; ii < numBytes; ii++) { ((uint8_t *)destination)[ii] = hal_eeprom_readByte(eepromAddress + ii); }
+}
+
+//simulated time isn't cycle accurate, so host 'cycle counts' only check that benchmark.cpp runs
+uint32_t host_cycleCounterStart_us = 0;
+
+void     hal_cycleCounter_begin(void) { host_cycleCounterStart_us = host_time_us; }
+uint32_t hal_cycleCounter_get(void)   { return (host_time_us - host_cycleCounterStart_us) * HOSTHARDWARE_CYCLES_PER_us; }
+void     hal_cycleCounter_end(void)   { ; }
+
+void hal_halt(void)
+{
+	fflush(stdout);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,55 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//simulated Arduino Nano used by the host build (implemented in hal_host.cpp)
+//tests drive the firmware's inputs and observe its outputs through these functions
+
+//time only moves when the firmware (or a test) asks for it:
+//each millis()/micros() call advances HOSTHARDWARE_TIME_PER_CALL_us, analogRead() advances the real conversion time,
+//and timer interrupts fire as simulated time passes each Timer0/Timer1 period
+//hal_idle() skips ahead to the next millisecond, so the firmware's idle wait costs almost nothing
+//hal_powerDown_untilPinChange() skips ahead 1 ms at a time until a wake pin changes or a character is typed (which is lost, as on the 328p)
+//...and exits the program if there's no tick callback or typed input left (nothing could ever wake the firmware)
+
+#ifndef hostHardware_h
+	#define hostHardware_h
+
+	#include <stdint.h>
+
+	#define HOSTHARDWARE_TIME_PER_CALL_us         2 //roughly the cost of micros() on the 328p
+	#define HOSTHARDWARE_ANALOG_READ_us         112 //ADC conversion time (Arduino default prescaler)
+	#define HOSTHARDWARE_TIMER0_PERIOD_us      1024 //TIMER0_COMPA_vect (once per Timer0 overflow)
+	#define HOSTHARDWARE_TIMER1_PERIOD_us       128 //TIMER1_OVF_vect
+	#define HOSTHARDWARE_EEPROM_WRITE_us       3400 //per byte
+	#define HOSTHARDWARE_EEPROM_SIZE_BYTES     1024
+	#define HOSTHARDWARE_SERIAL_TX_BUFFER_BYTES  63 //HardwareSerial TX buffer
+	#define HOSTHARDWARE_SERIAL_BYTE_us          87 //115200 baud
+	#define HOSTHARDWARE_CYCLES_PER_us           16 //16 MHz
+
+	void     hostHardware_advanceTime_us(uint32_t duration_us); //fires any interrupts that occur meanwhile
+	uint32_t hostHardware_getTime_us(void);
+
+	//simulation models (e.g. ../imaSimulator) update firmware inputs from this callback
+	//called at each simulated millisecond boundary //may occur during firmware code, but never during an ISR
+	void hostHardware_setTickCallback_1ms(void (*callback)(void));
+	bool hostHardware_isAsleep(void); //inside hal_powerDown_untilPinChange() //e.g. so the tick callback can change wake pins
+
+	void    hostHardware_setDigitalInput(uint8_t pin, bool level); //PIN_NEP & PIN_SPI_CS edges fire PCINT0_vect
+	void    hostHardware_setTachometer_rpm(uint16_t rpm); //square wave on PIN_NEP //0: stops toggling
+	void    hostHardware_setAnalogInput(uint8_t pin, uint16_t counts); //10b
+	bool    hostHardware_getDigitalOutput(uint8_t pin); //level driven by firmware
+	uint8_t hostHardware_getPinMode(uint8_t pin); //INPUT/OUTPUT/INPUT_PULLUP
+	uint8_t hostHardware_getPWM(uint8_t pin); //latest analogWrite() value
+	uint32_t hostHardware_getOutputChangeTime_us(uint8_t pin); //when firmware last changed pin's PWM/level
+
+	void hostHardware_spiReceiveByte(uint8_t data); //byte from LiBCM //fires SPI_STC_vect
+
+	uint8_t *hostHardware_eeprom(void); //HOSTHARDWARE_EEPROM_SIZE_BYTES //erased (0xFF) at startup
+	void hostHardware_setResetCause(uint8_t mcusr); //returned by hal_resetCause_getAndClear()
+
+	void hostHardware_serialInput(const char *text); //characters typed by the user
+	void hostHardware_serialEcho(bool isEnabled); //also copy serial output to stdout
+	const char *hostHardware_serialOutput_get(void); //everything sent since last clear
+	void hostHardware_serialOutput_clear(void);
+
+#endif
@@ -0,0 +1,6 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//compiles the sketch's setup() & loop() for the host build (Arduino IDE compiles the .ino directly)
+
+#include "../../muddersMIMA_firmware/muddersMIMA_firmware.ino"
@@ -0,0 +1,32 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Linux stand-in for avr-libc's <util/crc16.h> (C equivalents from the avr-libc documentation)
+
+#ifndef hostCrc16_h
+	#define hostCrc16_h
+
+	#include <stdint.h>
+
+	static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data)
+	{
+		data ^= (uint8_t)(crc & 0xFF);
+		data ^= (uint8_t)(data << 4);
+
+		return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+	}
+
+	static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+	{
+		crc ^= data;
+
+		for(uint8_t ii = 0; ii < 8; ii++)
+		{
+			if(crc & 0x80) { crc = (crc << 1) ^ 0x07; }
+			else           { crc <<= 1;               }
+		}
+
+		return crc;
+	}
+
+#endif
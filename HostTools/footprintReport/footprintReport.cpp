@@ -0,0 +1,266 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//reports flash & RAM usage per source file (and per symbol), then checks each file against its budget
+//usage: footprintReport <symbols.txt> [--budgets <budgets.txt>] [--symbols <N>] [--suggest]
+//  symbols.txt: output from 'avr-nm --print-size --size-sort --line-numbers --demangle firmware.elf'
+//  --budgets: return 1 (and list each offender on stderr) if any module exceeds its budget
+//  --symbols: also list the N largest symbols (default 20)
+//  --suggest: print a budgets file instead (present usage plus BUDGET_HEADROOM_PERCENT)
+//symbols without line numbers (i.e. precompiled libgcc/avr-libc code) are grouped into '(soft-float)' and '(runtime)'
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#define BUDGET_NO_LIMIT         UINT32_MAX //'-' in budgets file
+#define BUDGET_HEADROOM_PERCENT 10
+#define BUDGET_ROUNDING_BYTES   16
+#define SYMBOLS_LISTED_DEFAULT  20
+
+#define TOTAL_MODULE_NAME "TOTAL"
+
+struct symbolInfo
+{
+	std::string name;
+	std::string module;
+	uint32_t flash_bytes;
+	uint32_t RAM_bytes;
+};
+
+struct moduleUsage
+{
+	uint32_t flash_bytes;
+	uint32_t RAM_bytes;
+	moduleUsage() : flash_bytes(0), RAM_bytes(0) { ; }
+};
+
+struct moduleBudget
+{
+	uint32_t flash_bytes;
+	uint32_t RAM_bytes;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//"/path/to/adc.cpp:42" -> "adc.cpp"
+std::string moduleFromLocation(const std::string &location)
+{
+	std::string path = location.substr(0, location.rfind(':'));
+	size_t slash = path.find_last_of("/\\");
+
+	if(slash == std::string::npos) { return path; }
+	return path.substr(slash + 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//libgcc float routines: __addsf3, __mulsf3, __fixunssfsi, __floatsisf, __fp_round, etc
+bool isSoftFloatSymbol(const std::string &name)
+{
+	if(name.compare(0, 5, "__fp_") == 0) { return true; }
+	return ( (name.compare(0, 2, "__") == 0) && (name.find("sf") != std::string::npos) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//avr-nm line: "<address> <size> <type> <name>[<tab><file>:<line>]"
+//returns false if line doesn't describe a sized symbol
+bool parseSymbol(const char *line, symbolInfo *symbol)
+{
+	unsigned long size = 0;
+	char type = 0;
+	int nameOffset = 0;
+
+	if(sscanf(line, "%*x %lx %c %n", &size, &type, &nameOffset) != 2) { return false; }
+
+	std::string rest(line + nameOffset);
+	while( (rest.size() > 0) && ((rest[rest.size() - 1] == '\n') || (rest[rest.size() - 1] == '\r')) ) { rest.erase(rest.size() - 1); }
+
+	size_t tab = rest.find('\t');
+	symbol->name = rest.substr(0, tab);
+
+	if(tab != std::string::npos)         { symbol->module = moduleFromLocation(rest.substr(tab + 1)); }
+	else if(isSoftFloatSymbol(symbol->name)) { symbol->module = "(soft-float)"; }
+	else                                     { symbol->module = "(runtime)";    }
+
+	//avr-gcc places const (non-PROGMEM) data in RAM, so initialized & const variables use RAM, plus flash for their initial value
+	switch(type)
+	{
+		case 'T': case 't': case 'W': case 'w':                     symbol->flash_bytes = size; symbol->RAM_bytes = 0;    break; //code & PROGMEM
+		case 'D': case 'd': case 'R': case 'r': case 'V': case 'v': symbol->flash_bytes = size; symbol->RAM_bytes = size; break;
+		case 'B': case 'b': case 'C':                               symbol->flash_bytes = 0;    symbol->RAM_bytes = size; break;
+		default: return false; //absolute, debug, etc
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t parseBudgetValue(const char *text) { return (strcmp(text, "-") == 0) ? BUDGET_NO_LIMIT : (uint32_t)strtoul(text, NULL, 10); }
+
+//budgets file: "<module> <flash_bytes> <RAM_bytes>" per line ('-': no limit) //'#' starts a comment
+bool loadBudgets(const char *path, std::map<std::string, moduleBudget> *budgets)
+{
+	FILE *file = fopen(path, "r");
+	if(file == NULL) { fprintf(stderr, "error: can't open %s\n", path); return false; }
+
+	char line[256];
+	while(fgets(line, sizeof(line), file) != NULL)
+	{
+		char module[128], flash[32], RAM[32];
+
+		if(line[0] == '#') { continue; }
+		if(sscanf(line, "%127s %31s %31s", module, flash, RAM) != 3) { continue; }
+
+		moduleBudget budget = { parseBudgetValue(flash), parseBudgetValue(RAM) };
+		(*budgets)[module] = budget;
+	}
+
+	fclose(file);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t suggestBudget(uint32_t bytes)
+{
+	uint32_t budget = bytes + (bytes * BUDGET_HEADROOM_PERCENT) / 100;
+	return ((budget + BUDGET_ROUNDING_BYTES - 1) / BUDGET_ROUNDING_BYTES) * BUDGET_ROUNDING_BYTES; //modules using none get none
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void printBudget(uint32_t budget)
+{
+	if(budget == BUDGET_NO_LIMIT) { printf(",-"); }
+	else                          { printf(",%u", budget); }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//demangled C++ names can contain commas
+void printName(const std::string &name)
+{
+	if(name.find(',') == std::string::npos) { printf("%s", name.c_str()); }
+	else                                    { printf("\"%s\"", name.c_str()); }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//prints one report row //returns number of budgets exceeded
+int printModule(const std::string &module, const moduleUsage &usage, const std::map<std::string, moduleBudget> &budgets)
+{
+	moduleBudget budget = { BUDGET_NO_LIMIT, BUDGET_NO_LIMIT };
+	std::map<std::string, moduleBudget>::const_iterator found = budgets.find(module);
+	if(found != budgets.end()) { budget = found->second; }
+
+	printf("%s,%u,%u", module.c_str(), usage.flash_bytes, usage.RAM_bytes);
+	printBudget(budget.flash_bytes);
+	printBudget(budget.RAM_bytes);
+	printf("\n");
+
+	int numOverBudget = 0;
+	if(usage.flash_bytes > budget.flash_bytes)
+	{
+		fprintf(stderr, "over budget: %s uses %u bytes flash (budget %u)\n", module.c_str(), usage.flash_bytes, budget.flash_bytes);
+		numOverBudget++;
+	}
+	if(usage.RAM_bytes > budget.RAM_bytes)
+	{
+		fprintf(stderr, "over budget: %s uses %u bytes RAM (budget %u)\n", module.c_str(), usage.RAM_bytes, budget.RAM_bytes);
+		numOverBudget++;
+	}
+
+	return numOverBudget;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool isLarger(const symbolInfo &a, const symbolInfo &b) { return (a.flash_bytes + a.RAM_bytes) > (b.flash_bytes + b.RAM_bytes); }
+
+int main(int argc, char *argv[])
+{
+	const char *symbolsPath = NULL;
+	const char *budgetsPath = NULL;
+	uint32_t numSymbolsListed = SYMBOLS_LISTED_DEFAULT;
+	bool isSuggesting = false;
+
+	for(int ii = 1; ii < argc; ii++)
+	{
+		if     ( (strcmp(argv[ii], "--budgets") == 0) && (ii + 1 < argc) ) { budgetsPath = argv[++ii]; }
+		else if( (strcmp(argv[ii], "--symbols") == 0) && (ii + 1 < argc) ) { numSymbolsListed = strtoul(argv[++ii], NULL, 10); }
+		else if(  strcmp(argv[ii], "--suggest") == 0)                      { isSuggesting = true; }
+		else if(symbolsPath == NULL)                                       { symbolsPath = argv[ii]; }
+		else { fprintf(stderr, "unknown argument: %s\n", argv[ii]); return 1; }
+	}
+
+	if(symbolsPath == NULL) { fprintf(stderr, "usage: footprintReport <symbols.txt> [--budgets <budgets.txt>] [--symbols <N>] [--suggest]\n"); return 1; }
+
+	FILE *file = fopen(symbolsPath, "r");
+	if(file == NULL) { fprintf(stderr, "error: can't open %s\n", symbolsPath); return 1; }
+
+	std::vector<symbolInfo> symbols;
+	std::map<std::string, moduleUsage> modules;
+	moduleUsage total;
+
+	char line[1024];
+	while(fgets(line, sizeof(line), file) != NULL)
+	{
+		symbolInfo symbol;
+		if(parseSymbol(line, &symbol) == false) { continue; }
+
+		symbols.push_back(symbol);
+		modules[symbol.module].flash_bytes += symbol.flash_bytes;
+		modules[symbol.module].RAM_bytes   += symbol.RAM_bytes;
+		total.flash_bytes += symbol.flash_bytes;
+		total.RAM_bytes   += symbol.RAM_bytes;
+	}
+	fclose(file);
+
+	if(symbols.empty()) { fprintf(stderr, "error: no sized symbols in %s\n", symbolsPath); return 1; }
+
+	if(isSuggesting == true)
+	{
+		printf("#module flash_bytes RAM_bytes ('-': no limit)\n");
+		printf("%s %u %u\n", TOTAL_MODULE_NAME, suggestBudget(total.flash_bytes), suggestBudget(total.RAM_bytes));
+		for(std::map<std::string, moduleUsage>::const_iterator it = modules.begin(); it != modules.end(); ++it)
+		{
+			printf("%s %u %u\n", it->first.c_str(), suggestBudget(it->second.flash_bytes), suggestBudget(it->second.RAM_bytes));
+		}
+		return 0;
+	}
+
+	std::map<std::string, moduleBudget> budgets;
+	if( (budgetsPath != NULL) && (loadBudgets(budgetsPath, &budgets) == false) ) { return 1; }
+
+	int numOverBudget = 0;
+
+	printf("module,flash_bytes,RAM_bytes,flash_budget,RAM_budget\n");
+	for(std::map<std::string, moduleUsage>::const_iterator it = modules.begin(); it != modules.end(); ++it)
+	{
+		numOverBudget += printModule(it->first, it->second, budgets);
+	}
+	numOverBudget += printModule(TOTAL_MODULE_NAME, total, budgets);
+
+	if(numSymbolsListed > 0)
+	{
+		std::stable_sort(symbols.begin(), symbols.end(), isLarger);
+		if(symbols.size() > numSymbolsListed) { symbols.resize(numSymbolsListed); }
+
+		printf("\nsymbol,module,flash_bytes,RAM_bytes\n");
+		for(size_t ii = 0; ii < symbols.size(); ii++)
+		{
+			printName(symbols[ii].name);
+			printf(",%s,%u,%u\n", symbols[ii].module.c_str(), symbols[ii].flash_bytes, symbols[ii].RAM_bytes);
+		}
+	}
+
+	return (numOverBudget == 0) ? 0 : 1;
+}
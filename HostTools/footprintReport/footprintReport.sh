@@ -0,0 +1,22 @@
+#!/bin/bash
+#Copyright 2022-2023(c) John Sullivan
+
+#builds the firmware (same as the Arduino IDE), then reports flash & RAM usage per module and checks budgets.txt
+#usage: footprintReport.sh <arduino-cli> <avr-nm> <footprintReport> <outputDir> [budgets.txt]
+
+set -e -o pipefail
+
+ARDUINO_CLI="$1"
+AVR_NM="$2"
+FOOTPRINT_REPORT="$3"
+OUTPUT_DIR="$4"
+BUDGETS="${5:-$(dirname "$0")/budgets.txt}"
+SKETCH_DIR="$(cd "$(dirname "$0")/../../muddersMIMA_firmware" && pwd)"
+
+mkdir -p "$OUTPUT_DIR"
+
+"$ARDUINO_CLI" compile --fqbn arduino:avr:nano --output-dir "$OUTPUT_DIR" "$SKETCH_DIR"
+
+"$AVR_NM" --print-size --size-sort --line-numbers --demangle "$OUTPUT_DIR/muddersMIMA_firmware.ino.elf" > "$OUTPUT_DIR/symbols.txt"
+
+"$FOOTPRINT_REPORT" "$OUTPUT_DIR/symbols.txt" --budgets "$BUDGETS" | tee "$OUTPUT_DIR/footprint.csv"
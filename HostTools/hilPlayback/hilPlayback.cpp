@@ -0,0 +1,492 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//streams an ECM signal trace to the HIL signal generator ("HardwareInLoop Testing/ECM_IMA_Signals"), which drives LiControl's ECM inputs
+//usage: hilPlayback <trace.csv> [<serial port>] [--encode <out.bin>] [--responses <out.csv>] [--log <out.txt>] [--parse <log.txt>]
+//without a serial port, only checks the trace (and prints how much of the serial link it needs)
+//--encode:    also writes the binary records (e.g. to inspect, or to send with another tool)
+//--responses: writes LiControl's response to each record as CSV
+//--log:       saves everything the generator sent (except flow control)
+//--parse:     analyzes a previous '--log' instead of streaming (same trace must be used)
+//prints response latency p50/p99 (only records that changed LiControl's outputs)
+//returns 1 if the generator reported any underruns (i.e. records arrived after they were due)
+
+//trace format: CSV with a header row, '#' starts a comment
+//'timestamp_ms' is required, and may be fractional (resolution is PLAYBACK_TICK_us)
+//other columns: ECM_MAMODE1_counts (8b), ECM_MAMODE2_regenStandby (0/1), ECM_CMDPWR_counts (10b) //missing columns are idle IMA
+//each row's values are held until the next row's timestamp
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../../HardwareInLoop Testing/ECM_IMA_Signals/playback.h"
+
+#define SERIAL_BYTES_PER_SECOND 11520 //115200 baud
+#define BOOTLOADER_WAIT_ms       2000 //opening port resets Nano
+#define READY_TIMEOUT_ms         3000
+#define REPORT_TIMEOUT_ms        1000 //after last record is due
+
+//trace columns
+#define TRACE_TIMESTAMP    0
+#define TRACE_MAMODE1      1
+#define TRACE_MAMODE2      2
+#define TRACE_CMDPWR       3
+#define TRACE_NUM_COLUMNS  4
+
+const char * const traceColumnNames[TRACE_NUM_COLUMNS] = { "timestamp_ms", "ECM_MAMODE1_counts", "ECM_MAMODE2_regenStandby", "ECM_CMDPWR_counts" };
+const float traceColumnDefaults[TRACE_NUM_COLUMNS] = { 0, 127, 1, 511 }; //idle IMA (same as '$I')
+
+struct playbackRecord { uint16_t delay_ticks; uint16_t cmdpwr_flags; uint8_t mamode1_counts; };
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> splitCSV(const std::string &line)
+{
+	std::vector<std::string> fields;
+	std::string field;
+
+	for(size_t ii = 0; ii < line.size(); ii++)
+	{
+		if     (line[ii] == ',')                           { fields.push_back(field); field.clear(); }
+		else if( (line[ii] != '\r') && (line[ii] != ' ') ) { field += line[ii]; }
+	}
+	fields.push_back(field);
+
+	return fields;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool readLine(FILE *file, std::string &line)
+{
+	line.clear();
+
+	int character;
+	while( ((character = fgetc(file)) != EOF) && (character != '\n') ) { line += (char)character; }
+
+	return ( (character != EOF) || (line.empty() == false) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns false if trace can't be read
+//delays longer than uint16_t are split into repeated records
+bool loadTrace(const char *path, std::vector<playbackRecord> &records, uint32_t &duration_ms)
+{
+	FILE *file = fopen(path, "r");
+	if(file == NULL) { fprintf(stderr, "can't open %s\n", path); return false; }
+
+	std::string line;
+	int columnIndex[TRACE_NUM_COLUMNS]; //position of each trace column in file (-1: missing)
+	for(int ii = 0; ii < TRACE_NUM_COLUMNS; ii++) { columnIndex[ii] = -1; }
+
+	while( readLine(file, line) && (line.empty() || (line[0] == '#')) ) { ; }
+	std::vector<std::string> header = splitCSV(line);
+	for(size_t position = 0; position < header.size(); position++)
+	{
+		for(int ii = 0; ii < TRACE_NUM_COLUMNS; ii++)
+		{
+			if(header[position] == traceColumnNames[ii]) { columnIndex[ii] = (int)position; }
+		}
+	}
+
+	if(columnIndex[TRACE_TIMESTAMP] < 0) { fprintf(stderr, "%s: no 'timestamp_ms' column\n", path); fclose(file); return false; }
+
+	long firstTick = -1;
+	long previousTick = 0;
+	bool isValid = true;
+
+	while( (isValid == true) && readLine(file, line) )
+	{
+		if(line.empty() || (line[0] == '#')) { continue; } //comment
+
+		std::vector<std::string> fields = splitCSV(line);
+		float value[TRACE_NUM_COLUMNS];
+
+		for(int ii = 0; ii < TRACE_NUM_COLUMNS; ii++)
+		{
+			if( (columnIndex[ii] >= 0) && ((size_t)columnIndex[ii] < fields.size()) ) { value[ii] = strtof(fields[columnIndex[ii]].c_str(), NULL); }
+			else                                                                     { value[ii] = traceColumnDefaults[ii]; }
+		}
+
+		if( (value[TRACE_MAMODE1] < 0) || (value[TRACE_MAMODE1] > 255) || (value[TRACE_CMDPWR] < 0) || (value[TRACE_CMDPWR] > PLAYBACK_CMDPWR_MASK) )
+		{
+			fprintf(stderr, "%s: counts out of range ('%s')\n", path, line.c_str());
+			isValid = false;
+			break;
+		}
+
+		//round each timestamp (rather than each delay), so rounding errors don't accumulate
+		long tick = lroundf(value[TRACE_TIMESTAMP] * 1000 / PLAYBACK_TICK_us);
+		if(firstTick < 0) { firstTick = tick; previousTick = tick; }
+
+		if(tick < previousTick) { fprintf(stderr, "%s: timestamps must not decrease ('%s')\n", path, line.c_str()); isValid = false; break; }
+
+		long delay_ticks = tick - previousTick;
+		while(delay_ticks > UINT16_MAX)
+		{
+			playbackRecord hold = records.back(); //first row never has a delay
+			hold.delay_ticks = UINT16_MAX;
+			records.push_back(hold);
+			delay_ticks -= UINT16_MAX;
+		}
+
+		playbackRecord record;
+		record.delay_ticks = (uint16_t)delay_ticks;
+		record.cmdpwr_flags = (uint16_t)lroundf(value[TRACE_CMDPWR]) | ((value[TRACE_MAMODE2] != 0) ? PLAYBACK_FLAG_MAMODE2 : 0);
+		record.mamode1_counts = (uint8_t)lroundf(value[TRACE_MAMODE1]);
+		records.push_back(record);
+
+		previousTick = tick;
+	}
+
+	fclose(file);
+
+	if( (isValid == true) && records.empty() ) { fprintf(stderr, "%s: no data rows\n", path); isValid = false; }
+	if(isValid == false) { return false; }
+
+	records.back().cmdpwr_flags |= PLAYBACK_FLAG_END;
+	duration_ms = (uint32_t)((previousTick - firstTick) * PLAYBACK_TICK_us / 1000);
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void encodeRecord(const playbackRecord &record, uint8_t *bytes)
+{
+	bytes[0] = record.delay_ticks & 0xFF;
+	bytes[1] = record.delay_ticks >> 8;
+	bytes[2] = record.cmdpwr_flags & 0xFF;
+	bytes[3] = record.cmdpwr_flags >> 8;
+	bytes[4] = record.mamode1_counts;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//worst case serial load: bytes needed per second, over the fastest PLAYBACK_BUFFER_RECORDS records
+//above 100%, the generator will underrun no matter how the host sends them
+uint32_t peakLinkLoad_percent(const std::vector<playbackRecord> &records)
+{
+	uint32_t peak_percent = 0;
+	uint32_t windowTicks = 0;
+
+	for(size_t ii = 0; ii < records.size(); ii++)
+	{
+		windowTicks += records[ii].delay_ticks;
+		if(ii >= PLAYBACK_BUFFER_RECORDS) { windowTicks -= records[ii - PLAYBACK_BUFFER_RECORDS].delay_ticks; }
+		if(ii < PLAYBACK_BUFFER_RECORDS) { continue; } //buffer is full before playback starts
+
+		uint32_t bytesNeeded = PLAYBACK_BUFFER_RECORDS * PLAYBACK_RECORD_BYTES;
+		uint32_t bytesAvailable = (uint32_t)((uint64_t)windowTicks * PLAYBACK_TICK_us * SERIAL_BYTES_PER_SECOND / 1000000);
+		uint32_t load_percent = (bytesAvailable == 0) ? UINT32_MAX : (bytesNeeded * 100 / bytesAvailable);
+
+		if(load_percent > peak_percent) { peak_percent = load_percent; }
+	}
+
+	return peak_percent;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//longest the generator can take to grant the next credit: at worst, it applies every record it's been sent but hasn't credited
+uint32_t creditTimeout_ms(const std::vector<playbackRecord> &records, size_t numRecordsCredited, size_t numRecordsSent)
+{
+	uint64_t outstanding_ticks = 0;
+	for(size_t ii = numRecordsCredited; ii < numRecordsSent; ii++) { outstanding_ticks += records[ii].delay_ticks; }
+
+	return PLAYBACK_TIMEOUT_ms + (uint32_t)(outstanding_ticks * PLAYBACK_TICK_us / 1000);
+}
+
+//longest creditTimeout_ms() while streaming this trace (0: whole trace fits in generator's buffer)
+uint32_t longestCreditTimeout_ms(const std::vector<playbackRecord> &records)
+{
+	uint32_t longest_ms = 0;
+
+	for(size_t numRecordsCredited = 0; numRecordsCredited + PLAYBACK_BUFFER_RECORDS < records.size(); numRecordsCredited += PLAYBACK_CREDIT_RECORDS)
+	{
+		uint32_t timeout_ms = creditTimeout_ms(records, numRecordsCredited, numRecordsCredited + PLAYBACK_BUFFER_RECORDS);
+		if(timeout_ms > longest_ms) { longest_ms = timeout_ms; }
+	}
+
+	return longest_ms;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool configureSerialPort(int fileDescriptor)
+{
+	struct termios settings;
+
+	if(tcgetattr(fileDescriptor, &settings) != 0) { return false; }
+
+	cfmakeraw(&settings);
+	cfsetispeed(&settings, B115200);
+	cfsetospeed(&settings, B115200);
+	settings.c_cc[VMIN]  = 0;
+	settings.c_cc[VTIME] = 0;
+
+	return (tcsetattr(fileDescriptor, TCSANOW, &settings) == 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//appends received bytes to text (except credit characters, which are counted) //returns false on timeout
+bool receive(int fileDescriptor, uint32_t timeout_ms, std::string &text, uint32_t &numCredits)
+{
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET(fileDescriptor, &readSet);
+	struct timeval timeout = { (time_t)(timeout_ms / 1000), (suseconds_t)((timeout_ms % 1000) * 1000) };
+
+	if(select(fileDescriptor + 1, &readSet, NULL, NULL, &timeout) <= 0) { return false; }
+
+	char buffer[256];
+	ssize_t numBytesRead = read(fileDescriptor, buffer, sizeof(buffer));
+
+	for(ssize_t ii = 0; ii < numBytesRead; ii++)
+	{
+		if(buffer[ii] == PLAYBACK_CREDIT_CHARACTER) { numCredits++; }
+		else                                        { text += buffer[ii]; }
+	}
+
+	return (numBytesRead > 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns everything generator sent (except flow control), or empty string on error
+std::string stream(const char *port, const std::vector<playbackRecord> &records, uint32_t duration_ms)
+{
+	int fileDescriptor = open(port, O_RDWR | O_NOCTTY);
+	if(fileDescriptor < 0) { perror(port); return ""; }
+	if(configureSerialPort(fileDescriptor) == false) { fprintf(stderr, "%s: not a serial port\n", port); close(fileDescriptor); return ""; }
+
+	std::string text;
+	uint32_t numCredits = 0; //credit characters received
+
+	usleep(BOOTLOADER_WAIT_ms * 1000);
+	tcflush(fileDescriptor, TCIFLUSH);
+
+	const char startCommand[] = "$P\n";
+	if(write(fileDescriptor, startCommand, sizeof(startCommand) - 1) < 0) { perror("write"); close(fileDescriptor); return ""; }
+
+	while(text.find(PLAYBACK_READY_TEXT) == std::string::npos)
+	{
+		if(receive(fileDescriptor, READY_TIMEOUT_ms, text, numCredits) == false) { fprintf(stderr, "%s: generator didn't start playback\n", port); close(fileDescriptor); return ""; }
+	}
+	text.clear();
+
+	//send records as generator frees buffer space
+	size_t numRecordsSent = 0;
+	while(numRecordsSent < records.size())
+	{
+		size_t numRecordsAllowed = PLAYBACK_BUFFER_RECORDS + (size_t)numCredits * PLAYBACK_CREDIT_RECORDS;
+		std::vector<uint8_t> bytes;
+
+		while( (numRecordsSent < records.size()) && (numRecordsSent < numRecordsAllowed) )
+		{
+			uint8_t recordBytes[PLAYBACK_RECORD_BYTES];
+			encodeRecord(records[numRecordsSent++], recordBytes);
+			bytes.insert(bytes.end(), recordBytes, recordBytes + PLAYBACK_RECORD_BYTES);
+		}
+
+		if( (bytes.empty() == false) && (write(fileDescriptor, bytes.data(), bytes.size()) < 0) ) { perror("write"); close(fileDescriptor); return ""; }
+
+		uint32_t timeout_ms = creditTimeout_ms(records, (size_t)numCredits * PLAYBACK_CREDIT_RECORDS, numRecordsSent);
+		if( (numRecordsSent < records.size()) && (receive(fileDescriptor, timeout_ms, text, numCredits) == false) )
+		{
+			fprintf(stderr, "%s: generator stopped requesting records\n", port);
+			close(fileDescriptor);
+			return "";
+		}
+	}
+
+	//generator prints report once the last record is applied
+	uint32_t timeout_ms = duration_ms + REPORT_TIMEOUT_ms;
+	while(receive(fileDescriptor, timeout_ms, text, numCredits) == true)
+	{
+		if(text.find(PLAYBACK_DONE_TEXT) != std::string::npos) { timeout_ms = 100; } //rest of report line
+	}
+	close(fileDescriptor);
+
+	if(text.find(PLAYBACK_DONE_TEXT) == std::string::npos) { fprintf(stderr, "%s: no playback report\n", port); return ""; }
+
+	return text;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//nearest rank
+float percentile_ms(std::vector<uint32_t> samples_us, uint8_t percentile)
+{
+	std::sort(samples_us.begin(), samples_us.end());
+	size_t rank = (samples_us.size() * percentile + 99) / 100;
+
+	return samples_us[(rank > 0) ? (rank - 1) : 0] / 1000.0f;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//prints generator's report and latency summary, and writes responses CSV (if responsesPath isn't NULL)
+//returns number of underruns the generator reported, or -1 if there's no report
+long analyzeGeneratorText(const std::string &text, const std::vector<playbackRecord> &records, const char *responsesPath)
+{
+	FILE *responses = NULL;
+	if(responsesPath != NULL)
+	{
+		responses = fopen(responsesPath, "w");
+		if(responses == NULL) { fprintf(stderr, "can't open %s\n", responsesPath); return -1; }
+		fprintf(responses, "record,trace_ms,latency_ms,MCM_CMDPWR_percent,MCM_MAMODE1_percent,MCM_MAMODE2,settled\n");
+	}
+
+	//trace time of each record
+	std::vector<uint32_t> recordTicks;
+	uint32_t ticks = 0;
+	for(size_t ii = 0; ii < records.size(); ii++) { ticks += records[ii].delay_ticks; recordTicks.push_back(ticks); }
+
+	std::vector<uint32_t> latencies_us;
+	uint32_t numResponses = 0;
+	uint32_t numUnsettled = 0;
+
+	for(size_t position = text.find(PLAYBACK_RESPONSE_PREFIX); position != std::string::npos; position = text.find(PLAYBACK_RESPONSE_PREFIX, position + 1))
+	{
+		size_t lineEnd = text.find('\n', position);
+		if(lineEnd == std::string::npos) { break; } //incomplete line (report always follows)
+
+		char latency[16];
+		unsigned long record;
+		unsigned cmdpwr_permille, mamode1_permille, mamode2, isSettled;
+		std::string line = text.substr(position + strlen(PLAYBACK_RESPONSE_PREFIX), lineEnd - position - strlen(PLAYBACK_RESPONSE_PREFIX));
+
+		if( (sscanf(line.c_str(), "%lu,%15[^,],%u,%u,%u,%u", &record, latency, &cmdpwr_permille, &mamode1_permille, &mamode2, &isSettled) != 6) ||
+			(record >= records.size()) )
+		{
+			fprintf(stderr, "can't parse response '%s'\n", line.c_str());
+			continue;
+		}
+
+		numResponses++;
+		if(isSettled == 0) { numUnsettled++; }
+
+		bool isChanged = (strcmp(latency, "-") != 0);
+		if(isChanged) { latencies_us.push_back(strtoul(latency, NULL, 10)); }
+
+		if(responses != NULL)
+		{
+			fprintf(responses, "%lu,%.1f,", record, recordTicks[record] * PLAYBACK_TICK_us / 1000.0f);
+			if(isChanged) { fprintf(responses, "%.1f,", latencies_us.back() / 1000.0f); }
+			else          { fprintf(responses, "-,"); }
+			fprintf(responses, "%.1f,%.1f,%u,%u\n", cmdpwr_permille / 10.0f, mamode1_permille / 10.0f, mamode2, isSettled);
+		}
+	}
+
+	if(responses != NULL) { fclose(responses); }
+
+	size_t report = text.find(PLAYBACK_DONE_TEXT);
+	if(report == std::string::npos) { fprintf(stderr, "no playback report\n"); return -1; }
+
+	size_t reportEnd = text.find('\n', report + 1);
+	printf("%s\n", text.substr(report + 1, reportEnd - report - 1).c_str()); //skip leading newline
+
+	printf("responses: %u, outputs changed: %u, unsettled: %u", numResponses, (unsigned)latencies_us.size(), numUnsettled);
+	if(latencies_us.empty() == false) { printf(", latency p50: %.1f ms, p99: %.1f ms", percentile_ms(latencies_us, 50), percentile_ms(latencies_us, 99)); }
+	printf("\n");
+
+	size_t underruns = text.find("underruns: ", report);
+	if(underruns == std::string::npos) { return -1; }
+
+	return strtol(text.c_str() + underruns + strlen("underruns: "), NULL, 10);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+	const char *tracePath = NULL;
+	const char *port = NULL;
+	const char *encodePath = NULL;
+	const char *responsesPath = NULL;
+	const char *logPath = NULL;
+	const char *parsePath = NULL;
+
+	for(int ii = 1; ii < argc; ii++)
+	{
+		if     ( (strcmp(argv[ii], "--encode")    == 0) && (ii + 1 < argc) ) { encodePath = argv[++ii]; }
+		else if( (strcmp(argv[ii], "--responses") == 0) && (ii + 1 < argc) ) { responsesPath = argv[++ii]; }
+		else if( (strcmp(argv[ii], "--log")       == 0) && (ii + 1 < argc) ) { logPath = argv[++ii]; }
+		else if( (strcmp(argv[ii], "--parse")     == 0) && (ii + 1 < argc) ) { parsePath = argv[++ii]; }
+		else if( (argv[ii][0] != '-') && (tracePath == NULL) )               { tracePath = argv[ii]; }
+		else if( (argv[ii][0] != '-') && (port == NULL) )                    { port = argv[ii]; }
+		else { tracePath = NULL; break; }
+	}
+
+	if(tracePath == NULL)
+	{
+		fprintf(stderr, "usage: %s <trace.csv> [<serial port>] [--encode <out.bin>] [--responses <out.csv>] [--log <out.txt>] [--parse <log.txt>]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<playbackRecord> records;
+	uint32_t duration_ms = 0;
+	if(loadTrace(tracePath, records, duration_ms) == false) { return 1; }
+
+	uint32_t peakLoad_percent = peakLinkLoad_percent(records);
+	printf("%s: records: %u, duration_ms: %u, peak serial load: %u%%\n", tracePath, (unsigned)records.size(), duration_ms, peakLoad_percent);
+	if(peakLoad_percent > 100) { printf("warning: trace changes faster than 115200 baud can deliver (generator will underrun)\n"); }
+	if(records.size() > PLAYBACK_BUFFER_RECORDS) { printf("longest credit timeout: %u ms\n", longestCreditTimeout_ms(records)); }
+
+	if(encodePath != NULL)
+	{
+		FILE *file = fopen(encodePath, "wb");
+		if(file == NULL) { fprintf(stderr, "can't open %s\n", encodePath); return 1; }
+
+		for(size_t ii = 0; ii < records.size(); ii++)
+		{
+			uint8_t bytes[PLAYBACK_RECORD_BYTES];
+			encodeRecord(records[ii], bytes);
+			fwrite(bytes, 1, sizeof(bytes), file);
+		}
+		fclose(file);
+	}
+
+	std::string generatorText;
+
+	if(parsePath != NULL)
+	{
+		FILE *file = fopen(parsePath, "r");
+		if(file == NULL) { fprintf(stderr, "can't open %s\n", parsePath); return 1; }
+
+		int character;
+		while( (character = fgetc(file)) != EOF ) { generatorText += (char)character; }
+		fclose(file);
+	}
+	else if(port != NULL)
+	{
+		generatorText = stream(port, records, duration_ms);
+		if(generatorText.empty()) { return 1; }
+
+		if(logPath != NULL)
+		{
+			FILE *file = fopen(logPath, "w");
+			if(file == NULL) { fprintf(stderr, "can't open %s\n", logPath); return 1; }
+			fputs(generatorText.c_str(), file);
+			fclose(file);
+		}
+	}
+	else { return 0; } //trace check only
+
+	long numUnderruns = analyzeGeneratorText(generatorText, records, responsesPath);
+
+	return (numUnderruns == 0) ? 0 : 1;
+}
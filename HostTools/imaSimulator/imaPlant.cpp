@@ -0,0 +1,344 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//simple physical models... good enough to close the loop, not to predict fuel economy
+
+#include "muddersMIMA.h"
+#include "hostHardware.h"
+#include "imaPlant.h"
+#include <math.h>
+
+#define TICK_s 0.001f
+#define RPM_PER_RADPS (60.0f / (2.0f * (float)M_PI))
+
+const float gearRatio[6] = { 0.0f, 13.0f, 7.6f, 5.0f, 3.8f, 3.0f }; //overall (including final drive)
+
+imaDriver  driver  = { NO, NO, 0, NO, NO, 0, JOYSTICK_NEUTRAL_NOM_PERCENT, TOGGLE_POSITION1, NO };
+imaMetrics metrics = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+imaState   plant   = { 0, 0, NO, 0, MAMODE1_STATE_IS_UNDEFINED, 0, NO };
+
+float engine_radps = 0;
+float vehicle_mps = 0;
+bool  isAutostopped = NO;
+bool  wasMCM_faulted = NO;
+uint32_t keyOn_ms = 0;
+uint32_t plant_ms = 0;
+uint32_t clutchReleased_ms = 0;
+
+//RC filter outputs (percent at ADC pin)
+float filteredMAMODE1_percent = 0;
+float filteredCMDPWR_percent = 0;
+
+//keyON latency metrics
+extern bool isSleeping; //powerSave.cpp
+bool isWakeAfterKeyOnPending = NO;
+bool isMCMOutputAfterKeyOnPending = NO;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t percentToCounts(float percent)
+{
+	if(percent <   0) { percent =   0; }
+	if(percent > 100) { percent = 100; }
+
+	return (uint16_t)(percent * ADC_NUM_COUNTS_10b / 100.0f + 0.5f);
+}
+
+//same bands as LiControl's determineState_MAMODE1()
+uint8_t percentToMAMODE1state(float percent)
+{
+	if     (percent <  10) { return MAMODE1_STATE_IS_ERROR_LO; }
+	else if(percent <= 20) { return MAMODE1_STATE_IS_PRESTART; }
+	else if(percent <= 30) { return MAMODE1_STATE_IS_ASSIST;   }
+	else if(percent <= 40) { return MAMODE1_STATE_IS_REGEN;    }
+	else if(percent <= 60) { return MAMODE1_STATE_IS_IDLE;     }
+	else if(percent <= 75) { return MAMODE1_STATE_IS_AUTOSTOP; }
+	else if(percent <= 90) { return MAMODE1_STATE_IS_START;    }
+	else                   { return MAMODE1_STATE_IS_ERROR_HI; }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//ECM's IMA request, based on driver inputs & engine state
+void ecmModel(uint8_t *MAMODE1_counts, uint16_t *CMDPWR_counts, bool *MAMODE2)
+{
+	float engineRPM = engine_radps * RPM_PER_RADPS;
+	float speed_kph = vehicle_mps * 3.6f;
+
+	*MAMODE2 = MAMODE2_STATE_IS_REGEN_STANDBY;
+	*CMDPWR_counts = ECM_CMDPWR_COUNTS_NEUTRAL;
+
+	if(driver.key == NO)
+	{
+		*MAMODE1_counts = 0; //ECM unpowered
+		*CMDPWR_counts = 0;
+		isAutostopped = NO;
+		return;
+	}
+
+	if(plant.isEngineRunning == NO)
+	{
+		//autostop ends when driver releases brake
+		if( (isAutostopped == YES) && (driver.brake == NO) ) { isAutostopped = NO; driver.start = YES; }
+
+		if     (driver.start == YES)   { *MAMODE1_counts = ECM_MAMODE1_COUNTS_START;    }
+		else if(isAutostopped == YES)  { *MAMODE1_counts = ECM_MAMODE1_COUNTS_AUTOSTOP; }
+		else                           { *MAMODE1_counts = ECM_MAMODE1_COUNTS_PRESTART; }
+		return;
+	}
+
+	if( (speed_kph < ECM_AUTOSTOP_BELOW_SPEED_kph) && (driver.brake == YES) && ((driver.gear == 0) || (driver.clutch == YES)) &&
+		(driver.throttle_percent == 0) && ((plant_ms - keyOn_ms) > 10000) )
+	{
+		isAutostopped = YES;
+		plant.isEngineRunning = NO; //fuel cut
+		*MAMODE1_counts = ECM_MAMODE1_COUNTS_AUTOSTOP;
+	}
+	else if( (driver.throttle_percent >= ECM_ASSIST_ABOVE_THROTTLE_PERCENT) && (engineRPM > ECM_ASSIST_ABOVE_RPM) )
+	{
+		float assist_percent = (driver.throttle_percent - 50) * 2.0f;
+		if(assist_percent > 100) { assist_percent = 100; }
+
+		*MAMODE1_counts = ECM_MAMODE1_COUNTS_ASSIST;
+		*MAMODE2 = MAMODE2_STATE_IS_ASSIST;
+		*CMDPWR_counts = ECM_CMDPWR_COUNTS_NEUTRAL + (uint16_t)(assist_percent * ECM_CMDPWR_COUNTS_PER_PERCENT);
+	}
+	else if( (driver.throttle_percent == 0) && (engineRPM > ECM_REGEN_ABOVE_RPM) && (speed_kph > ECM_REGEN_ABOVE_SPEED_kph) &&
+			 (driver.clutch == NO) && (driver.gear != 0) )
+	{
+		float regen_percent = (driver.brake == YES) ? ECM_REGEN_BRAKING_PERCENT : ECM_REGEN_COAST_PERCENT;
+
+		*MAMODE1_counts = ECM_MAMODE1_COUNTS_REGEN;
+		*CMDPWR_counts = ECM_CMDPWR_COUNTS_NEUTRAL - (uint16_t)(regen_percent * ECM_CMDPWR_COUNTS_PER_PERCENT);
+	}
+	else { *MAMODE1_counts = ECM_MAMODE1_COUNTS_IDLE; }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//first order RC low pass filter, plus MOSFET rising edge delay (which LiControl corrects)
+float rcFilter(float filtered_percent, float duty_percent, uint8_t mosfetDelay_percent)
+{
+	if( (duty_percent > 0) && (duty_percent < 100) ) { duty_percent -= mosfetDelay_percent; }
+
+	return filtered_percent + (duty_percent - filtered_percent) * (1.0f / RC_FILTER_TAU_ms);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//MCM torque, based on LiControl's outputs
+float mcmModel(void)
+{
+	float MAMODE1_percent = hostHardware_getPWM(PIN_MAMODE1_MCM) * 100.0f / 255.0f;
+	float CMDPWR_percent  = hostHardware_getPWM(PIN_CMDPWR_MCM)  * 100.0f / 255.0f;
+	bool  MAMODE2 = hostHardware_getDigitalOutput(PIN_MAMODE2_MCM);
+	float engineRPM = engine_radps * RPM_PER_RADPS;
+	float torque_Nm = 0;
+
+	plant.mcmState = percentToMAMODE1state(MAMODE1_percent);
+
+	bool isFaulted = NO;
+	if( (driver.key == YES) && ((plant_ms - keyOn_ms) > 500) ) //MCM ignores signals while booting
+	{
+		if( (plant.mcmState == MAMODE1_STATE_IS_ERROR_LO) || (plant.mcmState == MAMODE1_STATE_IS_ERROR_HI) ) { isFaulted = YES; }
+		if( (plant.mcmState == MAMODE1_STATE_IS_ASSIST) && (MAMODE2 != MAMODE2_STATE_IS_ASSIST) )            { isFaulted = YES; }
+	}
+	if( (isFaulted == YES) && (wasMCM_faulted == NO) ) { metrics.mcmFaults++; }
+	wasMCM_faulted = isFaulted;
+
+	if( (driver.key == NO) || (isFaulted == YES) ) { return 0; }
+
+	if(plant.mcmState == MAMODE1_STATE_IS_ASSIST)
+	{
+		torque_Nm = MCM_ASSIST_TORQUE_MAX_Nm * (CMDPWR_percent - MCM_CMDPWR_NEUTRAL_PERCENT) / 40.0f;
+		if(torque_Nm < 0)                       { torque_Nm = 0; }
+		if(torque_Nm > MCM_ASSIST_TORQUE_MAX_Nm) { torque_Nm = MCM_ASSIST_TORQUE_MAX_Nm; }
+	}
+	else if( (plant.mcmState == MAMODE1_STATE_IS_REGEN) && (engineRPM > MCM_REGEN_ABOVE_rpm) )
+	{
+		torque_Nm = -MCM_REGEN_TORQUE_MAX_Nm * (MCM_CMDPWR_NEUTRAL_PERCENT - CMDPWR_percent) / 40.0f;
+		if(torque_Nm > 0)                        { torque_Nm = 0; }
+		if(torque_Nm < -MCM_REGEN_TORQUE_MAX_Nm) { torque_Nm = -MCM_REGEN_TORQUE_MAX_Nm; }
+	}
+	else if( (plant.mcmState == MAMODE1_STATE_IS_START) && (engineRPM < ECM_ENGINE_RUNNING_ABOVE_RPM + 200) ) { torque_Nm = MCM_CRANK_TORQUE_Nm; }
+
+	return torque_Nm;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void engineAndVehicleModel(float mcmTorque_Nm)
+{
+	float engineRPM = engine_radps * RPM_PER_RADPS;
+
+	float engineTorque_Nm = 0;
+	if(plant.isEngineRunning == YES)
+	{
+		if(engineRPM < ENGINE_FUEL_CUT_rpm) { engineTorque_Nm = ENGINE_TORQUE_MAX_Nm * driver.throttle_percent / 100.0f; }
+
+		float idleTorque_Nm = 0.2f * (ENGINE_IDLE_rpm + 100 - engineRPM); //idle air control
+		if(idleTorque_Nm < 0)  { idleTorque_Nm = 0;  }
+		if(idleTorque_Nm > 40) { idleTorque_Nm = 40; }
+		engineTorque_Nm += idleTorque_Nm;
+	}
+
+	float frictionTorque_Nm = (engine_radps > 0) ? (8.0f + 0.002f * engineRPM) : 0;
+	float engineNet_Nm = engineTorque_Nm + mcmTorque_Nm - frictionTorque_Nm;
+
+	float roadForce_N = 120.0f + 0.35f * vehicle_mps * vehicle_mps;
+	if( (driver.brake == YES) && (vehicle_mps > 0) ) { roadForce_N += VEHICLE_BRAKE_FORCE_N; }
+	if(vehicle_mps <= 0) { roadForce_N = 0; }
+
+	float ratio = gearRatio[driver.gear % 6];
+	float clutchCapacity_Nm = 0;
+	if( (ratio > 0) && (driver.clutch == NO) )
+	{
+		uint32_t engaged_ms = plant_ms - clutchReleased_ms;
+		clutchCapacity_Nm = (engaged_ms < CLUTCH_ENGAGE_ms) ? (CLUTCH_CAPACITY_Nm * engaged_ms / CLUTCH_ENGAGE_ms) : CLUTCH_CAPACITY_Nm;
+	}
+
+	if(clutchCapacity_Nm > 0)
+	{
+		float wheelAtEngine_radps = vehicle_mps / VEHICLE_TIRE_RADIUS_m * ratio;
+		float vehicleInertia_kgm2 = VEHICLE_MASS_kg * VEHICLE_TIRE_RADIUS_m * VEHICLE_TIRE_RADIUS_m / (ratio * ratio);
+		float vehicleNet_Nm = -roadForce_N * VEHICLE_TIRE_RADIUS_m / ratio;
+		float slip_radps = engine_radps - wheelAtEngine_radps;
+
+		float clutchTorque_Nm;
+		bool isLocked = NO;
+
+		if(fabsf(slip_radps) < 1.0f)
+		{
+			float alpha = (engineNet_Nm + vehicleNet_Nm) / (ENGINE_INERTIA_kgm2 + vehicleInertia_kgm2);
+			clutchTorque_Nm = engineNet_Nm - ENGINE_INERTIA_kgm2 * alpha;
+			if(fabsf(clutchTorque_Nm) <= clutchCapacity_Nm)
+			{
+				isLocked = YES;
+				engine_radps = wheelAtEngine_radps + alpha * TICK_s;
+				vehicle_mps = engine_radps * VEHICLE_TIRE_RADIUS_m / ratio;
+			}
+		}
+
+		if(isLocked == NO)
+		{
+			clutchTorque_Nm = (slip_radps > 0) ? clutchCapacity_Nm : -clutchCapacity_Nm;
+			engine_radps += (engineNet_Nm - clutchTorque_Nm) / ENGINE_INERTIA_kgm2 * TICK_s;
+			vehicle_mps  += (clutchTorque_Nm * ratio / VEHICLE_TIRE_RADIUS_m - roadForce_N) / VEHICLE_MASS_kg * TICK_s;
+
+			//clutch locks once speeds cross
+			float newSlip_radps = engine_radps - vehicle_mps / VEHICLE_TIRE_RADIUS_m * ratio;
+			if( (newSlip_radps > 0) != (slip_radps > 0) )
+			{
+				float common_radps = (ENGINE_INERTIA_kgm2 * engine_radps + vehicleInertia_kgm2 * vehicle_mps / VEHICLE_TIRE_RADIUS_m * ratio) / (ENGINE_INERTIA_kgm2 + vehicleInertia_kgm2);
+				engine_radps = common_radps;
+				vehicle_mps = common_radps * VEHICLE_TIRE_RADIUS_m / ratio;
+			}
+		}
+	}
+	else
+	{
+		engine_radps += engineNet_Nm / ENGINE_INERTIA_kgm2 * TICK_s;
+		vehicle_mps  -= roadForce_N / VEHICLE_MASS_kg * TICK_s;
+	}
+
+	if(engine_radps < 0) { engine_radps = 0; }
+	if(vehicle_mps  < 0) { vehicle_mps  = 0; }
+
+	engineRPM = engine_radps * RPM_PER_RADPS;
+
+	if( (plant.isEngineRunning == NO) && (driver.start == YES) && (engineRPM > ECM_ENGINE_RUNNING_ABOVE_RPM) )
+	{
+		plant.isEngineRunning = YES;
+		driver.start = NO;
+		metrics.engineStarts++;
+	}
+	else if( (plant.isEngineRunning == YES) && (engineRPM < ENGINE_STALL_BELOW_rpm) ) { plant.isEngineRunning = NO; } //stalled
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void imaPlant_tick(void)
+{
+	static bool key_previous = NO;
+	static bool clutch_previous = NO;
+
+	plant_ms++;
+
+	if( (driver.clutch == NO) && (clutch_previous == YES) ) { clutchReleased_ms = plant_ms; }
+	clutch_previous = driver.clutch;
+
+	if( (driver.key == YES) && (key_previous == NO) )
+	{
+		keyOn_ms = plant_ms;
+		isWakeAfterKeyOnPending = isSleeping;
+		isMCMOutputAfterKeyOnPending = YES;
+	}
+	if(driver.key == NO) { plant.isEngineRunning = NO; driver.start = NO; }
+	key_previous = driver.key;
+
+	//ECM outputs, through LiControl's input RC filters
+	uint8_t ecmMAMODE1_counts;
+	uint16_t ecmCMDPWR_counts;
+	bool ecmMAMODE2;
+	ecmModel(&ecmMAMODE1_counts, &ecmCMDPWR_counts, &ecmMAMODE2);
+	plant.ecmMAMODE1_counts = ecmMAMODE1_counts;
+
+	filteredMAMODE1_percent = rcFilter(filteredMAMODE1_percent, ecmMAMODE1_counts * 100.0f / 256.0f,  MOSFET_DELAY_MAMODE1_PERCENT);
+	filteredCMDPWR_percent  = rcFilter(filteredCMDPWR_percent,  ecmCMDPWR_counts  * 100.0f / 1024.0f, MOSFET_DELAY_CMDPWR_PERCENT);
+
+	hostHardware_setAnalogInput(PIN_MAMODE1_ECM, percentToCounts(filteredMAMODE1_percent));
+	hostHardware_setAnalogInput(PIN_CMDPWR_ECM,  percentToCounts(filteredCMDPWR_percent));
+	hostHardware_setDigitalInput(PIN_MAMODE2_ECM, ecmMAMODE2);
+
+	//driver
+	uint8_t joystick_percent = driver.joystick_percent;
+	#ifdef INVERT_JOYSTICK_DIRECTION
+		joystick_percent = 100 - joystick_percent;
+	#endif
+	hostHardware_setAnalogInput(PIN_USER_JOYSTICK, percentToCounts(joystick_percent));
+	hostHardware_setAnalogInput(PIN_THROTTLE,      percentToCounts(driver.throttle_percent));
+	hostHardware_setAnalogInput(PIN_MAP_SENSOR,    percentToCounts(30.0f + 0.6f * driver.throttle_percent));
+	hostHardware_setDigitalInput(PIN_BRAKE,          driver.brake);
+	hostHardware_setDigitalInput(PIN_CLUTCH,         driver.clutch);
+	hostHardware_setDigitalInput(PIN_USER_MOMENTARY, !driver.button);
+	hostHardware_setDigitalInput(PIN_USER_TOGGLE1,   driver.toggle & 0x01);
+	hostHardware_setDigitalInput(PIN_USER_TOGGLE2,   driver.toggle & 0x02);
+
+	//MCM & drivetrain
+	plant.mcmTorque_Nm = mcmModel();
+	engineAndVehicleModel(plant.mcmTorque_Nm);
+
+	if( (isWakeAfterKeyOnPending == YES) && (isSleeping == NO) ) { metrics.keyOnToWake_ms = plant_ms - keyOn_ms; isWakeAfterKeyOnPending = NO; }
+	if( (isMCMOutputAfterKeyOnPending == YES) && (plant.mcmState != MAMODE1_STATE_IS_ERROR_LO) && (plant.mcmState != MAMODE1_STATE_IS_ERROR_HI) )
+	{
+		metrics.keyOnToMCMOutput_ms = plant_ms - keyOn_ms;
+		isMCMOutputAfterKeyOnPending = NO;
+	}
+
+	plant.engineRPM = engine_radps * RPM_PER_RADPS;
+	plant.vehicleSpeed_kph = vehicle_mps * 3.6f;
+	hostHardware_setTachometer_rpm( (plant.engineRPM > 50) ? (uint16_t)plant.engineRPM : 0 );
+
+	if(hostHardware_getPinMode(PIN_BRAKE) == OUTPUT) { plant.areBrakeLightsOn = (hostHardware_getPWM(PIN_BRAKE) > 0); }
+	else                                             { plant.areBrakeLightsOn = driver.brake; }
+
+	//metrics
+	if(plant.engineRPM        > metrics.engineRPM_max)        { metrics.engineRPM_max        = plant.engineRPM;        }
+	if(plant.vehicleSpeed_kph > metrics.vehicleSpeed_max_kph) { metrics.vehicleSpeed_max_kph = plant.vehicleSpeed_kph; }
+	if(plant.engineRPM > ENGINE_FUEL_CUT_rpm) { metrics.overRedline_ms++; }
+	if( (plant.mcmTorque_Nm > 0) && (plant.mcmState == MAMODE1_STATE_IS_ASSIST) )
+	{
+		metrics.assist_ms++;
+		metrics.assistEnergy_kJ += plant.mcmTorque_Nm * engine_radps * TICK_s / 1000.0f;
+		if(plant.engineRPM > metrics.assistRPM_max) { metrics.assistRPM_max = plant.engineRPM; }
+		if(driver.clutch == YES) { metrics.assistClutchPressed_ms++; }
+	}
+	if(plant.mcmTorque_Nm < 0) { metrics.regen_ms++;  metrics.regenEnergy_kJ  -= plant.mcmTorque_Nm * engine_radps * TICK_s / 1000.0f; }
+	if(isAutostopped == YES)          { metrics.autostop_ms++;    }
+	if(plant.areBrakeLightsOn == YES) { metrics.brakeLights_ms++; }
+	if(hostHardware_isAsleep() == YES) { metrics.asleep_ms++;      }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void imaPlant_begin(void) { hostHardware_setTickCallback_1ms(imaPlant_tick); }
@@ -0,0 +1,106 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//closed loop model of everything connected to LiControl: driver, ECM, RC filters, MCM, engine & vehicle
+//imaPlant_tick() runs once per simulated millisecond (see hostHardware_setTickCallback_1ms())
+
+#ifndef imaPlant_h
+	#define imaPlant_h
+
+	#include <stdint.h>
+
+	//ECM PWM outputs (same counts as "HardwareInLoop Testing/ECM_IMA_Signals.ino")
+	#define ECM_MAMODE1_COUNTS_PRESTART  38 //8b //15%
+	#define ECM_MAMODE1_COUNTS_ASSIST    64 //25%
+	#define ECM_MAMODE1_COUNTS_REGEN     90 //35%
+	#define ECM_MAMODE1_COUNTS_IDLE     127 //50%
+	#define ECM_MAMODE1_COUNTS_AUTOSTOP 179 //70%
+	#define ECM_MAMODE1_COUNTS_START    218 //85%
+	#define ECM_CMDPWR_COUNTS_NEUTRAL   511 //10b //assist/regen add/subtract 4.1 counts per percent
+	#define ECM_CMDPWR_COUNTS_PER_PERCENT 4.1
+
+	#define ECM_ASSIST_ABOVE_THROTTLE_PERCENT 60
+	#define ECM_ASSIST_ABOVE_RPM            1000
+	#define ECM_REGEN_ABOVE_RPM             1100
+	#define ECM_REGEN_ABOVE_SPEED_kph         15
+	#define ECM_REGEN_COAST_PERCENT           20
+	#define ECM_REGEN_BRAKING_PERCENT         60
+	#define ECM_AUTOSTOP_BELOW_SPEED_kph       2
+	#define ECM_ENGINE_RUNNING_ABOVE_RPM     800 //START ends
+
+	#define RC_FILTER_TAU_ms                  10 //ECM PWM to LiControl ADC
+	#define MOSFET_DELAY_MAMODE1_PERCENT       3 //see ADC_HARDWARE_CORRECTION_xxx
+	#define MOSFET_DELAY_CMDPWR_PERCENT        1
+
+	#define ENGINE_INERTIA_kgm2             0.15
+	#define ENGINE_TORQUE_MAX_Nm            90.0
+	#define ENGINE_IDLE_rpm                  900
+	#define ENGINE_FUEL_CUT_rpm             6000 //engine's own rev limiter
+	#define ENGINE_STALL_BELOW_rpm           400
+
+	#define MCM_ASSIST_TORQUE_MAX_Nm        50.0
+	#define MCM_REGEN_TORQUE_MAX_Nm         40.0
+	#define MCM_CRANK_TORQUE_Nm             60.0
+	#define MCM_REGEN_ABOVE_rpm             1000
+
+	#define VEHICLE_MASS_kg                  950
+	#define VEHICLE_TIRE_RADIUS_m           0.28
+	#define VEHICLE_BRAKE_FORCE_N           4000
+	#define CLUTCH_CAPACITY_Nm               200
+	#define CLUTCH_ENGAGE_ms                 800 //driver slips clutch this long after releasing pedal
+
+	//driver inputs (set by scenario script)
+	struct imaDriver
+	{
+		bool    key;      //key ON
+		bool    start;    //crank request (cleared once engine runs)
+		uint8_t throttle_percent;
+		bool    brake;
+		bool    clutch;   //pedal pressed
+		uint8_t gear;     //0: neutral //1:5
+		uint8_t joystick_percent;
+		uint8_t toggle;   //gpio_getButton_toggle() value
+		bool    button;
+	};
+
+	//accumulated over the whole run
+	struct imaMetrics
+	{
+		float    engineRPM_max;
+		float    vehicleSpeed_max_kph;
+		uint32_t overRedline_ms;  //engine above ENGINE_FUEL_CUT_rpm
+		uint32_t assist_ms;       //MCM producing assist torque
+		float    assistRPM_max;   //highest engine RPM while MCM produced assist torque
+		uint32_t assistClutchPressed_ms;
+		uint32_t regen_ms;        //MCM producing regen torque
+		uint32_t autostop_ms;     //ECM requesting autostop
+		uint32_t brakeLights_ms;
+		uint32_t engineStarts;
+		uint32_t mcmFaults;       //MCM saw invalid MAMODE1/MAMODE2 while key ON (IMA light)
+		float    assistEnergy_kJ;
+		float    regenEnergy_kJ;
+		uint32_t asleep_ms;           //LiControl powered down (see powerSave.h)
+		uint32_t keyOnToWake_ms;      //latest keyON (while asleep) until LiControl woke
+		uint32_t keyOnToMCMOutput_ms; //latest keyON until LiControl first drove a valid MAMODE1 to the MCM
+	};
+
+	//instantaneous plant state (for trace output)
+	struct imaState
+	{
+		float   engineRPM;
+		float   vehicleSpeed_kph;
+		bool    isEngineRunning;
+		uint8_t ecmMAMODE1_counts;
+		uint8_t mcmState;         //MAMODE1_STATE_IS_xxx decoded from LiControl's output
+		float   mcmTorque_Nm;     //+assist, -regen
+		bool    areBrakeLightsOn;
+	};
+
+	extern imaDriver  driver;
+	extern imaMetrics metrics;
+	extern imaState   plant;
+
+	void imaPlant_begin(void); //registers imaPlant_tick() with hostHardware
+	void imaPlant_tick(void);
+
+#endif
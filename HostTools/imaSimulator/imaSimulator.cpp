@@ -0,0 +1,336 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//runs the firmware (host build) in closed loop with imaPlant, following a scenario script
+//usage: imaSimulator <scenario.txt> [--set NAME=VALUE]... [--trace <out.csv>]
+//--set:   same as typing '$SET=NAME=VALUE' before the scenario starts (e.g. parameter sweeps from a shell loop)
+//--trace: writes plant & firmware state every 10 ms
+//prints all metrics when done, then returns 1 if any scenario check failed
+
+//scenario script format (one statement per line, '#' starts a comment):
+//  set NAME=VALUE               : firmware parameter (same as '--set')
+//  <time_ms> name=value ...     : driver inputs at time_ms (held until changed)
+//                                 names: key start throttle brake clutch gear joystick toggle button
+//  <time_ms> end                : scenario duration
+//  check <metric> <op> <value>  : evaluated at end //op: < <= > >= ==
+
+#include "muddersMIMA.h"
+#include "hostHardware.h"
+#include "imaPlant.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define TRACE_PERIOD_ms 10
+#define LOOPS_PER_SETUP_COMMAND 5
+
+struct scenarioEvent
+{
+	uint32_t time_ms;
+	std::string name;
+	uint32_t value;
+};
+
+struct scenarioCheck
+{
+	std::string metric;
+	std::string op;
+	float value;
+	uint32_t lineNumber;
+};
+
+std::vector<scenarioEvent> events;
+std::vector<scenarioCheck> checks;
+std::vector<std::string> setupCommands;
+uint32_t scenarioEnd_ms = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+struct driverInputName { const char *name; void (*set)(uint32_t value); };
+
+const driverInputName driverInputs[] = {
+	{ "key",      [](uint32_t value) { driver.key = (value != 0);                } },
+	{ "start",    [](uint32_t value) { driver.start = (value != 0);              } },
+	{ "throttle", [](uint32_t value) { driver.throttle_percent = (uint8_t)value; } },
+	{ "brake",    [](uint32_t value) { driver.brake = (value != 0);              } },
+	{ "clutch",   [](uint32_t value) { driver.clutch = (value != 0);             } },
+	{ "gear",     [](uint32_t value) { driver.gear = (uint8_t)value;             } },
+	{ "joystick", [](uint32_t value) { driver.joystick_percent = (uint8_t)value; } },
+	{ "toggle",   [](uint32_t value) { driver.toggle = (uint8_t)value;           } },
+	{ "button",   [](uint32_t value) { driver.button = (value != 0);             } } };
+
+#define NUM_DRIVER_INPUTS (sizeof(driverInputs) / sizeof(driverInputs[0]))
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns metric value, or NAN if unknown
+float getMetric(const std::string &name)
+{
+	if(name == "engineRPM_max")        { return metrics.engineRPM_max;        }
+	if(name == "vehicleSpeed_max_kph") { return metrics.vehicleSpeed_max_kph; }
+	if(name == "overRedline_ms")       { return metrics.overRedline_ms;       }
+	if(name == "assist_ms")            { return metrics.assist_ms;            }
+	if(name == "assistRPM_max")        { return metrics.assistRPM_max;        }
+	if(name == "assistClutchPressed_ms") { return metrics.assistClutchPressed_ms; }
+	if(name == "regen_ms")             { return metrics.regen_ms;             }
+	if(name == "autostop_ms")          { return metrics.autostop_ms;          }
+	if(name == "brakeLights_ms")       { return metrics.brakeLights_ms;       }
+	if(name == "engineStarts")         { return metrics.engineStarts;         }
+	if(name == "mcmFaults")            { return metrics.mcmFaults;            }
+	if(name == "assistEnergy_kJ")      { return metrics.assistEnergy_kJ;      }
+	if(name == "regenEnergy_kJ")       { return metrics.regenEnergy_kJ;       }
+	if(name == "asleep_ms")            { return metrics.asleep_ms;            }
+	if(name == "keyOnToWake_ms")       { return metrics.keyOnToWake_ms;       }
+	if(name == "keyOnToMCMOutput_ms")  { return metrics.keyOnToMCMOutput_ms;  }
+	if(name == "engineRPM")            { return plant.engineRPM;              } //final values
+	if(name == "vehicleSpeed_kph")     { return plant.vehicleSpeed_kph;       }
+	if(name == "isEngineRunning")      { return plant.isEngineRunning;        }
+
+	return NAN;
+}
+
+const char * const metricNames[] = { "engineRPM_max", "vehicleSpeed_max_kph", "overRedline_ms", "assist_ms", "assistRPM_max", "assistClutchPressed_ms", "regen_ms", "autostop_ms",
+	"brakeLights_ms", "engineStarts", "mcmFaults", "assistEnergy_kJ", "regenEnergy_kJ", "asleep_ms", "keyOnToWake_ms", "keyOnToMCMOutput_ms", "engineRPM", "vehicleSpeed_kph",
+	"isEngineRunning" };
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> splitWords(const std::string &line)
+{
+	std::vector<std::string> words;
+	std::string word;
+
+	for(size_t ii = 0; ii <= line.size(); ii++)
+	{
+		char character = (ii < line.size()) ? line[ii] : ' ';
+
+		if(character == '#') { character = ' '; ii = line.size(); } //rest of line is a comment
+
+		if( (character == ' ') || (character == '\t') || (character == '\r') )
+		{
+			if(word.empty() == false) { words.push_back(word); word.clear(); }
+		}
+		else { word += character; }
+	}
+
+	return words;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns false on syntax error
+bool loadScenario(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if(file == NULL) { fprintf(stderr, "can't open %s\n", path); return false; }
+
+	char buffer[256];
+	uint32_t lineNumber = 0;
+	uint32_t previous_ms = 0;
+	bool isValid = true;
+
+	while( (isValid == true) && (fgets(buffer, sizeof(buffer), file) != NULL) )
+	{
+		lineNumber++;
+		std::vector<std::string> words = splitWords(std::string(buffer, strcspn(buffer, "\n")));
+
+		if(words.empty()) { continue; }
+
+		if( (words[0] == "set") && (words.size() == 2) ) { setupCommands.push_back("$SET=" + words[1]); }
+		else if( (words[0] == "check") && (words.size() == 4) )
+		{
+			scenarioCheck check = { words[1], words[2], strtof(words[3].c_str(), NULL), lineNumber };
+			if(isnan(getMetric(check.metric))) { fprintf(stderr, "%s:%u: unknown metric '%s'\n", path, lineNumber, words[1].c_str()); isValid = false; }
+			checks.push_back(check);
+		}
+		else if(isdigit((unsigned char)words[0][0]))
+		{
+			uint32_t time_ms = strtoul(words[0].c_str(), NULL, 10);
+			if(time_ms < previous_ms) { fprintf(stderr, "%s:%u: time must not decrease\n", path, lineNumber); isValid = false; }
+			previous_ms = time_ms;
+			if(time_ms > scenarioEnd_ms) { scenarioEnd_ms = time_ms; }
+
+			for(size_t ii = 1; ii < words.size(); ii++)
+			{
+				if(words[ii] == "end") { continue; }
+
+				size_t equals = words[ii].find('=');
+				std::string name = words[ii].substr(0, equals);
+
+				bool isKnown = false;
+				for(size_t jj = 0; jj < NUM_DRIVER_INPUTS; jj++) { if(name == driverInputs[jj].name) { isKnown = true; } }
+
+				if( (equals == std::string::npos) || (isKnown == false) )
+				{
+					fprintf(stderr, "%s:%u: expected name=value, got '%s'\n", path, lineNumber, words[ii].c_str());
+					isValid = false;
+				}
+				else
+				{
+					scenarioEvent event = { time_ms, name, (uint32_t)strtoul(words[ii].c_str() + equals + 1, NULL, 10) };
+					events.push_back(event);
+				}
+			}
+		}
+		else { fprintf(stderr, "%s:%u: can't parse '%s'\n", path, lineNumber, words[0].c_str()); isValid = false; }
+	}
+
+	fclose(file);
+	return isValid;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void applyEvent(const scenarioEvent &event)
+{
+	for(size_t ii = 0; ii < NUM_DRIVER_INPUTS; ii++)
+	{
+		if(event.name == driverInputs[ii].name) { driverInputs[ii].set(event.value); }
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns true if check passes
+bool evaluateCheck(const scenarioCheck &check)
+{
+	float actual = getMetric(check.metric);
+
+	if(check.op == "<" ) { return (actual <  check.value); }
+	if(check.op == "<=") { return (actual <= check.value); }
+	if(check.op == ">" ) { return (actual >  check.value); }
+	if(check.op == ">=") { return (actual >= check.value); }
+	if(check.op == "==") { return (actual == check.value); }
+
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const char *scenarioPath = NULL;
+FILE *traceFile = NULL;
+uint32_t numLoops = 0;
+
+//prints all metrics & any failed checks //returns program's exit code
+int finishScenario(void)
+{
+	if(traceFile != NULL) { fclose(traceFile); }
+
+	for(size_t ii = 0; ii < sizeof(metricNames) / sizeof(metricNames[0]); ii++) { printf("%s=%g\n", metricNames[ii], getMetric(metricNames[ii])); }
+	fprintf(stderr, "%s: %u ms, %u loops\n", scenarioPath, scenarioEnd_ms, numLoops);
+
+	int numFailed = 0;
+	for(size_t ii = 0; ii < checks.size(); ii++)
+	{
+		if(evaluateCheck(checks[ii]) == false)
+		{
+			printf("FAILED %s:%u: %s %s %g (actual %g)\n", scenarioPath, checks[ii].lineNumber, checks[ii].metric.c_str(),
+				checks[ii].op.c_str(), checks[ii].value, getMetric(checks[ii].metric));
+			numFailed++;
+		}
+	}
+
+	return (numFailed == 0) ? 0 : 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool isScenarioRunning = NO;
+uint32_t scenarioStart_ms = 0;
+size_t nextEventIndex = 0;
+
+uint32_t scenario_ms_get(void) { return hostHardware_getTime_us() / 1000 - scenarioStart_ms; }
+
+//applies every event that's due
+void applyDueEvents(void)
+{
+	uint32_t scenario_ms = scenario_ms_get();
+	while( (nextEventIndex < events.size()) && (events[nextEventIndex].time_ms <= scenario_ms) ) { applyEvent(events[nextEventIndex++]); }
+}
+
+//loop() doesn't return while the firmware is asleep (see powerSave.h), so the driver keeps acting from here
+void scenarioTick(void)
+{
+	if( (isScenarioRunning == YES) && (hostHardware_isAsleep() == YES) )
+	{
+		if(scenario_ms_get() > scenarioEnd_ms) { exit(finishScenario()); }
+		applyDueEvents();
+	}
+
+	imaPlant_tick();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+	const char *tracePath = NULL;
+	std::vector<std::string> commandLineSets;
+
+	for(int ii = 1; ii < argc; ii++)
+	{
+		if     ( (strcmp(argv[ii], "--set")   == 0) && (ii + 1 < argc) ) { commandLineSets.push_back(std::string("$SET=") + argv[++ii]); }
+		else if( (strcmp(argv[ii], "--trace") == 0) && (ii + 1 < argc) ) { tracePath = argv[++ii]; }
+		else if( (argv[ii][0] != '-') && (scenarioPath == NULL) )        { scenarioPath = argv[ii]; }
+		else { scenarioPath = NULL; break; }
+	}
+
+	if(scenarioPath == NULL)
+	{
+		fprintf(stderr, "usage: %s <scenario.txt> [--set NAME=VALUE]... [--trace <out.csv>]\n", argv[0]);
+		return 1;
+	}
+
+	if(loadScenario(scenarioPath) == false) { return 1; }
+	setupCommands.insert(setupCommands.end(), commandLineSets.begin(), commandLineSets.end()); //command line wins
+
+	if(tracePath != NULL)
+	{
+		traceFile = fopen(tracePath, "w");
+		if(traceFile == NULL) { fprintf(stderr, "can't open %s\n", tracePath); return 1; }
+		fprintf(traceFile, "time_ms,key,throttle_percent,gear,clutch,brake,joystick_percent,ECM_MAMODE1_counts,MCM_state,MCM_torque_Nm,"
+		                   "engineRPM,LiControl_RPM,vehicleSpeed_kph,brakeLights\n");
+	}
+
+	imaPlant_begin();
+	hostHardware_setTickCallback_1ms(scenarioTick);
+	setup();
+
+	//key is still OFF
+	for(size_t ii = 0; ii < setupCommands.size(); ii++)
+	{
+		hostHardware_serialInput((setupCommands[ii] + "\n").c_str());
+		for(uint8_t jj = 0; jj < LOOPS_PER_SETUP_COMMAND; jj++) { loop(); }
+
+		const char *response = strstr(hostHardware_serialOutput_get(), "Error");
+		if(response != NULL) { fprintf(stderr, "%s: %.60s\n", setupCommands[ii].c_str(), response); return 1; }
+		hostHardware_serialOutput_clear();
+	}
+
+	scenarioStart_ms = hostHardware_getTime_us() / 1000;
+	isScenarioRunning = YES;
+	uint32_t nextTrace_ms = 0;
+
+	while(true)
+	{
+		uint32_t scenario_ms = scenario_ms_get();
+		if(scenario_ms > scenarioEnd_ms) { break; }
+
+		applyDueEvents();
+
+		loop();
+		numLoops++;
+		hostHardware_serialOutput_clear(); //debug text isn't used
+
+		if( (traceFile != NULL) && (scenario_ms >= nextTrace_ms) )
+		{
+			fprintf(traceFile, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%.1f,%.0f,%u,%.1f,%u\n", scenario_ms,
+				driver.key, driver.throttle_percent, driver.gear, driver.clutch, driver.brake, driver.joystick_percent,
+				plant.ecmMAMODE1_counts, plant.mcmState, plant.mcmTorque_Nm, plant.engineRPM, engineSignals_getLatestRPM(),
+				plant.vehicleSpeed_kph, plant.areBrakeLightsOn);
+			nextTrace_ms = scenario_ms - (scenario_ms % TRACE_PERIOD_ms) + TRACE_PERIOD_ms;
+		}
+	}
+
+	return finishScenario();
+}
\ No newline at end of file
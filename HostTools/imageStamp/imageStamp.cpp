@@ -0,0 +1,95 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//stamps the firmware image's CRC into its header (../../muddersMIMA_firmware/imageCheck.h), so LiControl can check its own flash at boot
+//usage: imageStamp <firmware.hex> [<stamped.hex>]
+//without an output file, only prints the header's version and the image's CRC (e.g. to compare against what '$HELP' reports)
+//returns 1 if the header isn't found, or the input is already stamped with a different CRC
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "crc16.h"
+#include "intelHex.h"
+#include "../../muddersMIMA_firmware/imageCheck.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns header's offset in image, or -1 if it isn't found exactly once
+long findHeader(const std::vector<uint8_t> &image)
+{
+	long headerOffset = -1;
+
+	for(size_t ii = 0; ii + sizeof(imageCheck_header) <= image.size(); ii++)
+	{
+		if(memcmp(&image[ii], IMAGECHECK_MAGIC, IMAGECHECK_MAGIC_BYTES) != 0) { continue; }
+
+		if(headerOffset >= 0) { fprintf(stderr, "image header magic found twice (0x%04lX & 0x%04X)\n", headerOffset, (unsigned)ii); return -1; }
+		headerOffset = (long)ii;
+	}
+
+	if(headerOffset < 0) { fprintf(stderr, "image header not found (is imageCheck.cpp in this build?)\n"); }
+
+	return headerOffset;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+	if( (argc < 2) || (argc > 3) )
+	{
+		fprintf(stderr, "usage: %s <firmware.hex> [<stamped.hex>]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<uint8_t> image;
+	if(intelHex_load(argv[1], image, 0x10000, "the end of the 328p's flash") == false) { return 1; }
+
+	long headerOffset = findHeader(image);
+	if(headerOffset < 0) { return 1; }
+
+	imageCheck_header header;
+	memcpy(&header, &image[headerOffset], sizeof(header));
+	header.version[IMAGECHECK_VERSION_BYTES - 1] = 0;
+
+	size_t crcFieldOffset = headerOffset + offsetof(struct imageCheck_header, crc);
+	uint16_t stampedCRC = image[crcFieldOffset] | (image[crcFieldOffset + 1] << 8);
+
+	//same bytes as imageCheck_handler()
+	uint16_t crc = IMAGECHECK_CRC_INITIAL_VALUE;
+	for(size_t ii = 0; ii < image.size(); ii++)
+	{
+		if( (ii - crcFieldOffset) >= sizeof(header.crc) ) { crc = crc_ccitt_update(crc, image[ii]); }
+	}
+
+	printf("%s: version: %s, size: %u bytes, CRC: 0x%04X", argv[1], header.version, (unsigned)image.size(), crc);
+
+	if(stampedCRC == IMAGECHECK_CRC_UNSTAMPED) { printf(" (unstamped)\n"); }
+	else if(stampedCRC == crc)                 { printf(" (stamped)\n"); }
+	else
+	{
+		printf("\nerror: stamped CRC is 0x%04X (image was modified after stamping)\n", stampedCRC);
+		return 1;
+	}
+
+	if(argc == 2) { return 0; } //report only
+
+	if(crc == IMAGECHECK_CRC_UNSTAMPED)
+	{
+		fprintf(stderr, "error: CRC equals IMAGECHECK_CRC_UNSTAMPED, so LiControl can't tell it's stamped (change BUILD_DATE and rebuild)\n");
+		return 1;
+	}
+
+	image[crcFieldOffset]     = crc & 0xFF;
+	image[crcFieldOffset + 1] = crc >> 8;
+
+	if(intelHex_save(argv[2], image) == false) { return 1; }
+	printf("stamped: %s\n", argv[2]);
+
+	return 0;
+}
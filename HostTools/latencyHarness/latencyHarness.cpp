@@ -0,0 +1,286 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//measures input->output latency in each toggle position, using step inputs into the firmware's host build
+//usage: latencyHarness [--steps N] [--limit <ms>]
+//--steps: steps per input, in each direction (default 20)
+//--limit: return 1 if any input's settled p99 latency exceeds this (default: no limit)
+//prints one CSV row per mode & input, then the firmware's own histogram ('$LAT')
+
+//each step starts at a different millisecond within the loop period, so the loop phase is sampled evenly
+//latency is measured from the step, to when LiControl's MCM outputs actually change:
+//-first:   first MCM output change
+//-settled: last MCM output change before the next step (ECM inputs pass through an RC filter, so outputs ramp)
+//both include one PWM period (worst case wait until the new duty cycle reaches the pin)
+//steps that never change any MCM output (e.g. joystick in OEM mode) are counted as 'noResponse' and excluded from percentiles
+
+#include "muddersMIMA.h"
+#include "hostHardware.h"
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define STEPS_DEFAULT       20
+#define STEP_HOLD_ms       400 //outputs must settle within this time
+#define MODE_SETTLE_ms     500 //after toggle changes
+#define RC_FILTER_TAU_ms    10 //ECM PWM to LiControl ADC (same as ../imaSimulator)
+#define ENGINE_RPM        3000 //below AfterEffect's derate RPM
+
+//worst case time from analogWrite() until the new duty cycle starts (see hal_pwmTimers_begin())
+#define PWM_PERIOD_CMDPWR_us   500 //D9: 2 kHz
+#define PWM_PERIOD_MAMODE1_us   32 //D3: 31.4 kHz
+
+#define STRINGIFY(name) #name
+#define MODE_NAME(name) STRINGIFY(name)
+
+#define STEP_INPUT_ECM_CMDPWR  0 //while ECM requests assist
+#define STEP_INPUT_ECM_MAMODE1 1 //idle -> assist
+#define STEP_INPUT_JOYSTICK    2 //neutral -> assist
+#define NUM_STEP_INPUTS        3
+
+const char * const stepInputNames[NUM_STEP_INPUTS] = { "ECM_CMDPWR", "ECM_MAMODE1", "joystick" };
+
+//input percentages (as LiControl reports them) before & after each step
+struct harnessInputs { uint8_t ecmMAMODE1_percent; uint8_t ecmCMDPWR_percent; uint8_t joystick_percent; };
+
+const harnessInputs stepFrom[NUM_STEP_INPUTS] = { { 25, 50, 50 }, { 50, 50, 50 }, { 50, 50, 50 } };
+const harnessInputs stepTo  [NUM_STEP_INPUTS] = { { 25, 70, 50 }, { 25, 50, 50 }, { 50, 50, 75 } };
+
+struct toggleMode { uint8_t toggle; const char *name; }; //toggle is gpio_getButton_toggle() value
+
+const toggleMode toggleModes[] = {
+	{ TOGGLE_POSITION0, MODE_NAME(MODE0_BEHAVIOR) },
+	{ TOGGLE_POSITION1, MODE_NAME(MODE1_BEHAVIOR) },
+	{ TOGGLE_POSITION2, MODE_NAME(MODE2_BEHAVIOR) } };
+
+#define NUM_TOGGLE_MODES (sizeof(toggleModes) / sizeof(toggleModes[0]))
+
+//updated by tick callback
+harnessInputs target = stepFrom[0];
+float filteredMAMODE1_percent = 50;
+float filteredCMDPWR_percent = 50;
+bool isStepPending = NO;
+uint32_t stepAt_ms = 0;
+uint32_t stepApplied_us = 0;
+harnessInputs stepTarget;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//ADC counts that adc_read10bValue_Percent() converts back to 'percent' //same as ../traceReplay
+uint16_t percentToCounts(uint32_t percent)
+{
+	if(percent >= 100) { return ADC_NUM_COUNTS_10b; }
+
+	return (uint16_t)((percent * ADC_NUM_COUNTS_10b + 99) / 100);
+}
+
+//undo hardware correction that adc.cpp adds
+uint32_t removeCorrection(uint32_t percent, uint8_t correction)
+{
+	if( (percent == 0) || (percent >= 100) ) { return percent; }
+	if(percent <= correction)               { return 1;       }
+
+	return percent - correction;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//runs once per simulated millisecond
+void harness_tick(void)
+{
+	if( (isStepPending == YES) && ((hostHardware_getTime_us() / 1000) >= stepAt_ms) )
+	{
+		target = stepTarget;
+		stepApplied_us = hostHardware_getTime_us();
+		isStepPending = NO;
+	}
+
+	filteredMAMODE1_percent += (target.ecmMAMODE1_percent - filteredMAMODE1_percent) * (1.0f / RC_FILTER_TAU_ms);
+	filteredCMDPWR_percent  += (target.ecmCMDPWR_percent  - filteredCMDPWR_percent ) * (1.0f / RC_FILTER_TAU_ms);
+
+	uint32_t joystick_percent = target.joystick_percent;
+	#ifdef INVERT_JOYSTICK_DIRECTION
+		joystick_percent = 100 - joystick_percent;
+	#endif
+
+	hostHardware_setAnalogInput(PIN_USER_JOYSTICK, percentToCounts(joystick_percent)); //no RC filter
+	hostHardware_setAnalogInput(PIN_MAMODE1_ECM, percentToCounts(removeCorrection((uint32_t)lroundf(filteredMAMODE1_percent), ADC_HARDWARE_CORRECTION_MAMODE1_PERCENT)));
+	hostHardware_setAnalogInput(PIN_CMDPWR_ECM,  percentToCounts(removeCorrection((uint32_t)lroundf(filteredCMDPWR_percent),  ADC_HARDWARE_CORRECTION_CMDPWR_PERCENT)));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//output change time, plus worst case wait for that pin's next PWM period
+struct outputPin { uint8_t pin; uint32_t pwmPeriod_us; };
+
+const outputPin outputPins[] = { { PIN_CMDPWR_MCM, PWM_PERIOD_CMDPWR_us }, { PIN_MAMODE1_MCM, PWM_PERIOD_MAMODE1_us }, { PIN_MAMODE2_MCM, 0 } };
+
+struct stepResult { bool isResponse; uint32_t first_us; uint32_t settled_us; };
+
+//runs loop() for duration_ms, tracking MCM output changes after stepApplied_us
+void runFor_ms(uint32_t duration_ms, stepResult &result)
+{
+	uint32_t start_ms = millis();
+
+	while( (millis() - start_ms) < duration_ms )
+	{
+		loop();
+		hostHardware_serialOutput_clear();
+
+		if(isStepPending == YES) { continue; }
+
+		for(uint8_t ii = 0; ii < (sizeof(outputPins) / sizeof(outputPins[0])); ii++)
+		{
+			uint32_t changed_us = hostHardware_getOutputChangeTime_us(outputPins[ii].pin);
+			if(changed_us < stepApplied_us) { continue; }
+
+			uint32_t latency_us = changed_us - stepApplied_us + outputPins[ii].pwmPeriod_us;
+			if( (result.isResponse == NO) || (latency_us < result.first_us) ) { result.first_us = latency_us; }
+			if( (result.isResponse == NO) || (latency_us > result.settled_us) ) { result.settled_us = latency_us; }
+			result.isResponse = YES;
+		}
+	}
+}
+
+void runFor_ms(uint32_t duration_ms)
+{
+	stepResult ignored = { NO, 0, 0 };
+	runFor_ms(duration_ms, ignored);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//applies step at phase_ms after the next millisecond, then waits for outputs to settle
+stepResult step(const harnessInputs &to, uint8_t phase_ms)
+{
+	stepResult result = { NO, 0, 0 };
+
+	stepTarget = to;
+	stepAt_ms = (hostHardware_getTime_us() / 1000) + 1 + phase_ms;
+	stepApplied_us = UINT32_MAX; //until tick applies step
+	isStepPending = YES;
+
+	runFor_ms(STEP_HOLD_ms + phase_ms + 1, result);
+
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//nearest rank
+float percentile_ms(std::vector<uint32_t> samples_us, uint8_t percentile)
+{
+	if(samples_us.empty()) { return NAN; }
+
+	std::sort(samples_us.begin(), samples_us.end());
+	size_t rank = (samples_us.size() * percentile + 99) / 100;
+
+	return samples_us[(rank > 0) ? (rank - 1) : 0] / 1000.0f;
+}
+
+//'-' when there are no samples
+std::string formatPercentile(const std::vector<uint32_t> &samples_us, uint8_t percentile)
+{
+	if(samples_us.empty()) { return "-"; }
+
+	char text[16];
+	snprintf(text, sizeof(text), "%.1f", percentile_ms(samples_us, percentile));
+	return text;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void setToggle(uint8_t toggle)
+{
+	hostHardware_setDigitalInput(PIN_USER_TOGGLE1, (toggle & 0x01) != 0);
+	hostHardware_setDigitalInput(PIN_USER_TOGGLE2, (toggle & 0x02) != 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void sendCommand(const char *command)
+{
+	hostHardware_serialInput(command);
+	hostHardware_serialInput("\n");
+	for(uint8_t ii = 0; ii < 10; ii++) { loop(); }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+	uint32_t numSteps = STEPS_DEFAULT;
+	float limit_ms = NAN;
+
+	for(int ii = 1; ii < argc; ii++)
+	{
+		if     ( (strcmp(argv[ii], "--steps") == 0) && (ii + 1 < argc) ) { numSteps = strtoul(argv[++ii], NULL, 10); }
+		else if( (strcmp(argv[ii], "--limit") == 0) && (ii + 1 < argc) ) { limit_ms = strtof(argv[++ii], NULL); }
+		else
+		{
+			fprintf(stderr, "usage: %s [--steps N] [--limit <ms>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	//key on, engine running, pedals released
+	hostHardware_setDigitalInput(PIN_MAMODE2_ECM, 1); //regen/standby
+	hostHardware_setDigitalInput(PIN_BRAKE, 0);
+	hostHardware_setDigitalInput(PIN_CLUTCH, 0);
+	hostHardware_setDigitalInput(PIN_USER_MOMENTARY, 1); //active low
+	hostHardware_setTachometer_rpm(ENGINE_RPM);
+	setToggle(toggleModes[0].toggle);
+	hostHardware_setTickCallback_1ms(harness_tick);
+	harness_tick();
+
+	setup();
+	hostHardware_serialOutput_clear(); //banner
+	runFor_ms(MODE_SETTLE_ms);
+	sendCommand("$LAT=ON");
+	hostHardware_serialOutput_clear();
+
+	printf("mode,input,steps,noResponse,first_p50_ms,first_p99_ms,settled_p50_ms,settled_p99_ms\n");
+	bool isOverLimit = NO;
+
+	for(uint8_t modeIndex = 0; modeIndex < NUM_TOGGLE_MODES; modeIndex++)
+	{
+		setToggle(toggleModes[modeIndex].toggle);
+
+		for(uint8_t input = 0; input < NUM_STEP_INPUTS; input++)
+		{
+			std::vector<uint32_t> first_us;
+			std::vector<uint32_t> settled_us;
+			uint32_t numNoResponse = 0;
+
+			target = stepFrom[input];
+			runFor_ms(MODE_SETTLE_ms);
+
+			//steps alternate direction (i.e. step, then step back)
+			for(uint32_t stepIndex = 0; stepIndex < (numSteps * 2); stepIndex++)
+			{
+				bool isStepBack = ((stepIndex & 1) != 0);
+				stepResult result = step(isStepBack ? stepFrom[input] : stepTo[input], (uint8_t)((stepIndex * 7) % 10));
+
+				if(result.isResponse == NO) { numNoResponse++; continue; }
+				first_us.push_back(result.first_us);
+				settled_us.push_back(result.settled_us);
+			}
+
+			float settledP99_ms = percentile_ms(settled_us, 99);
+			if( (isnan(limit_ms) == false) && (settledP99_ms > limit_ms) ) { isOverLimit = YES; }
+
+			printf("%s,%s,%u,%u,%s,%s,%s,%s\n", toggleModes[modeIndex].name, stepInputNames[input], numSteps * 2, numNoResponse,
+				formatPercentile(first_us, 50).c_str(), formatPercentile(first_us, 99).c_str(), formatPercentile(settled_us, 50).c_str(), formatPercentile(settled_us, 99).c_str());
+		}
+	}
+
+	//firmware's own histogram (starts when LiControl samples the change, so excludes RC filter & PWM delays)
+	sendCommand("$LAT");
+	printf("%s\n", hostHardware_serialOutput_get());
+
+	if(isOverLimit == YES) { fprintf(stderr, "settled p99 latency exceeds %.1f ms\n", limit_ms); return 1; }
+
+	return 0;
+}
@@ -0,0 +1,214 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//decodes LiControl's binary telemetry stream ('$DISP=BIN') into CSV
+//usage: telemetryDecoder <serial port | capture file | -> [--start]
+//  --start: (serial port only) sends '$DISP=BIN' and '$REFR=1' before decoding
+//CSV is written to stdout; statistics are written to stderr when the stream ends
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "crc16.h"
+#include "../../muddersMIMA_firmware/binaryTelemetry.h"
+#include "../../muddersMIMA_firmware/ecm_signals.h" //MAMODE1_STATE_IS_xxx
+
+#define MAX_FRAME_SIZE_BYTES 64
+
+//opening the serial port resets LiControl, and the bootloader then waits up to 1 s for an upload (see Bootloader/README.txt)
+//'--start' commands sent before the firmware restarts would be lost
+#define FIRMWARE_RESTART_DELAY_s 2
+
+uint32_t numRecordsDecoded = 0;
+uint32_t numFramesRejected = 0;
+uint32_t numRecordsMissing = 0; //detected via sequence number gaps
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns number of decoded bytes, or -1 if frame is malformed
+int cobs_decode(const uint8_t *encoded, int numEncodedBytes, uint8_t *decoded)
+{
+	int encodedIndex = 0;
+	int decodedIndex = 0;
+
+	while(encodedIndex < numEncodedBytes)
+	{
+		uint8_t distance = encoded[encodedIndex++];
+		if(distance == 0) { return -1; }
+
+		for(uint8_t ii = 1; ii < distance; ii++)
+		{
+			if(encodedIndex >= numEncodedBytes) { return -1; }
+			decoded[decodedIndex++] = encoded[encodedIndex++];
+		}
+
+		if(encodedIndex < numEncodedBytes) { decoded[decodedIndex++] = 0; } //implied zero (except after last block)
+	}
+
+	return decodedIndex;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+const char * stateName_MAMODE1(uint8_t state)
+{
+	switch(state)
+	{
+		case MAMODE1_STATE_IS_ERROR_LO: return "LineLO";
+		case MAMODE1_STATE_IS_PRESTART: return "Prestart";
+		case MAMODE1_STATE_IS_ASSIST:   return "Assist";
+		case MAMODE1_STATE_IS_REGEN:    return "Regen";
+		case MAMODE1_STATE_IS_IDLE:     return "Standby";
+		case MAMODE1_STATE_IS_AUTOSTOP: return "AutoStop";
+		case MAMODE1_STATE_IS_START:    return "Starting";
+		case MAMODE1_STATE_IS_ERROR_HI: return "LineHI";
+		default:                        return "Error";
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t read_uint16(const uint8_t *bytes) { return (uint16_t)(bytes[0] | (bytes[1] << 8)); }
+uint32_t read_uint32(const uint8_t *bytes) { return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void printHeader(void)
+{
+	printf("timestamp_ms,sequence,joystick_percent,ECM_MAMODE1_percent,ECM_MAMODE1_state,ECM_MAMODE2_regenStandby,ECM_CMDPWR_percent,"
+	       "TPS_percent,MAP_percent,brake,clutch,button,toggle,LiBCM_mode,MCM_MAMODE1_percent,MCM_MAMODE2_regenStandby,MCM_CMDPWR_percent,"
+	       "engineRPM,loopExecution_us\n");
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void processFrame(const uint8_t *frame, int numFrameBytes)
+{
+	static bool isFirstRecord = true;
+	static uint8_t sequence_previous = 0;
+
+	uint8_t payload[MAX_FRAME_SIZE_BYTES];
+	int numPayloadBytes = cobs_decode(frame, numFrameBytes, payload);
+
+	if(numPayloadBytes != (int)BINTELEM_PAYLOAD_SIZE_BYTES) { numFramesRejected++; return; } //also rejects interleaved text
+
+	uint16_t crc = BINTELEM_CRC_INITIAL_VALUE;
+	for(unsigned ii = 0; ii < BINTELEM_RECORD_SIZE_BYTES; ii++) { crc = crc_ccitt_update(crc, payload[ii]); }
+	if(crc != read_uint16(&payload[BINTELEM_RECORD_SIZE_BYTES])) { numFramesRejected++; return; }
+
+	const uint8_t *field = payload;
+	uint8_t recordType = field[offsetof(struct binaryTelemetry_record, recordType)];
+	if(recordType != BINTELEM_RECORD_TYPE_V1) { numFramesRejected++; return; }
+
+	uint8_t sequence = field[offsetof(struct binaryTelemetry_record, sequence)];
+	if(isFirstRecord == false) { numRecordsMissing += (uint8_t)(sequence - sequence_previous - 1); }
+	isFirstRecord = false;
+	sequence_previous = sequence;
+
+	uint8_t inputFlags  = field[offsetof(struct binaryTelemetry_record, inputFlags)];
+	uint8_t outputFlags = field[offsetof(struct binaryTelemetry_record, outputFlags)];
+
+	printf("%u,%u,%u,%u,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+		read_uint32(&field[offsetof(struct binaryTelemetry_record, timestamp_ms)]),
+		sequence,
+		field[offsetof(struct binaryTelemetry_record, joystick_percent)],
+		field[offsetof(struct binaryTelemetry_record, ECM_MAMODE1_percent)],
+		stateName_MAMODE1(field[offsetof(struct binaryTelemetry_record, ECM_MAMODE1_state)]),
+		(inputFlags & BINTELEM_INPUT_ECM_MAMODE2_REGEN_STANDBY) ? 1 : 0,
+		field[offsetof(struct binaryTelemetry_record, ECM_CMDPWR_percent)],
+		field[offsetof(struct binaryTelemetry_record, TPS_percent)],
+		field[offsetof(struct binaryTelemetry_record, MAP_percent)],
+		(inputFlags & BINTELEM_INPUT_BRAKE_LIGHTS_ON) ? 1 : 0,
+		(inputFlags & BINTELEM_INPUT_CLUTCH_PRESSED ) ? 1 : 0,
+		(inputFlags & BINTELEM_INPUT_BUTTON_PRESSED ) ? 1 : 0,
+		(inputFlags >> BINTELEM_INPUT_TOGGLE_SHIFT) & 0x03,
+		field[offsetof(struct binaryTelemetry_record, LiBCM_mode)],
+		field[offsetof(struct binaryTelemetry_record, MCM_MAMODE1_percent)],
+		(outputFlags & BINTELEM_OUTPUT_MCM_MAMODE2_REGEN_STANDBY) ? 1 : 0,
+		field[offsetof(struct binaryTelemetry_record, MCM_CMDPWR_percent)],
+		read_uint16(&field[offsetof(struct binaryTelemetry_record, engineRPM)]),
+		read_uint16(&field[offsetof(struct binaryTelemetry_record, loopExecution_us)]) );
+
+	fflush(stdout); //real time output
+	numRecordsDecoded++;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool configureSerialPort(int fileDescriptor)
+{
+	struct termios settings;
+
+	if(tcgetattr(fileDescriptor, &settings) != 0) { return false; } //not a serial port (e.g. capture file)
+
+	cfmakeraw(&settings);
+	cfsetispeed(&settings, B115200);
+	cfsetospeed(&settings, B115200);
+	settings.c_cc[VMIN]  = 1;
+	settings.c_cc[VTIME] = 0;
+
+	return (tcsetattr(fileDescriptor, TCSANOW, &settings) == 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+	if(argc < 2)
+	{
+		fprintf(stderr, "usage: %s <serial port | capture file | -> [--start]\n", argv[0]);
+		return 1;
+	}
+
+	int fileDescriptor = STDIN_FILENO;
+	if(strcmp(argv[1], "-") != 0)
+	{
+		fileDescriptor = open(argv[1], O_RDWR | O_NOCTTY);
+		if(fileDescriptor < 0) { fileDescriptor = open(argv[1], O_RDONLY); }
+		if(fileDescriptor < 0) { perror(argv[1]); return 1; }
+	}
+
+	bool isSerialPort = configureSerialPort(fileDescriptor);
+
+	if( (argc > 2) && (strcmp(argv[2], "--start") == 0) && (isSerialPort == true) )
+	{
+		sleep(FIRMWARE_RESTART_DELAY_s);
+		const char startCommand[] = "$DISP=BIN\n$REFR=1\n";
+		if(write(fileDescriptor, startCommand, sizeof(startCommand) - 1) < 0) { perror("write"); }
+	}
+
+	printHeader();
+
+	uint8_t frame[MAX_FRAME_SIZE_BYTES];
+	int numFrameBytes = 0;
+	bool isFrameTooLong = false;
+	uint8_t readBuffer[256];
+	ssize_t numBytesRead;
+
+	while( (numBytesRead = read(fileDescriptor, readBuffer, sizeof(readBuffer))) > 0 )
+	{
+		for(ssize_t ii = 0; ii < numBytesRead; ii++)
+		{
+			if(readBuffer[ii] == BINTELEM_FRAME_DELIMITER)
+			{
+				if(isFrameTooLong == true) { numFramesRejected++; }
+				else if(numFrameBytes > 0) { processFrame(frame, numFrameBytes); }
+				//else { ; } //empty frame between back-to-back delimiters
+
+				numFrameBytes = 0;
+				isFrameTooLong = false;
+			}
+			else if(numFrameBytes < MAX_FRAME_SIZE_BYTES) { frame[numFrameBytes++] = readBuffer[ii]; }
+			else                                          { isFrameTooLong = true; } //e.g. text output
+		}
+	}
+
+	fprintf(stderr, "records decoded: %u, frames rejected: %u, records missing: %u\n", numRecordsDecoded, numFramesRejected, numRecordsMissing);
+
+	return 0;
+}
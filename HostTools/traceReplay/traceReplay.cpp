@@ -0,0 +1,305 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//replays an input trace through the firmware's loop() (host build), and prints every output change as CSV
+//usage: traceReplay <trace.csv> [--golden <expected.csv>] [--hold <ms>]
+//--golden: compare output against a previous run, print first difference, and return 1 if they differ
+//--hold:   keep running this long after the last trace row (default 1000 ms)
+
+//trace format: CSV with a header row
+//column names are the same as telemetryDecoder's output, so recorded '$DISP=BIN' logs replay directly
+//'timestamp_ms' is required //every other column is optional, and unknown columns are ignored
+//each row's values are held until the next row's timestamp
+
+#include "muddersMIMA.h"
+#include "hostHardware.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define TRACE_HOLD_DEFAULT_ms 1000
+
+//trace columns
+#define TRACE_TIMESTAMP      0
+#define TRACE_JOYSTICK       1 //percent, as reported by adc_readJoystick_percent() //i.e. after INVERT_JOYSTICK_DIRECTION
+#define TRACE_ECM_MAMODE1    2 //percent, as reported by ecm_getMAMODE1_percent()   //i.e. including hardware correction
+#define TRACE_ECM_MAMODE2    3 //1: regen/standby
+#define TRACE_ECM_CMDPWR     4 //percent, as reported by ecm_getCMDPWR_percent()    //i.e. including hardware correction
+#define TRACE_TPS            5 //percent
+#define TRACE_MAP            6 //percent
+#define TRACE_BRAKE          7 //1: brake pedal pressed
+#define TRACE_CLUTCH         8 //1: clutch pedal pressed
+#define TRACE_BUTTON         9 //1: momentary button pressed
+#define TRACE_TOGGLE        10 //gpio_getButton_toggle() value (0:3)
+#define TRACE_RPM           11
+#define TRACE_NUM_COLUMNS   12
+
+const char * const traceColumnNames[TRACE_NUM_COLUMNS] = {
+	"timestamp_ms", "joystick_percent", "ECM_MAMODE1_percent", "ECM_MAMODE2_regenStandby", "ECM_CMDPWR_percent",
+	"TPS_percent", "MAP_percent", "brake", "clutch", "button", "toggle", "engineRPM" };
+
+//used when a column is missing: key on, ECM idle, joystick neutral, pedals released, toggle in position 1
+const uint32_t traceColumnDefaults[TRACE_NUM_COLUMNS] = { 0, 50, 50, 1, 50, 0, 0, 0, 0, 0, TOGGLE_POSITION1, 0 };
+
+struct traceRow { uint32_t value[TRACE_NUM_COLUMNS]; };
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> splitCSV(const std::string &line)
+{
+	std::vector<std::string> fields;
+	std::string field;
+
+	for(size_t ii = 0; ii < line.size(); ii++)
+	{
+		if     (line[ii] == ',')                      { fields.push_back(field); field.clear(); }
+		else if( (line[ii] != '\r') && (line[ii] != ' ') ) { field += line[ii]; }
+	}
+	fields.push_back(field);
+
+	return fields;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool readLine(FILE *file, std::string &line)
+{
+	line.clear();
+
+	int character;
+	while( ((character = fgetc(file)) != EOF) && (character != '\n') ) { line += (char)character; }
+
+	return ( (character != EOF) || (line.empty() == false) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns false if file can't be read
+bool loadTrace(const char *path, std::vector<traceRow> &rows)
+{
+	FILE *file = fopen(path, "r");
+	if(file == NULL) { fprintf(stderr, "can't open %s\n", path); return false; }
+
+	std::string line;
+	int columnIndex[TRACE_NUM_COLUMNS]; //position of each trace column in file (-1: missing)
+	for(int ii = 0; ii < TRACE_NUM_COLUMNS; ii++) { columnIndex[ii] = -1; }
+
+	//header
+	while( readLine(file, line) && (line.empty() || (line[0] == '#')) ) { ; }
+	std::vector<std::string> header = splitCSV(line);
+	for(size_t position = 0; position < header.size(); position++)
+	{
+		for(int ii = 0; ii < TRACE_NUM_COLUMNS; ii++)
+		{
+			if(header[position] == traceColumnNames[ii]) { columnIndex[ii] = (int)position; }
+		}
+	}
+
+	if(columnIndex[TRACE_TIMESTAMP] < 0) { fprintf(stderr, "%s: no 'timestamp_ms' column\n", path); fclose(file); return false; }
+
+	while(readLine(file, line))
+	{
+		if(line.empty() || (line[0] == '#')) { continue; } //comment
+
+		std::vector<std::string> fields = splitCSV(line);
+		traceRow row;
+
+		for(int ii = 0; ii < TRACE_NUM_COLUMNS; ii++)
+		{
+			if( (columnIndex[ii] >= 0) && ((size_t)columnIndex[ii] < fields.size()) ) { row.value[ii] = strtoul(fields[columnIndex[ii]].c_str(), NULL, 10); }
+			else                                                                     { row.value[ii] = traceColumnDefaults[ii]; }
+		}
+
+		if( (rows.empty() == false) && (row.value[TRACE_TIMESTAMP] < rows.back().value[TRACE_TIMESTAMP]) )
+		{
+			fprintf(stderr, "%s: timestamps must not decrease ('%s')\n", path, line.c_str());
+			fclose(file);
+			return false;
+		}
+
+		rows.push_back(row);
+	}
+
+	fclose(file);
+
+	if(rows.empty()) { fprintf(stderr, "%s: no data rows\n", path); return false; }
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//ADC counts that adc_read10bValue_Percent() converts back to 'percent'
+uint16_t percentToCounts(uint32_t percent)
+{
+	if(percent >= 100) { return ADC_NUM_COUNTS_10b; }
+
+	return (uint16_t)((percent * ADC_NUM_COUNTS_10b + 99) / 100);
+}
+
+//undo hardware correction that adc.cpp adds
+uint32_t removeCorrection(uint32_t percent, uint8_t correction)
+{
+	if( (percent == 0) || (percent >= 100) ) { return percent; }
+	if(percent <= correction)               { return 1;       }
+
+	return percent - correction;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void applyInputs(const traceRow &row)
+{
+	uint32_t joystick_percent = row.value[TRACE_JOYSTICK];
+	#ifdef INVERT_JOYSTICK_DIRECTION
+		joystick_percent = (joystick_percent > 100) ? 0 : (100 - joystick_percent);
+	#endif
+
+	hostHardware_setAnalogInput(PIN_USER_JOYSTICK, percentToCounts(joystick_percent));
+	hostHardware_setAnalogInput(PIN_MAMODE1_ECM,   percentToCounts(removeCorrection(row.value[TRACE_ECM_MAMODE1], ADC_HARDWARE_CORRECTION_MAMODE1_PERCENT)));
+	hostHardware_setAnalogInput(PIN_CMDPWR_ECM,    percentToCounts(removeCorrection(row.value[TRACE_ECM_CMDPWR],  ADC_HARDWARE_CORRECTION_CMDPWR_PERCENT)));
+	hostHardware_setAnalogInput(PIN_THROTTLE,      percentToCounts(row.value[TRACE_TPS]));
+	hostHardware_setAnalogInput(PIN_MAP_SENSOR,    percentToCounts(row.value[TRACE_MAP]));
+
+	hostHardware_setDigitalInput(PIN_MAMODE2_ECM,    row.value[TRACE_ECM_MAMODE2] != 0);
+	hostHardware_setDigitalInput(PIN_BRAKE,          row.value[TRACE_BRAKE]       != 0); //BRAKE_uC is high when pedal pressed
+	hostHardware_setDigitalInput(PIN_CLUTCH,         row.value[TRACE_CLUTCH]      != 0);
+	hostHardware_setDigitalInput(PIN_USER_MOMENTARY, row.value[TRACE_BUTTON]      == 0); //active low
+	hostHardware_setDigitalInput(PIN_USER_TOGGLE1,   (row.value[TRACE_TOGGLE] & 0x01) != 0);
+	hostHardware_setDigitalInput(PIN_USER_TOGGLE2,   (row.value[TRACE_TOGGLE] & 0x02) != 0);
+
+	hostHardware_setTachometer_rpm((uint16_t)row.value[TRACE_RPM]);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns output line (without timestamp)
+std::string captureOutputs(void)
+{
+	bool isBrakePinDriven = (hostHardware_getPinMode(PIN_BRAKE) == OUTPUT);
+
+	//when BRAKE_uC floats, the OEM brake switch controls the brake lights
+	uint8_t brakeLights_counts;
+	if(isBrakePinDriven) { brakeLights_counts = hostHardware_getPWM(PIN_BRAKE); }
+	else                 { brakeLights_counts = (digitalRead(PIN_BRAKE) == HIGH) ? 255 : 0; }
+
+	char line[64];
+	snprintf(line, sizeof(line), "%u,%u,%u,%u,%u",
+		hostHardware_getPWM(PIN_MAMODE1_MCM),
+		hostHardware_getDigitalOutput(PIN_MAMODE2_MCM),
+		hostHardware_getPWM(PIN_CMDPWR_MCM),
+		isBrakePinDriven,
+		brakeLights_counts);
+
+	return line;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns true if identical
+bool compareToGolden(const std::string &output, const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if(file == NULL) { fprintf(stderr, "can't open %s\n", path); return false; }
+
+	size_t position = 0;
+	uint32_t lineNumber = 1;
+	std::string expected;
+	bool isIdentical = true;
+
+	while(true)
+	{
+		bool isExpectedLine = readLine(file, expected);
+
+		size_t lineEnd = output.find('\n', position);
+		bool isActualLine = (lineEnd != std::string::npos);
+		std::string actual = isActualLine ? output.substr(position, lineEnd - position) : "";
+
+		if( (isExpectedLine == false) && (isActualLine == false) ) { break; }
+
+		if( (isExpectedLine != isActualLine) || (expected != actual) )
+		{
+			fprintf(stderr, "%s: first difference at line %u\n expected: %s\n actual:   %s\n", path, lineNumber,
+				isExpectedLine ? expected.c_str() : "<end of file>", isActualLine ? actual.c_str() : "<end of output>");
+			isIdentical = false;
+			break;
+		}
+
+		position = lineEnd + 1;
+		lineNumber++;
+	}
+
+	fclose(file);
+	return isIdentical;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+	const char *tracePath = NULL;
+	const char *goldenPath = NULL;
+	uint32_t hold_ms = TRACE_HOLD_DEFAULT_ms;
+
+	for(int ii = 1; ii < argc; ii++)
+	{
+		if     ( (strcmp(argv[ii], "--golden") == 0) && (ii + 1 < argc) ) { goldenPath = argv[++ii]; }
+		else if( (strcmp(argv[ii], "--hold")   == 0) && (ii + 1 < argc) ) { hold_ms = strtoul(argv[++ii], NULL, 10); }
+		else if( (argv[ii][0] != '-') && (tracePath == NULL) )            { tracePath = argv[ii]; }
+		else { tracePath = NULL; break; }
+	}
+
+	if(tracePath == NULL)
+	{
+		fprintf(stderr, "usage: %s <trace.csv> [--golden <expected.csv>] [--hold <ms>]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<traceRow> rows;
+	if(loadTrace(tracePath, rows) == false) { return 1; }
+
+	//inputs must be valid before setup() reads them
+	size_t rowIndex = 0;
+	applyInputs(rows[0]);
+	setup();
+	hostHardware_serialOutput_clear(); //banner
+
+	uint32_t traceStart_ms = rows[0].value[TRACE_TIMESTAMP];
+	uint32_t replayStart_ms = millis();
+	uint32_t replayEnd_ms = rows.back().value[TRACE_TIMESTAMP] - traceStart_ms + hold_ms;
+
+	std::string output = "time_ms,MCM_MAMODE1_counts,MCM_MAMODE2_regenStandby,MCM_CMDPWR_counts,brakePin_driven,brakeLights_counts\n";
+	std::string outputs_previous;
+	uint32_t numLoops = 0;
+
+	while(true)
+	{
+		uint32_t replay_ms = millis() - replayStart_ms;
+		if(replay_ms > replayEnd_ms) { break; }
+
+		bool isNewRow = NO;
+		while( (rowIndex + 1 < rows.size()) && ((rows[rowIndex + 1].value[TRACE_TIMESTAMP] - traceStart_ms) <= replay_ms) ) { rowIndex++; isNewRow = YES; }
+		if(isNewRow == YES) { applyInputs(rows[rowIndex]); }
+
+		loop();
+		numLoops++;
+
+		std::string outputs = captureOutputs();
+		if(outputs != outputs_previous)
+		{
+			char timestamp[16];
+			snprintf(timestamp, sizeof(timestamp), "%u,", replay_ms);
+			output += timestamp + outputs + "\n";
+			outputs_previous = outputs;
+		}
+
+		hostHardware_serialOutput_clear(); //debug text isn't compared
+	}
+
+	fprintf(stderr, "%s: %u rows, %u ms, %u loops\n", tracePath, (unsigned)rows.size(), replayEnd_ms, numLoops);
+
+	if(goldenPath != NULL) { return compareToGolden(output, goldenPath) ? 0 : 1; }
+
+	fputs(output.c_str(), stdout);
+	return 0;
+}
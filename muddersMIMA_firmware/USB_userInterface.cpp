@@ -7,164 +7,296 @@
 
 uint8_t line[USER_INPUT_BUFFER_SIZE]; //Stores user text as it's read from serial buffer
 
+//completed lines wait here until executed (one per loop)
+uint8_t lineQueue[USER_INPUT_QUEUE_DEPTH][USER_INPUT_BUFFER_SIZE];
+uint8_t lineQueue_numLines = 0;
+uint8_t lineQueue_oldest = 0;
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 void printStringStoredInArray(const uint8_t *s)
 {
-  while (*s) { Serial.write(*s++); } //write each character until '0' (EOL character)
+  while (*s) { debugUSB_recordAppend_char(*s++); } //write each character until '0' (EOL character)
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-void USB_userInterface_runTestCode(uint8_t testToRun)
+//argument is NULL when user didn't enter one (e.g. '$TEST')
+void USB_userInterface_runTestCode(const uint8_t *argument, uint32_t testToRun)
 {
 	//Add whatever code you want to run whenever the user types '$TEST1'/2/3/etc into the Serial Monitor Window
-	if     (testToRun == STRING_TERMINATION_CHARACTER) { Serial.print(F("\nError: Test not specified")); }
-	else if(testToRun == '1')
+	if     (argument == NULL) { debugUSB_recordAppend_string(F("\nError: Test not specified")); }
+	else if(testToRun == 1)
 	{
-		Serial.print(F("\nRunning TEST1: "));
+		debugUSB_recordAppend_string(F("\nRunning TEST1: "));
 	}
-	else if(testToRun == '2')
+	else if(testToRun == 2)
 	{
-		Serial.print(F("\nRunning TEST2: "));
+		debugUSB_recordAppend_string(F("\nRunning TEST2: "));
 	}
-	else if(testToRun == '3')
+	else if(testToRun == 3)
 	{
-		Serial.print(F("\nRunning TEST3: "));
+		debugUSB_recordAppend_string(F("\nRunning TEST3: "));
 	}
-	else if(testToRun == '4')
+	else if(testToRun == 4)
 	{
-		Serial.print(F("\nRunning TEST4: "));
+		debugUSB_recordAppend_string(F("\nRunning TEST4: "));
 	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-void printHelp(void)
+//help text is longer than the TX ring, so it's sent in pieces as the ring empties
+void printHelp(const uint8_t *, uint32_t)
 {
-	Serial.print(F("\n\nLiBCM commands:"
+	imageCheck_printStatus();
+	debugUSB_printLongFlashString(F("\n\nLiBCM commands:"
 		"\n -'$TEST1'/2/3/4: run test code. See 'USB_userInterface_runTestCode()')"
 		"\n -'$LOOP': main while loop period. '$LOOP=___' to set (1 to 255 ms)"
-		"\n -'$REFR': period between display updates. '$REFR=___' to set (1 to 255 ms)"
-		"\n -'$DISP=BUT'/OEM/OFF. Display 'buttons', OEM ECM signals, or nothing."
+		"\n -'$REFR': period between display updates. '$REFR=___' to set (1 to 65535 ms)"
+		"\n -'$DISP=BUT'/OEM/BIN/OFF. Display 'buttons', OEM ECM signals, binary telemetry, or nothing."
+		"\n    -BIN is decoded by ../HostTools/telemetryDecoder. '$REFR=1' streams at loop rate."
+		"\n -'$DROP': number of debug messages dropped because USB was too slow"
+		"\n -'$DUMP': display flight recorder data (recorder stops if not already triggered). Use '$DISP=OFF' first."
+		"\n -'$REC': restart flight recorder (clears previous data)"
+		"\n -'$LOG': display event/fault log (stored in EEPROM, so it survives keyOFF)"
+		"\n -'$LOGCLR': clear event log"
+		"\n -'$GET': list tunable parameters. '$GET=NAME' to display one"
+		"\n -'$SET=NAME=___': change parameter (until keyOFF)"
+		"\n -'$SAVE': store all parameters in EEPROM (loaded at each keyON)"
+		"\n -'$CAL': calibrate joystick neutral and endpoints (key OFF). '$CAL=CLR' to revert to nominal joystick"
+		"\n -'$LAT=ON': start measuring input->output latency (clears previous data). '$LAT' to display. '$LAT=OFF' to stop"
+		"\n    -Only from when LiControl samples a changed input until it changes the MCM output (excludes RC filter & PWM delays)"
 		"\n"
-		//add new commands to "USB_userInterface_executeUserInput()"
+		//add new commands to "userCommands[]"
 		));
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-//LiBCM's atoi() implementation for uint8_t
-uint8_t get_uint8_FromInput(uint8_t digit1, uint8_t digit2, uint8_t digit3)
+void cmd_loopPeriod(const uint8_t *argument, uint32_t newLoopPeriod_ms)
 {
-	bool errorOccurred = false;
-	uint8_t numDecimalDigits = 3;
-	uint8_t decimalValue = 0;
-
-	if     (digit1 == STRING_TERMINATION_CHARACTER) { errorOccurred = true; }
-	else if(digit2 == STRING_TERMINATION_CHARACTER) { numDecimalDigits = 1; }
-	else if(digit3 == STRING_TERMINATION_CHARACTER) { numDecimalDigits = 2; }
-	
-	if(errorOccurred == true) { Serial.print(F("\nInvalid uint8_t Entry")); }
+	if(argument != NULL) { time_loopPeriod_ms_set((uint8_t)newLoopPeriod_ms); }
 	else
 	{
-		if     (numDecimalDigits == 1) { decimalValue =                                      (digit1-'0'); }
-		else if(numDecimalDigits == 2) { decimalValue =                    (digit1-'0')*10 + (digit2-'0'); }
-		else if(numDecimalDigits == 3) { decimalValue = (digit1-'0')*100 + (digit2-'0')*10 + (digit3-'0'); }
+		debugUSB_recordAppend_string(F("\nLoop period is (ms): "));
+		debugUSB_recordAppend_uint(time_loopPeriod_ms_get());
 	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void cmd_refreshPeriod(const uint8_t *argument, uint32_t newRefreshPeriod_ms)
+{
+	if(argument != NULL) { debugUSB_dataUpdatePeriod_ms_set((uint16_t)newRefreshPeriod_ms); }
+	else
+	{
+		debugUSB_recordAppend_string(F("\nDisplay refresh period is (ms): "));
+		debugUSB_recordAppend_uint(debugUSB_dataUpdatePeriod_ms_get());
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void cmd_displayType(const uint8_t *argument, uint32_t)
+{
+	if     (argument == NULL)                                   { debugUSB_recordAppend_string(F("\nError: Display type not specified")); }
+	else if(strcmp_P((const char *)argument, PSTR("BUT")) == 0) { debugUSB_dataTypeToStream_set(DEBUGUSB_STREAM_BUTTON);      }
+	else if(strcmp_P((const char *)argument, PSTR("OFF")) == 0) { debugUSB_dataTypeToStream_set(DEBUGUSB_STREAM_NONE);        }
+	else if(strcmp_P((const char *)argument, PSTR("OEM")) == 0) { debugUSB_dataTypeToStream_set(DEBUGUSB_STREAM_OEM_SIGNALS); }
+	else if(strcmp_P((const char *)argument, PSTR("BIN")) == 0) { debugUSB_dataTypeToStream_set(DEBUGUSB_STREAM_BINARY);      }
+	else                                                        { debugUSB_recordAppend_string(F("\nError: Unknown display type"));          }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void cmd_droppedRecords(const uint8_t *, uint32_t)
+{
+	debugUSB_recordAppend_string(F("\nDropped debug messages: "));
+	debugUSB_recordAppend_uint(debugUSB_droppedRecords_get());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void cmd_flightRecorderDump (const uint8_t *,         uint32_t) { flightRecorder_startDump(); }
+void cmd_flightRecorderRearm(const uint8_t *,         uint32_t) { flightRecorder_rearm(); debugUSB_recordAppend_string(F("\nRecorder restarted")); }
+void cmd_eventLogList       (const uint8_t *,         uint32_t) { eventLog_startListing(); }
+void cmd_eventLogClear      (const uint8_t *,         uint32_t) { eventLog_clear(); debugUSB_recordAppend_string(F("\nEvent log cleared")); }
+void cmd_parameterGet       (const uint8_t *argument, uint32_t) { parameters_get(argument); }
+void cmd_parameterSet       (const uint8_t *argument, uint32_t) { parameters_set(argument); }
+void cmd_parameterSave      (const uint8_t *,         uint32_t) { parameters_save(); }
+void cmd_joystickCalibrate  (const uint8_t *argument, uint32_t) { joystickCal_start(argument); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
 
-	return decimalValue;
+void cmd_latency(const uint8_t *argument, uint32_t)
+{
+	if     (argument == NULL)                                   { latency_printHistogram(); }
+	else if(strcmp_P((const char *)argument, PSTR("ON"))  == 0) { latency_start();          }
+	else if(strcmp_P((const char *)argument, PSTR("OFF")) == 0) { latency_stop();           }
+	else                                                        { debugUSB_recordAppend_string(F("\nError: Use '$LAT', '$LAT=ON' or '$LAT=OFF'")); }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//Add new commands here (and to printHelp())
+//'$NAME' calls handler with argument==NULL
+//'$NAME=___' (or '$NAME___' if argument starts with a digit) calls handler with argument (which is range checked first, if numeric)
+const userCommand userCommands[] PROGMEM = {
+	//name    handler                          argumentType             min  max
+	{ "HELP", printHelp,                       USER_ARGUMENT_NONE,      0,   0          },
+	{ "TEST", USB_userInterface_runTestCode,   USER_ARGUMENT_UINT8,     1,   4          },
+	{ "LOOP", cmd_loopPeriod,                  USER_ARGUMENT_UINT8,     1,   UINT8_MAX  },
+	{ "REFR", cmd_refreshPeriod,               USER_ARGUMENT_UINT16,    1,   UINT16_MAX },
+	{ "DISP", cmd_displayType,                 USER_ARGUMENT_TEXT,      0,   0          },
+	{ "DROP", cmd_droppedRecords,              USER_ARGUMENT_NONE,      0,   0          },
+	{ "DUMP", cmd_flightRecorderDump,          USER_ARGUMENT_NONE,      0,   0          },
+	{ "REC",  cmd_flightRecorderRearm,         USER_ARGUMENT_NONE,      0,   0          },
+	{ "LOG",  cmd_eventLogList,                USER_ARGUMENT_NONE,      0,   0          },
+	{ "LOGCLR", cmd_eventLogClear,             USER_ARGUMENT_NONE,      0,   0          },
+	{ "GET",  cmd_parameterGet,                USER_ARGUMENT_TEXT,      0,   0          },
+	{ "SET",  cmd_parameterSet,                USER_ARGUMENT_TEXT,      0,   0          },
+	{ "SAVE", cmd_parameterSave,               USER_ARGUMENT_NONE,      0,   0          },
+	{ "CAL",  cmd_joystickCalibrate,           USER_ARGUMENT_TEXT,      0,   0          },
+	{ "LAT",  cmd_latency,                     USER_ARGUMENT_TEXT,      0,   0          },
+};
+
+#define NUM_USER_COMMANDS (sizeof(userCommands) / sizeof(userCommands[0]))
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//bounded atoi() for 8/16/32 bit values
+//result is only modified if USER_PARSE_OK is returned
+uint8_t USB_userInterface_parseUnsigned(const uint8_t *text, uint32_t minValue, uint32_t maxValue, uint32_t *result)
+{
+	uint32_t value = 0;
+
+	if(*text == STRING_TERMINATION_CHARACTER) { return USER_PARSE_ERROR_NOT_A_NUMBER; }
+
+	while(*text != STRING_TERMINATION_CHARACTER)
+	{
+		uint8_t digit = *text++ - '0';
+
+		if(digit > 9) { return USER_PARSE_ERROR_NOT_A_NUMBER; } //also catches characters below '0' (unsigned wrap)
+
+		if(value > ((UINT32_MAX - digit) / 10)) { return USER_PARSE_ERROR_OUT_OF_RANGE; } //would overflow uint32_t
+
+		value = (value * 10) + digit;
+	}
+
+	if( (value < minValue) || (value > maxValue) ) { return USER_PARSE_ERROR_OUT_OF_RANGE; }
+
+	*result = value;
+	return USER_PARSE_OK;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 //determine which command to run
-void USB_userInterface_executeUserInput(void)
+//command output is added to the record started by caller
+void USB_userInterface_executeUserInput(const uint8_t *inputLine)
 {
-	if(line[0] == '$') //valid commands start with '$'
+	if(inputLine[0] != '$') { debugUSB_recordAppend_string(F("\nInvalid Entry")); return; } //valid commands start with '$'
+
+	//command name is all letters after '$'
+	char name[USER_COMMAND_NAME_MAX_LENGTH + 1];
+	uint8_t nameLength = 0;
+	const uint8_t *argument = &inputLine[1];
+
+	while( (*argument >= 'A') && (*argument <= 'Z') )
 	{
-		//$HELP
-		if( (line[1] == 'H') && (line[2] == 'E') && (line[3] == 'L') && (line[4] == 'P') ) { printHelp(); }
+		if(nameLength >= USER_COMMAND_NAME_MAX_LENGTH) { debugUSB_recordAppend_string(F("\nInvalid Entry")); return; }
+		name[nameLength++] = *argument++;
+	}
+	name[nameLength] = STRING_TERMINATION_CHARACTER;
 
-		//$TEST
-		else if( (line[1] == 'T') && (line[2] == 'E') && (line[3] == 'S') && (line[4] == 'T') ) { USB_userInterface_runTestCode(line[5]); }
+	if     (*argument == '=')                          { argument++;      } //'$NAME=___'
+	else if(*argument == STRING_TERMINATION_CHARACTER) { argument = NULL; } //'$NAME'
+	//else { ; } //'$NAME___' (e.g. '$TEST1')
 
-		//LOOP
-		else if( (line[1] == 'L') && (line[2] == 'O') && (line[3] == 'O') && (line[4] == 'P') )
+	//find command
+	for(uint8_t ii = 0; ii < NUM_USER_COMMANDS; ii++)
+	{
+		if(strcmp_P(name, userCommands[ii].name) == 0)
 		{
-			if(line[5] == '=')
-			{
-				uint8_t newLooprate_ms = get_uint8_FromInput(line[6],line[7],line[8]);
-				time_loopPeriod_ms_set(newLooprate_ms);
-			}
-			else if(line[5] == STRING_TERMINATION_CHARACTER)
-			{
-				Serial.print(F("\nLoop period is (ms): "));
-				Serial.print(time_loopPeriod_ms_get(),DEC);
-			}
-		}
+			userCommand command;
+			memcpy_P(&command, &userCommands[ii], sizeof(command));
 
-		//REFR
-		else if( (line[1] == 'R') && (line[2] == 'E') && (line[3] == 'F') && (line[4] == 'R') )
-		{
-			if(line[5] == '=')
-			{
-				uint8_t newRefreshRate_ms = get_uint8_FromInput(line[6],line[7],line[8]);
-				debugUSB_dataUpdatePeriod_ms_set(newRefreshRate_ms);
-			}
-			else if(line[5] == STRING_TERMINATION_CHARACTER)
+			uint32_t value = 0;
+
+			if(argument != NULL)
 			{
-				Serial.print(F("\nDisplay refresh period is (ms): "));
-				Serial.print(debugUSB_dataUpdatePeriod_ms_get(),DEC);
+				if(command.argumentType == USER_ARGUMENT_NONE) { debugUSB_recordAppend_string(F("\nError: Command doesn't accept a value")); return; }
+				else if(command.argumentType != USER_ARGUMENT_TEXT)
+				{
+					//table limits can't exceed argument type's limits
+					if     ( (command.argumentType == USER_ARGUMENT_UINT8 ) && (command.maxValue > UINT8_MAX ) ) { command.maxValue = UINT8_MAX;  }
+					else if( (command.argumentType == USER_ARGUMENT_UINT16) && (command.maxValue > UINT16_MAX) ) { command.maxValue = UINT16_MAX; }
+
+					uint8_t parseResult = USB_userInterface_parseUnsigned(argument, command.minValue, command.maxValue, &value);
+
+					if(parseResult == USER_PARSE_ERROR_NOT_A_NUMBER) { debugUSB_recordAppend_string(F("\nError: Not a number")); return; }
+					if(parseResult == USER_PARSE_ERROR_OUT_OF_RANGE)
+					{
+						debugUSB_recordAppend_string(F("\nError: Valid range is "));
+						debugUSB_recordAppend_uint(command.minValue);
+						debugUSB_recordAppend_string(F(" to "));
+						debugUSB_recordAppend_uint(command.maxValue);
+						return;
+					}
+				}
 			}
-		}
 
-		//DISP
-		else if( (line[1] == 'D') && (line[2] == 'I') && (line[3] == 'S') && (line[4] == 'P') && (line[5] == '=') )
-		{
-			if     ( (line[6] == 'B') && (line[7] == 'U') && (line[8] == 'T') ) { debugUSB_dataTypeToStream_set(DEBUGUSB_STREAM_BUTTON);      }
-			else if( (line[6] == 'O') && (line[7] == 'F') && (line[8] == 'F') ) { debugUSB_dataTypeToStream_set(DEBUGUSB_STREAM_NONE);        }
-			else if( (line[6] == 'O') && (line[7] == 'E') && (line[8] == 'M') ) { debugUSB_dataTypeToStream_set(DEBUGUSB_STREAM_OEM_SIGNALS); }
+			command.handler(argument, value);
+			return;
 		}
-
-		//$DEFAULT
-		else { Serial.print(F("\nInvalid Entry")); }
 	}
-	else { Serial.print(F("\nInvalid Entry")); }
+
+	debugUSB_recordAppend_string(F("\nInvalid Entry")); //command not found
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 //read user-typed input from serial buffer
-//user input executes at each newline character
-void USB_userInterface_handler(void)
+//completed lines are queued (executed later by USB_userInterface_handler())
+//reads at most USER_INPUT_MAX_BYTES_PER_LOOP characters, so pasted text can't stall the control loop
+void USB_userInterface_readInput(void)
 {
 	uint8_t latestCharacterRead = 0; //c
 	static uint8_t numCharactersReceived = 0; //char_counter
 	static uint8_t inputFlags = 0; //stores state as input text is processed (e.g. whether inside a comment or not)
+	uint8_t numCharactersAllowed = USER_INPUT_MAX_BYTES_PER_LOOP;
 
-	while( Serial.available() )
+	//remaining characters stay in Serial's receive buffer until next loop
+	while( Serial.available() && (numCharactersAllowed > 0) && (lineQueue_numLines < USER_INPUT_QUEUE_DEPTH) )
 	{
 		//user-typed characters are waiting in serial buffer
 
 		latestCharacterRead = Serial.read(); //read next character in buffer
+		numCharactersAllowed--;
+		powerSave_usbActivity();
 		
 		if( (latestCharacterRead == '\n') || (latestCharacterRead == '\r') ) //EOL character retrieved
 		{
-			//line line is now complete
-			line[numCharactersReceived] = STRING_TERMINATION_CHARACTER;
-
-			Serial.print(F("\necho: "));
-			printStringStoredInArray(line); //echo user input
+			//line is now complete
+			if( (numCharactersReceived > 0) || (inputFlags & INPUT_FLAG_LINE_TOO_LONG) )
+			{
+				if(inputFlags & INPUT_FLAG_LINE_TOO_LONG) { numCharactersReceived = 0; } //empty line reports error when executed
+				line[numCharactersReceived] = STRING_TERMINATION_CHARACTER;
 
-			if(numCharactersReceived >= USER_INPUT_BUFFER_SIZE)     { Serial.print(F("\nError: User typed too many characters")); }
-			else                                                    { USB_userInterface_executeUserInput();                       }
+				//add line to queue
+				uint8_t newest = (lineQueue_oldest + lineQueue_numLines) % USER_INPUT_QUEUE_DEPTH;
+				memcpy(lineQueue[newest], line, numCharactersReceived + 1);
+				lineQueue_numLines++;
+			}
+			//else { ; } //ignore empty lines (e.g. '\r' in "\r\n")
 
 			numCharactersReceived = 0; //reset for next line
+			inputFlags &= ~(INPUT_FLAG_LINE_TOO_LONG);
 		}
 		else //add (non-EOL) character to array 
 		{
-			if(inputFlags && INPUT_FLAG_INSIDE_COMMENT)
+			if(inputFlags & INPUT_FLAG_INSIDE_COMMENT)
 			{
 				if(latestCharacterRead == ')') { inputFlags &= ~(INPUT_FLAG_INSIDE_COMMENT); } //end of comment
 			}
@@ -180,6 +312,34 @@ void USB_userInterface_handler(void)
 				}
 				else {line[numCharactersReceived++] = latestCharacterRead; } //store everything else
 			}
+			else { inputFlags |= INPUT_FLAG_LINE_TOO_LONG; }
 		}
 	}
-}
\ No newline at end of file
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//executes at most one queued line per loop
+//all output goes through debugUSB's TX ring, so this function never waits for USB
+void USB_userInterface_handler(void)
+{
+	USB_userInterface_readInput();
+
+	//wait until previous long response (e.g. '$HELP') is sent, so output isn't interleaved
+	if( (lineQueue_numLines > 0) && (debugUSB_isLongFlashStringPending() == NO) )
+	{
+		const uint8_t *queuedLine = lineQueue[lineQueue_oldest];
+
+		debugUSB_recordStart();
+		debugUSB_recordAppend_string(F("\necho: "));
+		printStringStoredInArray(queuedLine); //echo user input
+
+		if(queuedLine[0] == STRING_TERMINATION_CHARACTER) { debugUSB_recordAppend_string(F("\nError: User typed too many characters")); }
+		else                                              { USB_userInterface_executeUserInput(queuedLine);                             }
+
+		debugUSB_recordCommit();
+
+		lineQueue_oldest = (lineQueue_oldest + 1) % USER_INPUT_QUEUE_DEPTH;
+		lineQueue_numLines--;
+	}
+}
@@ -8,8 +8,37 @@
 	#define STRING_TERMINATION_CHARACTER 0
 
 	#define INPUT_FLAG_INSIDE_COMMENT 0x01
+	#define INPUT_FLAG_LINE_TOO_LONG  0x02
 
-	uint8_t USB_userInterface_getUserInput(void);
+	#define USER_INPUT_MAX_BYTES_PER_LOOP 16 //~1.4 ms of characters @ 115200 baud
+	#define USER_INPUT_QUEUE_DEPTH         2 //completed lines waiting to execute
+
+	#define USER_COMMAND_NAME_MAX_LENGTH 7
+
+	#define USER_ARGUMENT_NONE   0 //'$NAME' only
+	#define USER_ARGUMENT_UINT8  1 //'$NAME' or '$NAME=___' (range checked)
+	#define USER_ARGUMENT_UINT16 2
+	#define USER_ARGUMENT_UINT32 3
+	#define USER_ARGUMENT_TEXT   4 //'$NAME' or '$NAME=___' (handler parses text)
+
+	#define USER_PARSE_OK                 0
+	#define USER_PARSE_ERROR_NOT_A_NUMBER 1
+	#define USER_PARSE_ERROR_OUT_OF_RANGE 2
+
+	//argument: text after '=' (or NULL if user didn't enter a value)
+	//value:    argument converted to integer (numeric argumentTypes only)
+	typedef void (*userCommandHandler)(const uint8_t *argument, uint32_t value);
+
+	struct userCommand
+	{
+		char name[USER_COMMAND_NAME_MAX_LENGTH + 1];
+		userCommandHandler handler;
+		uint8_t  argumentType;
+		uint32_t minValue;
+		uint32_t maxValue;
+	};
+
+	uint8_t USB_userInterface_parseUnsigned(const uint8_t *text, uint32_t minValue, uint32_t maxValue, uint32_t *result);
 
 	void USB_userInterface_handler(void);
 
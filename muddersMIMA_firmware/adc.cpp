@@ -17,20 +17,47 @@ uint8_t adc_read10bValue_Percent(int adcChannel)
 	return percent;
 }
 
+uint8_t latestJoystick_percent = JOYSTICK_NEUTRAL_NOM_PERCENT;
+
 //////////////////////////////////////////////////////////////////////////////////// 
 
-uint8_t adc_readJoystick_percent(void)
-{
-    uint8_t joystick_percent = adc_read10bValue_Percent(PIN_USER_JOYSTICK);
+uint8_t adc_getLatestJoystick_percent(void) { return latestJoystick_percent; }
+
+//////////////////////////////////////////////////////////////////////////////////// 
 
-    #ifdef INVERT_JOYSTICK_DIRECTION
-        joystick_percent = 100 - joystick_percent;
-    #endif
+uint16_t adc_readJoystick_counts(void) { return analogRead(PIN_USER_JOYSTICK); }
 
-    #ifdef SLIDER_IS_INSTALLED
-        // Apply the scaling and offset adjustment when the slider is installed
-        joystick_percent = 1.26 * joystick_percent - 13.5;
-    #endif
+//////////////////////////////////////////////////////////////////////////////////// 
+
+uint8_t adc_readJoystick_percent(void)
+{
+    uint8_t joystick_percent;
+
+    if(joystickCal_isCalibrated() == true)
+    {
+        //per-unit map from '$CAL' //also replaces SLIDER_IS_INSTALLED correction
+        joystick_percent = joystickCal_countsToPercent(adc_readJoystick_counts());
+
+        #ifdef INVERT_JOYSTICK_DIRECTION
+            joystick_percent = 100 - joystick_percent;
+        #endif
+    }
+    else
+    {
+        joystick_percent = adc_read10bValue_Percent(PIN_USER_JOYSTICK);
+
+        #ifdef INVERT_JOYSTICK_DIRECTION
+            joystick_percent = 100 - joystick_percent;
+        #endif
+
+        #ifdef SLIDER_IS_INSTALLED
+            // Apply the scaling and offset adjustment when the slider is installed
+            joystick_percent = 1.26 * joystick_percent - 13.5;
+        #endif
+    }
+
+    latestJoystick_percent = joystick_percent;
+    latency_inputSampled(LATENCY_INPUT_JOYSTICK, joystick_percent);
 
     return joystick_percent;
 }
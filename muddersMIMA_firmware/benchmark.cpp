@@ -0,0 +1,179 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Calls each hot function with Timer1 counting CPU cycles, then prints a CSV report and halts.
+//Run under simavr with ../HostTools/avrBenchmark/runBenchmark.sh (or on a Nano, with a serial terminal)
+
+#include "muddersMIMA.h"
+
+#ifdef RUN_BENCHMARKS
+
+//not exported by their modules' headers
+uint8_t adc_read10bValue_Percent(int adcChannel);
+void determineState_MAMODE1(void);
+extern "C" void PCINT0_vect(void);
+extern bool tachometerPin_previous;
+
+volatile uint8_t benchmark_result; //keeps the compiler from discarding return values
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void benchmark_overhead(void)     { ; }
+void benchmark_adcRead(void)      { benchmark_result = adc_read10bValue_Percent(PIN_MAMODE1_ECM); }
+void benchmark_remapCMDPWR(void)  { benchmark_result = ecm_getRemappedCMDPWR_percent(); }
+void benchmark_setMCM(void)       { mcm_setAllSignals(MAMODE1_STATE_IS_ASSIST, 75); }
+void benchmark_tachometerISR(void) { tachometerPin_previous = LOW; PCINT0_vect(); } //PIN_NEP is driven high, so each call is a rising edge (calculates RPM)
+void benchmark_imageCheck(void)    { imageCheck_restart(); imageCheck_handler(); } //each call hashes a full IMAGECHECK_BYTES_PER_LOOP block
+
+//instantiates every mode (normal builds only instantiate modes mapped in config.h)
+void benchmark_mode_OEM(void)                                 { operatingMode<mode_OEM>::instance.run();                                 }
+void benchmark_mode_INWORK_manualRegen_autoAssist(void)       { operatingMode<mode_INWORK_manualRegen_autoAssist>::instance.run();       }
+void benchmark_mode_manualAssistRegen_ignoreECM(void)         { operatingMode<mode_manualAssistRegen_ignoreECM>::instance.run();         }
+void benchmark_mode_manualAssistRegen_withAutoStartStop(void) { operatingMode<mode_manualAssistRegen_withAutoStartStop>::instance.run(); }
+void benchmark_mode_INWORK_PHEV_mudder(void)                  { operatingMode<mode_INWORK_PHEV_mudder>::instance.run();                  }
+void benchmark_mode_INWORK_PHEV_AfterEffect(void)             { operatingMode<mode_INWORK_PHEV_AfterEffect>::instance.run();             }
+
+struct benchmarkInfo
+{
+	char name[BENCHMARK_NAME_MAX_LENGTH + 1];
+	void (*function)(void);
+};
+
+//Add new benchmarks here
+const benchmarkInfo benchmarkTable[] PROGMEM = {
+	{ "overhead",                                 benchmark_overhead                                 }, //must be first
+	{ "adc_read10bValue_Percent",                 benchmark_adcRead                                  },
+	{ "determineState_MAMODE1",                   determineState_MAMODE1                             },
+	{ "ecm_getRemappedCMDPWR_percent",            benchmark_remapCMDPWR                              },
+	{ "mode_OEM",                                 benchmark_mode_OEM                                 },
+	{ "mode_INWORK_manualRegen_autoAssist",       benchmark_mode_INWORK_manualRegen_autoAssist       },
+	{ "mode_manualAssistRegen_ignoreECM",         benchmark_mode_manualAssistRegen_ignoreECM         },
+	{ "mode_manualAssistRegen_withAutoStartStop", benchmark_mode_manualAssistRegen_withAutoStartStop },
+	{ "mode_INWORK_PHEV_mudder",                  benchmark_mode_INWORK_PHEV_mudder                  },
+	{ "mode_INWORK_PHEV_AfterEffect",             benchmark_mode_INWORK_PHEV_AfterEffect             },
+	{ "mcm_setAllSignals",                        benchmark_setMCM                                   },
+	{ "PCINT0_vect",                              benchmark_tachometerISR                            },
+	{ "flightRecorder_handler",                   flightRecorder_handler                             },
+	{ "imageCheck_handler",                       benchmark_imageCheck                               },
+	{ "debugUSB_printButtonStates",               debugUSB_printButtonStates                         },
+	{ "debugUSB_printOEMsignals",                 debugUSB_printOEMsignals                           },
+	{ "debugUSB_printBinaryTelemetry",            debugUSB_printBinaryTelemetry                      },
+};
+
+#define NUM_BENCHMARKS (sizeof(benchmarkTable) / sizeof(benchmarkTable[0]))
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//debug printers fill the TX ring, which must be empty before the next call
+void benchmark_flushTX(void)
+{
+	while(debugUSB_txRing_bytesFree() < (DEBUGUSB_TX_RING_SIZE_BYTES - 1))
+	{
+		debugUSB_txHandler();
+		Serial.flush();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t benchmark_measure(void (*function)(void))
+{
+	benchmark_flushTX();
+
+	hal_cycleCounter_begin();
+	uint32_t startCycles = hal_cycleCounter_get();
+	function();
+	uint32_t stopCycles = hal_cycleCounter_get();
+	hal_cycleCounter_end();
+
+	return stopCycles - startCycles;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//report is printed after all benchmarks have run, so debug printer output can't land inside it
+struct benchmarkResult
+{
+	uint32_t minCycles;
+	uint32_t maxCycles;
+	uint32_t sumCycles;
+};
+
+benchmarkResult benchmarkResults[NUM_BENCHMARKS];
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void benchmark_printReport(void)
+{
+	benchmarkInfo info;
+
+	debugUSB_recordStart();
+	debugUSB_recordAppend_string(F("\n" BENCHMARK_REPORT_START "\nname,iterations,cycles_min,cycles_max,cycles_mean"));
+	debugUSB_recordCommit();
+	benchmark_flushTX();
+
+	for(uint8_t ii = 0; ii < NUM_BENCHMARKS; ii++)
+	{
+		memcpy_P(&info, &benchmarkTable[ii], sizeof(info));
+
+		debugUSB_recordStart();
+		debugUSB_recordAppend_char('\n');
+		for(uint8_t jj = 0; info.name[jj] != STRING_TERMINATION_CHARACTER; jj++) { debugUSB_recordAppend_char(info.name[jj]); }
+		debugUSB_recordAppend_char(',');
+		debugUSB_recordAppend_uint(BENCHMARK_ITERATIONS);
+		debugUSB_recordAppend_char(',');
+		debugUSB_recordAppend_uint(benchmarkResults[ii].minCycles);
+		debugUSB_recordAppend_char(',');
+		debugUSB_recordAppend_uint(benchmarkResults[ii].maxCycles);
+		debugUSB_recordAppend_char(',');
+		debugUSB_recordAppend_uint(benchmarkResults[ii].sumCycles / BENCHMARK_ITERATIONS);
+		debugUSB_recordCommit();
+		benchmark_flushTX();
+	}
+
+	debugUSB_recordStart();
+	debugUSB_recordAppend_string(F("\n" BENCHMARK_REPORT_END "\n"));
+	debugUSB_recordCommit();
+	benchmark_flushTX();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void benchmark_run(void)
+{
+	benchmarkInfo info;
+	uint32_t overheadCycles = 0;
+
+	pinMode(PIN_NEP, OUTPUT); //tachometer ISR only does work on rising edge
+	digitalWrite(PIN_NEP, HIGH);
+
+	for(uint8_t ii = 0; ii < NUM_BENCHMARKS; ii++)
+	{
+		memcpy_P(&info, &benchmarkTable[ii], sizeof(info));
+		benchmarkResult *result = &benchmarkResults[ii];
+
+		result->minCycles = UINT32_MAX;
+		result->maxCycles = 0;
+		result->sumCycles = 0;
+
+		for(uint8_t iteration = 0; iteration < BENCHMARK_ITERATIONS; iteration++)
+		{
+			uint32_t cycles = benchmark_measure(info.function);
+
+			if(cycles > overheadCycles) { cycles -= overheadCycles; } //zero while measuring overhead itself
+			else                        { cycles = 0;               }
+
+			if(cycles < result->minCycles) { result->minCycles = cycles; }
+			if(cycles > result->maxCycles) { result->maxCycles = cycles; }
+			result->sumCycles += cycles;
+		}
+
+		if(ii == 0) { overheadCycles = result->minCycles; } //'overhead' row
+	}
+
+	benchmark_printReport();
+
+	hal_halt();
+}
+
+#endif
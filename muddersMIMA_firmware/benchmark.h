@@ -0,0 +1,19 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//cycle count microbenchmarks: only compiled when RUN_BENCHMARKS is defined (see ../HostTools/avrBenchmark)
+
+#ifndef benchmark_h
+	#define benchmark_h
+
+	#define BENCHMARK_ITERATIONS      16 //each function is called this many times (results differ as module state changes)
+	#define BENCHMARK_NAME_MAX_LENGTH 40
+
+	//report is CSV, between these two lines: name,iterations,cycles_min,cycles_max,cycles_mean
+	//cycle counts exclude call & counter overhead (reported on the 'overhead' line)
+	#define BENCHMARK_REPORT_START "#BENCHMARK_START"
+	#define BENCHMARK_REPORT_END   "#BENCHMARK_END"
+
+	void benchmark_run(void); //never returns
+
+#endif
@@ -0,0 +1,53 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//binary telemetry record layout ('$DISP=BIN')
+//this file is also used by the host decoder (../HostTools/telemetryDecoder), so it must only use <stdint.h> types
+
+//each record is sent as: [0x00][COBS encoded (record + CRC16)][0x00]
+//CRC16: CCITT, reflected (poly 0x8408), initial value 0xFFFF, LSB first... identical to avr-libc's _crc_ccitt_update()
+//all multibyte fields are little endian
+
+#ifndef binaryTelemetry_h
+	#define binaryTelemetry_h
+
+	#define BINTELEM_RECORD_TYPE_V1 0xB1
+
+	#define BINTELEM_FRAME_DELIMITER 0x00
+	#define BINTELEM_CRC_INITIAL_VALUE 0xFFFF
+
+	//binaryTelemetry_record.inputFlags
+	#define BINTELEM_INPUT_ECM_MAMODE2_REGEN_STANDBY 0x01
+	#define BINTELEM_INPUT_BRAKE_LIGHTS_ON           0x02
+	#define BINTELEM_INPUT_CLUTCH_PRESSED            0x04
+	#define BINTELEM_INPUT_BUTTON_PRESSED            0x08
+	#define BINTELEM_INPUT_TOGGLE_SHIFT              4    //bits 4:5 store toggle position
+
+	//binaryTelemetry_record.outputFlags
+	#define BINTELEM_OUTPUT_MCM_MAMODE2_REGEN_STANDBY 0x01
+
+	struct __attribute__((packed)) binaryTelemetry_record
+	{
+		uint8_t  recordType;          //BINTELEM_RECORD_TYPE_V1
+		uint8_t  sequence;            //increments each record (so host can detect dropped records)
+		uint32_t timestamp_ms;
+		uint8_t  joystick_percent;
+		uint8_t  ECM_MAMODE1_percent;
+		uint8_t  ECM_CMDPWR_percent;
+		uint8_t  TPS_percent;
+		uint8_t  MAP_percent;
+		uint8_t  inputFlags;
+		uint8_t  ECM_MAMODE1_state;   //MAMODE1_STATE_IS_xxx
+		uint8_t  LiBCM_mode;
+		uint8_t  MCM_MAMODE1_percent;
+		uint8_t  MCM_CMDPWR_percent;
+		uint8_t  outputFlags;
+		uint16_t engineRPM;
+		uint16_t loopExecution_us;
+	};
+
+	#define BINTELEM_RECORD_SIZE_BYTES   (sizeof(struct binaryTelemetry_record))
+	#define BINTELEM_PAYLOAD_SIZE_BYTES  (BINTELEM_RECORD_SIZE_BYTES + 2) //record + CRC16
+	#define BINTELEM_ENCODED_SIZE_BYTES  (BINTELEM_PAYLOAD_SIZE_BYTES + 1) //COBS adds one byte per 254 bytes
+
+#endif
@@ -0,0 +1,126 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Each effect plays a PROGMEM table of PWM levels, one level every 'step_ms'.
+//The interrupt is only enabled while an effect is active.
+
+#include "muddersMIMA.h"
+
+//one cycle of gamma corrected raised cosine
+const uint8_t pulseLevels[] PROGMEM = {
+	  0,   0,   0,   0,   0,   1,   1,   2,   4,   6,   9,  14,  19,  26,  34,  44,
+	 55,  68,  82,  97, 113, 130, 147, 164, 180, 196, 210, 223, 234, 243, 250, 254,
+	255, 254, 250, 243, 234, 223, 210, 196, 180, 164, 147, 130, 113,  97,  82,  68,
+	 55,  44,  34,  26,  19,  14,   9,   6,   4,   2,   1,   1,   0,   0,   0,   0 };
+
+//one flash
+const uint8_t flashLevels[] PROGMEM = { 255, 255, 255, 0, 0, 0 };
+
+//regen intensity (0:100%, in 32 steps) to perceptually linear brightness (gamma 2.2)
+const uint8_t regenLevels[] PROGMEM = {
+	  0,   0,   1,   1,   3,   5,   7,  10,  13,  17,  21,  26,  32,  38,  44,  52,
+	 60,  68,  77,  87,  97, 108, 120, 132, 145, 159, 173, 188, 204, 220, 237, 255 };
+
+#define REGEN_LEVELS_MAX_INDEX ((sizeof(regenLevels) / sizeof(regenLevels[0])) - 1)
+
+//written by main loop only while interrupt is disabled
+volatile uint8_t activeEffect = BRAKE_EFFECT_NONE;
+const uint8_t *effectLevels = pulseLevels;
+uint8_t effectNumLevels = 0;
+uint8_t effectStep_ms = 1;
+volatile uint8_t effectRepeatsRemaining = 0; //0: repeat forever
+
+//only written by ISR
+uint8_t effectIndex = 0;
+uint8_t effectElapsed_ms = 0;
+
+volatile uint8_t regenIntensity_index = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void brakeLightEffects_disableInterrupt(void) { hal_timer0CompareA_disableInterrupt(); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+ISR(TIMER0_COMPA_vect)
+{
+	if(++effectElapsed_ms < effectStep_ms) { return; }
+	effectElapsed_ms = 0;
+
+	uint8_t level;
+
+	if(activeEffect == BRAKE_EFFECT_REGEN) { level = pgm_read_byte(&regenLevels[regenIntensity_index]); }
+	else
+	{
+		level = pgm_read_byte(&effectLevels[effectIndex]);
+
+		if(++effectIndex >= effectNumLevels)
+		{
+			effectIndex = 0;
+
+			if( (effectRepeatsRemaining > 0) && (--effectRepeatsRemaining == 0) )
+			{
+				//effect finished
+				level = 0;
+				activeEffect = BRAKE_EFFECT_NONE;
+				brakeLightEffects_disableInterrupt();
+			}
+		}
+	}
+
+	gpio_brakeLights_setPWM(level);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void brakeLightEffects_start(uint8_t effect, const uint8_t *levels, uint8_t numLevels, uint8_t step_ms, uint8_t numRepeats)
+{
+	brakeLightEffects_disableInterrupt();
+	brakeLights_cancelUnlatch();
+	gpio_brakeLights_connectPWM(); //ISR only writes the compare register
+
+	activeEffect = effect;
+	effectLevels = levels;
+	effectNumLevels = numLevels;
+	effectStep_ms = step_ms;
+	effectRepeatsRemaining = numRepeats;
+	effectIndex = 0;
+	effectElapsed_ms = step_ms - 1; //first level is output at next interrupt
+
+	hal_timer0CompareA_enableInterrupt(BRAKE_EFFECT_TIMER0_COMPARE_COUNTS);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void brakeLightEffects_pulse(void) { brakeLightEffects_start(BRAKE_EFFECT_PULSE, pulseLevels, sizeof(pulseLevels), BRAKE_EFFECT_PULSE_STEP_ms, 0); }
+void brakeLightEffects_regen(void) { brakeLightEffects_start(BRAKE_EFFECT_REGEN, regenLevels, sizeof(regenLevels), BRAKE_EFFECT_REGEN_STEP_ms, 0); }
+
+void brakeLightEffects_flash(uint8_t numFlashes)
+{
+	if(numFlashes == 0) { brakeLightEffects_stop(); return; }
+
+	brakeLightEffects_start(BRAKE_EFFECT_FLASH, flashLevels, sizeof(flashLevels), BRAKE_EFFECT_FLASH_STEP_ms, numFlashes);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void brakeLightEffects_stop(void)
+{
+	brakeLightEffects_disableInterrupt();
+	activeEffect = BRAKE_EFFECT_NONE;
+	gpio_brakeLights_turnOff(); //also disconnects PWM
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//single byte write, so ISR never sees a partial update
+void brakeLightEffects_setRegenIntensity(uint8_t regen_percent)
+{
+	if(regen_percent > 100) { regen_percent = 100; }
+
+	regenIntensity_index = (uint8_t)(((uint16_t)regen_percent * REGEN_LEVELS_MAX_INDEX) / 100);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t brakeLightEffects_getActive(void) { return activeEffect; }
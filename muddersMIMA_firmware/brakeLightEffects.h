@@ -0,0 +1,31 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//brake light effects (pulse, flash, regen proportional), stepped by a timer interrupt so they don't depend on loop period
+
+#ifndef brakeLightEffects_h
+	#define brakeLightEffects_h
+
+	#define BRAKE_EFFECT_NONE  0
+	#define BRAKE_EFFECT_PULSE 1 //repeats until stopped
+	#define BRAKE_EFFECT_FLASH 2 //flashes N times, then stops (brake lights off)
+	#define BRAKE_EFFECT_REGEN 3 //brightness follows brakeLightEffects_setRegenIntensity()
+
+	//effects are stepped by Timer0 compare A interrupt, which occurs once per Timer0 overflow (1.024 ms)
+	//Timer0 is also used by millis() and brake light PWM (OC0B), but compare A is otherwise unused (D6 is an input)
+	#define BRAKE_EFFECT_TIMER0_COMPARE_COUNTS 128 //any value works
+
+	#define BRAKE_EFFECT_PULSE_STEP_ms  8 //64 steps = 512 ms period
+	#define BRAKE_EFFECT_FLASH_STEP_ms 50 // 6 steps = 300 ms period
+	#define BRAKE_EFFECT_REGEN_STEP_ms  8 //brightness update period
+
+	void brakeLightEffects_pulse(void);
+	void brakeLightEffects_flash(uint8_t numFlashes);
+	void brakeLightEffects_regen(void);
+	void brakeLightEffects_stop(void); //brake lights off
+
+	void brakeLightEffects_setRegenIntensity(uint8_t regen_percent);
+
+	uint8_t brakeLightEffects_getActive(void);
+
+#endif
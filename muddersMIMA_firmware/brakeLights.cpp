@@ -4,64 +4,172 @@
 
 uint8_t brakeLightMode = BRAKE_LIGHT_AUTOMATIC;
 
+//written by Timer1 overflow ISR
+volatile uint8_t unlatchState = BRAKE_UNLATCH_IDLE;
+volatile uint8_t unlatchOverflowsRemaining = 0;
+volatile bool    isRelightRequested = NO; //ISR turns brake lights back on once BRAKE_uC is sampled
+
 ////////////////////////////////////////////////////////////////////////////////////
 
 void brakeLights_setControlMode(uint8_t newMode) { brakeLightMode = newMode; }
 
 ////////////////////////////////////////////////////////////////////////////////////
 
-void pulseBrakeLights(void)
+//continuous effects (PULSE/REGEN) are started once, then run from brakeLightEffects' ISR
+void brakeLights_runEffect(uint8_t effect)
 {
-	static int16_t pwmOutput_8bCounts = 0;
-	static bool isCountingUp = true;
-	uint8_t deltaCountsPerLoop = 10;
+	if(brakeLightEffects_getActive() != effect)
+	{
+		if(effect == BRAKE_EFFECT_PULSE) { brakeLightEffects_pulse(); }
+		else                             { brakeLightEffects_regen(); }
+	}
+
+	if(effect == BRAKE_EFFECT_REGEN) { brakeLightEffects_setRegenIntensity(mcm_getRegenStrength_percent()); }
+
+	gpio_setBrakePosition_bool(BRAKE_LIGHTS_ARE_OFF); //brake pedal can't be monitored while LiControl drives brake lights
+}
+
+////////////////////////////////////////////////////////////////////////////////////
 
-	if(isCountingUp == true) { pwmOutput_8bCounts += deltaCountsPerLoop; }
-	else                     { pwmOutput_8bCounts -= deltaCountsPerLoop; }
+void brakeLights_flash(uint8_t numFlashes) { brakeLightEffects_flash(numFlashes); }
 
-	if(pwmOutput_8bCounts > 255) { pwmOutput_8bCounts = 255; }
-	if(pwmOutput_8bCounts <   0) { pwmOutput_8bCounts =   0; }
+////////////////////////////////////////////////////////////////////////////////////
 
-	if(pwmOutput_8bCounts == 255 ) { isCountingUp = false; }
-	if(pwmOutput_8bCounts ==   0 ) { isCountingUp = true;  }
+//steps through unlatch sequence (started by unlatchSignal_BRAKE_uC()), so loop() never waits for BRAKE_uC
+ISR(TIMER1_OVF_vect)
+{
+	if(--unlatchOverflowsRemaining > 0) { return; }
 
-	analogWrite(PIN_BRAKE, pwmOutput_8bCounts);
+	if(unlatchState == BRAKE_UNLATCH_PULLED_LOW)
+	{
+		//if brake pedal released, BRAKE_uC is now low (~0.7 volts due to diode drop)
+		//if brake pedal pressed,  BRAKE_uC takes 200 us to pullup to 4V ~= Vih(min)
+		gpio_brakeLights_floatPin(); //allows LiControl to check brake status
+		unlatchState = BRAKE_UNLATCH_SETTLING;
+		unlatchOverflowsRemaining = BRAKE_UNLATCH_SETTLE_OVERFLOWS;
+	}
+	else
+	{
+		gpio_setBrakePosition_bool(gpio_readBrakePin_bool());
+		if(isRelightRequested == YES) { gpio_brakeLights_turnOn(); isRelightRequested = NO; }
+		unlatchState = BRAKE_UNLATCH_IDLE;
+		hal_timer1Overflow_disableInterrupt();
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
 
+//LiControl's high-side driver remains latched on after user removes foot from brake pedal
+//thus, the brake lights will stay on unless we briefly force the high-side driver off
+//brake position is published by the ISR ~0.5 ms later (i.e. gpio_getBrakePosition_bool() lags by one loop)
 void unlatchSignal_BRAKE_uC(void)
 {
-	//LiControl's high-side driver remains latched on after user removes foot from brake pedal
-	//thus, the brake lights will stay on unless we briefly force the high-side driver off 
-	if (gpio_getBrakePosition_bool() == BRAKE_LIGHTS_ARE_ON)
+	if(unlatchState != BRAKE_UNLATCH_IDLE) { return; } //previous sequence still running (only possible if loop period is under 1 ms)
+
+	if(gpio_readBrakePin_bool() == BRAKE_LIGHTS_ARE_ON)
 	{
 		//either the brake pedal is pressed or the high-side driver is latched (we don't know)
 		gpio_brakeLights_turnOff(); //if brake released, pulling BRAKE_uC low turns high-side driver off
-		delayMicroseconds(100); //if brake released, BRAKE_RAW discharges to ground in 75 us
-		//if brake pedal released, BRAKE_uC is now low (~0.7 volts due to diode drop)
-		//if brake pedal pressed,  BRAKE_uC takes 200 us to pullup to 4V ~= Vih(min)
+		unlatchState = BRAKE_UNLATCH_PULLED_LOW;
+		unlatchOverflowsRemaining = BRAKE_UNLATCH_PULL_LOW_OVERFLOWS;
+	}
+	else
+	{
+		gpio_brakeLights_floatPin(); //pin might have been driven low by a different brake light mode
+		unlatchState = BRAKE_UNLATCH_SETTLING;
+		unlatchOverflowsRemaining = BRAKE_UNLATCH_SETTLE_OVERFLOWS;
 	}
-	
-	gpio_brakeLights_floatPin(); //allows LiControl to check brake status
+
+	hal_timer1Overflow_enableInterrupt();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+//call before LiControl drives the brake pin directly
+void brakeLights_cancelUnlatch(void)
+{
+	hal_timer1Overflow_disableInterrupt();
+	unlatchState = BRAKE_UNLATCH_IDLE;
+	isRelightRequested = NO;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
 
-uint8_t brakeLights_handler(void)
+//when LiControl drives the brake pin, it reads back whatever LiControl drives
+void brakeLights_drive(bool lightState)
 {
-	if(brakeLightMode == BRAKE_LIGHT_AUTOMATIC)
+	brakeLights_cancelUnlatch();
+
+	if(lightState == BRAKE_LIGHTS_ARE_ON) { gpio_brakeLights_turnOn();  }
+	else                                  { gpio_brakeLights_turnOff(); }
+
+	gpio_setBrakePosition_bool(lightState);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+//acts on signals sent to MCM (rather than joystick), so it works the same in every mode
+//hysteresis and minimum on-time prevent flicker when regen hovers near threshold
+bool brakeLights_isRegenStrong(void)
+{
+	static bool areLightsOn = NO;
+	static uint32_t turnedOn_ms = 0;
+
+	uint8_t regen_percent = mcm_getRegenStrength_percent();
+
+	if(areLightsOn == NO)
 	{
-		uint8_t joystickPercent = adc_readJoystick_percent();
+		if(regen_percent >= param.brakeLightsOnAboveRegen_percent) { areLightsOn = YES; turnedOn_ms = millis(); }
+	}
+	else if( (regen_percent < param.brakeLightsOffBelowRegen_percent) &&
+	         ((millis() - turnedOn_ms) >= param.brakeLightsMinOnTime_ms) ) { areLightsOn = NO; }
+
+	return areLightsOn;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
 
-		//brake light control logic
-		//JTS2doNow: When brake pressed, gpio_getBrakePosition_bool() alternates between "Lights ON" & "Lights OFF"
-		if     (joystickPercent < JOYSTICK_MIN_ALLOWED_PERCENT)                { gpio_brakeLights_turnOff(); } //joystick input too low	
-		else if(joystickPercent < TURN_BRAKE_LIGHTS_ON_BELOW_JOYSTICK_PERCENT) { gpio_brakeLights_turnOn();  } //strong regen
-		else                                                                   { unlatchSignal_BRAKE_uC();   }
+//sampling BRAKE_uC turns the brake lights off for ~0.5 ms, so during strong regen it's only sampled every BRAKE_SAMPLE_DURING_REGEN_ms
+//otherwise a brake release during strong regen would go unseen, and PHEV modes would keep passing ECM regen through (keeping regen strong)
+//unlike brakeLights_drive(), the lights LiControl turns on aren't reported as braking (PHEV modes request ECM regen while braking)
+void brakeLights_automatic(void)
+{
+	static uint32_t latestSample_ms = 0;
+
+	if(brakeLights_isRegenStrong() == NO)
+	{
+		isRelightRequested = NO;
+		unlatchSignal_BRAKE_uC(); //sampled every loop
+		latestSample_ms = millis();
 	}
-	else if(brakeLightMode == BRAKE_LIGHT_MONITOR_ONLY) { unlatchSignal_BRAKE_uC();   }
-	else if(brakeLightMode == BRAKE_LIGHT_OEM)          { gpio_brakeLights_turnOff(); }
-	else if(brakeLightMode == BRAKE_LIGHT_FORCE_ON)     { gpio_brakeLights_turnOn();  }
-	else if(brakeLightMode == BRAKE_LIGHT_PULSE)        { pulseBrakeLights();         }
+	else if(unlatchState != BRAKE_UNLATCH_IDLE) { ; } //sample in progress
+	else if( (millis() - latestSample_ms) >= BRAKE_SAMPLE_DURING_REGEN_ms )
+	{
+		isRelightRequested = YES;
+		unlatchSignal_BRAKE_uC();
+		latestSample_ms = millis();
+	}
+	else { gpio_brakeLights_turnOn(); }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+//call after operatingModes_handler(), so this loop's regen request is used
+void brakeLights_handler(void)
+{
+	uint8_t activeEffect = brakeLightEffects_getActive();
+
+	if(activeEffect == BRAKE_EFFECT_FLASH) { return; } //flash always finishes
+
+	if( ((activeEffect == BRAKE_EFFECT_PULSE) && (brakeLightMode != BRAKE_LIGHT_PULSE)) ||
+		((activeEffect == BRAKE_EFFECT_REGEN) && (brakeLightMode != BRAKE_LIGHT_REGEN))  ) { brakeLightEffects_stop(); }
+
+	//JTS2doNow: When brake pressed, gpio_getBrakePosition_bool() alternates between "Lights ON" & "Lights OFF"
+	//           (BRAKE_uC is now sampled after it settles, which should fix this... verify in car)
+	if     (brakeLightMode == BRAKE_LIGHT_AUTOMATIC)    { brakeLights_automatic();                 }
+	else if(brakeLightMode == BRAKE_LIGHT_MONITOR_ONLY) { unlatchSignal_BRAKE_uC();                }
+	else if(brakeLightMode == BRAKE_LIGHT_OEM)          { brakeLights_drive(BRAKE_LIGHTS_ARE_OFF); }
+	else if(brakeLightMode == BRAKE_LIGHT_FORCE_ON)     { brakeLights_drive(BRAKE_LIGHTS_ARE_ON);  }
+	else if(brakeLightMode == BRAKE_LIGHT_PULSE)        { brakeLights_runEffect(BRAKE_EFFECT_PULSE); }
+	else if(brakeLightMode == BRAKE_LIGHT_REGEN)        { brakeLights_runEffect(BRAKE_EFFECT_REGEN); }
 }
\ No newline at end of file
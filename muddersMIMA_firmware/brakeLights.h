@@ -1,16 +1,30 @@
 #ifndef brakeLights_h
 	#define brakeLights_h
 
-	#define TURN_BRAKE_LIGHTS_ON_BELOW_JOYSTICK_PERCENT 35 //valid range is 10:45%
-	
-	#define BRAKE_LIGHT_AUTOMATIC    1 //LiControl turns brake lights on during heavy regen
+	#define BRAKE_LIGHT_AUTOMATIC    1 //LiControl turns brake lights on during heavy regen (and monitors brake status)
 	#define BRAKE_LIGHT_FORCE_ON     2 //LiControl turns brake lights on continuously
 	#define BRAKE_LIGHT_MONITOR_ONLY 3 //LiControl can    determine brake status
 	#define BRAKE_LIGHT_OEM          4 //LiControl cannot determine brake status
 	#define BRAKE_LIGHT_PULSE        8 //LiControl continuously pulses brake lights
+	#define BRAKE_LIGHT_REGEN        9 //brake light brightness follows regen strength (brake pedal not monitored)
+
+	//unlatch sequence is timed by Timer1 overflow interrupt //Timer1 is 8b fast PWM, prescaler x8 (see gpio_begin())
+	#define TIMER1_OVERFLOW_PERIOD_us 128
+	#define BRAKE_UNLATCH_PULL_LOW_OVERFLOWS 2 //128:256 us //BRAKE_RAW discharges to ground in 75 us
+	#define BRAKE_UNLATCH_SETTLE_OVERFLOWS   3 //256:384 us //BRAKE_uC takes 200 us to pullup when brake pedal pressed
+
+	//BRAKE_LIGHT_AUTOMATIC: during strong regen, the lights are turned off for one unlatch sequence this often, so brake pedal releases are still seen
+	#define BRAKE_SAMPLE_DURING_REGEN_ms 100
+
+	#define BRAKE_UNLATCH_IDLE       0
+	#define BRAKE_UNLATCH_PULLED_LOW 1
+	#define BRAKE_UNLATCH_SETTLING   2
 
 	void brakeLights_setControlMode(uint8_t newMode);
+	void brakeLights_cancelUnlatch(void);
+
+	void brakeLights_flash(uint8_t numFlashes); //overrides control mode until finished
 
-	uint8_t brakeLights_handler(void);
+	void brakeLights_handler(void);
 
 #endif
@@ -17,43 +17,78 @@
 	#define INVERT_JOYSTICK_DIRECTION //comment to mirror joystick assist and regen directions
 
   //Adjusts output for sliders that output 20-84% range rather than 5-95%. Added for Balto.
+  //Ignored once joystick is calibrated ('$CAL')
   //#define SLIDER_IS_INSTALLED
 
-  //Maximum engine RPM before assist is disabled
-  const uint16_t MAX_RPM = 5500; 
+  //Measures CPU cycles used by each hot function, prints a CSV report, then halts (see ../HostTools/avrBenchmark)
+  //Never install this build in a car
+  //#define RUN_BENCHMARKS
 
-  //Configurable delay after clutch depressed before assist re-enabled (in ms)
-  const uint16_t CLUTCH_DELAY = 500; 
+  //Sleeps once the key has been off for 10 seconds (and nothing was typed for 60 seconds), so LiControl doesn't drain the 12V battery (see powerSave.h)
+  //Comment to keep LiControl running while the key is off (e.g. to watch '$DISP' output without typing)
+  #define POWER_DOWN_AT_KEYOFF
 
-  //RPM under which the IMA will derate output to avoid errors
-  const uint16_t DERATE_UNDER_RPM = 2000; 
+  //Default values for runtime parameters (see parameters.cpp for allowed ranges)
+  //Type '$GET' to view, '$SET=NAME=___' to change, and '$SAVE' to store in EEPROM (no reflash required)
 
-  //Output percent to derate TO if under DERATE_UNDER_RPM
-  const uint8_t DERATE_PERCENT = 80; 
+  //Maximum engine RPM before assist is disabled ('MAXRPM')
+  #define MAX_RPM_DEFAULT 5500
 
-  //Time to ramp from 0 to joystick value (in ms)
-  const uint16_t RAMP_UP_DURATION = 250;
+  //Configurable delay after clutch depressed before assist re-enabled ('CLUTCHDLY')
+  #define CLUTCH_DELAY_DEFAULT_ms 500
 
-	//choose behavior when three position switch...
+  //RPM under which the IMA will derate output to avoid errors ('DERATERPM')
+  #define DERATE_UNDER_RPM_DEFAULT 2000
+
+  //Output percent to derate TO if under DERATE_UNDER_RPM ('DERATEPCT')
+  #define DERATE_PERCENT_DEFAULT 80
+
+  //Time to ramp from 0 to joystick value ('RAMPUP')
+  #define RAMP_UP_DURATION_DEFAULT_ms 250
+
+  //Joystick is neutral within this many percent of JOYSTICK_NEUTRAL_NOM_PERCENT ('JDEADBAND') //datasheet specifies ±4%
+  #define JOYSTICK_DEADBAND_DEFAULT_PERCENT 5
+
+  //Brake lights turn on when regen sent to MCM is at least this strong ('BRAKEON') //100% is CMDPWR=10%
+  #define BRAKE_LIGHTS_ON_ABOVE_REGEN_DEFAULT_PERCENT 38 //same as previous joystick threshold (35%)
+
+  //...and turn off once regen drops below this percent ('BRAKEOFF') //must be lower than BRAKEON
+  #define BRAKE_LIGHTS_OFF_BELOW_REGEN_DEFAULT_PERCENT 25
+
+  //...but stay on for at least this long ('BRAKEMIN')
+  #define BRAKE_LIGHTS_MIN_ON_TIME_DEFAULT_ms 500
+
+  //Brake light behavior in every mode except mode_OEM
+  //BRAKE_LIGHT_AUTOMATIC: on during strong regen ('BRAKEON'/'BRAKEOFF'/'BRAKEMIN'), and the brake pedal is monitored
+  //BRAKE_LIGHT_REGEN:     brightness follows regen strength, but the brake pedal isn't monitored (modes can't tell when user is braking)
+  #define BRAKE_LIGHT_BEHAVIOR BRAKE_LIGHT_AUTOMATIC
+
+	//choose behavior (an operatingModes.h class) when three position switch...
 	//...is in the '0' position
-		  #define MODE0_BEHAVIOR() mode_OEM()
-		//#define MODE0_BEHAVIOR() mode_manualAssistRegen_withAutoStartStop();
-		//#define MODE0_BEHAVIOR() mode_manualAssistRegen_ignoreECM();
-		//#define MODE0_BEHAVIOR() mode_INWORK_PHEV_mudder();
-    //#define MODE1_BEHAVIOR() mode_INWORK_PHEV_AfterEffect();
+		  #define MODE0_BEHAVIOR mode_OEM
+		//#define MODE0_BEHAVIOR mode_manualAssistRegen_withAutoStartStop
+		//#define MODE0_BEHAVIOR mode_manualAssistRegen_ignoreECM
+		//#define MODE0_BEHAVIOR mode_INWORK_PHEV_mudder
+    //#define MODE1_BEHAVIOR mode_INWORK_PHEV_AfterEffect
 
 	//...is in the '1' position
-		//#define MODE1_BEHAVIOR() mode_OEM()
-	  //#define MODE1_BEHAVIOR() mode_manualAssistRegen_withAutoStartStop();
-		//#define MODE1_BEHAVIOR() mode_manualAssistRegen_ignoreECM();
-		#define MODE1_BEHAVIOR() mode_INWORK_PHEV_mudder();
-    //#define MODE1_BEHAVIOR() mode_INWORK_PHEV_AfterEffect();
+		//#define MODE1_BEHAVIOR mode_OEM
+	  //#define MODE1_BEHAVIOR mode_manualAssistRegen_withAutoStartStop
+		//#define MODE1_BEHAVIOR mode_manualAssistRegen_ignoreECM
+		#define MODE1_BEHAVIOR mode_INWORK_PHEV_mudder
+    //#define MODE1_BEHAVIOR mode_INWORK_PHEV_AfterEffect
 
 	//...is in the '2' position
-		//#define MODE2_BEHAVIOR() mode_OEM()
-		//#define MODE2_BEHAVIOR() mode_manualAssistRegen_withAutoStartStop();
-	  //#define MODE2_BEHAVIOR() mode_manualAssistRegen_ignoreECM();
-		//#define MODE2_BEHAVIOR() mode_INWORK_PHEV_mudder();
-    #define MODE2_BEHAVIOR() mode_INWORK_PHEV_AfterEffect();
+		//#define MODE2_BEHAVIOR mode_OEM
+		//#define MODE2_BEHAVIOR mode_manualAssistRegen_withAutoStartStop
+	  //#define MODE2_BEHAVIOR mode_manualAssistRegen_ignoreECM
+		//#define MODE2_BEHAVIOR mode_INWORK_PHEV_mudder
+    #define MODE2_BEHAVIOR mode_INWORK_PHEV_AfterEffect
+
+	//choose behavior when LiBCM commands a mode (overrides three position switch until LiBCM data goes stale)
+		#define LIBCM_MODE_OEM_BEHAVIOR            mode_OEM
+		#define LIBCM_MODE_BLENDED_BEHAVIOR        mode_INWORK_PHEV_mudder
+		#define LIBCM_MODE_MANUAL_REGEN_BEHAVIOR   mode_INWORK_manualRegen_autoAssist
+		#define LIBCM_MODE_OLD_BEHAVIOR            mode_manualAssistRegen_withAutoStartStop
 
 #endif
\ No newline at end of file
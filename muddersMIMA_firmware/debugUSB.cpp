@@ -11,6 +11,14 @@
 uint8_t dataTypeToStream = DEBUGUSB_STREAM_BUTTON;
 uint32_t dataUpdatePeriod_ms = 250;
 
+uint8_t txRing[DEBUGUSB_TX_RING_SIZE_BYTES];
+uint8_t txRing_head = 0; //next committed byte is stored here
+uint8_t txRing_tail = 0; //next byte to send
+uint8_t recordHead = 0;  //next byte in the record presently being formatted is stored here
+bool isRecordOverflowed = NO;
+uint16_t droppedRecords = 0;
+PGM_P longFlashString = NULL; //next character to copy into TX ring (NULL when nothing pending)
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 void    debugUSB_dataTypeToStream_set(uint8_t dataType) { dataTypeToStream = dataType; }
@@ -23,96 +31,313 @@ uint16_t debugUSB_dataUpdatePeriod_ms_get(void) { return dataUpdatePeriod_ms; }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
+//records are formatted directly into the ring's free space, but only become visible to debugUSB_txHandler() when committed
+void debugUSB_recordStart(void)
+{
+	recordHead = txRing_head;
+	isRecordOverflowed = NO;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void debugUSB_recordAppend_char(char character)
+{
+	uint8_t nextHead = recordHead + 1; //wraps at 256
+
+	if(nextHead == txRing_tail) { isRecordOverflowed = YES; } //ring is full (one byte is always left empty)
+	else if(isRecordOverflowed == NO)
+	{
+		txRing[recordHead] = character;
+		recordHead = nextHead;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void debugUSB_recordAppend_string(const __FlashStringHelper *flashString)
+{
+	PGM_P pointer = reinterpret_cast<PGM_P>(flashString);
+	char character = pgm_read_byte(pointer++);
+
+	while(character != STRING_TERMINATION_CHARACTER)
+	{
+		debugUSB_recordAppend_char(character);
+		character = pgm_read_byte(pointer++);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//integer-only formatter
+//numDecimalPlaces: e.g. value=1234 & numDecimalPlaces=2 prints "12.34"
+void debugUSB_recordAppend_fixedPoint(uint32_t value, uint8_t numDecimalPlaces)
+{
+	char digits[10]; //uint32_t max is 10 digits
+	uint8_t numDigits = 0;
+
+	if(value <= 0xFFFF)
+	{
+		//16b division is much faster on 328p
+		uint16_t value16 = (uint16_t)value;
+		do { digits[numDigits++] = '0' + (value16 % 10); value16 /= 10; } while(value16 != 0);
+	}
+	else { do { digits[numDigits++] = '0' + (value % 10); value /= 10; } while(value != 0); }
+
+	while( (numDigits <= numDecimalPlaces) && (numDigits < sizeof(digits)) ) { digits[numDigits++] = '0'; } //leading zeros (e.g. "0.05")
+
+	while(numDigits > 0)
+	{
+		if( (numDigits == numDecimalPlaces) && (numDecimalPlaces != 0) ) { debugUSB_recordAppend_char('.'); }
+		debugUSB_recordAppend_char(digits[--numDigits]);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void debugUSB_recordAppend_uint(uint32_t value) { debugUSB_recordAppend_fixedPoint(value, 0); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//whole record is sent, or whole record is dropped
+bool debugUSB_recordCommit(void)
+{
+	if(isRecordOverflowed == YES)
+	{
+		if(droppedRecords < 0xFFFF) { droppedRecords++; }
+		return false;
+	}
+
+	txRing_head = recordHead;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t debugUSB_droppedRecords_get(void) { return droppedRecords; }
+
+uint8_t debugUSB_txRing_bytesFree(void) { return (uint8_t)(txRing_tail - txRing_head - 1); } //wraps at 256
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//only one long string can be pending; a new one replaces any unsent portion of the previous one
+void debugUSB_printLongFlashString(const __FlashStringHelper *flashString) { longFlashString = reinterpret_cast<PGM_P>(flashString); }
+
+bool debugUSB_isLongFlashStringPending(void) { return (longFlashString != NULL); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//copy as much of the long string as fits into the TX ring's free space
+void debugUSB_copyLongFlashStringToRing(void)
+{
+	if(longFlashString == NULL) { return; }
+
+	while( (uint8_t)(txRing_head + 1) != txRing_tail ) //ring isn't full
+	{
+		char character = pgm_read_byte(longFlashString);
+
+		if(character == STRING_TERMINATION_CHARACTER) { longFlashString = NULL; return; } //entire string copied
+
+		txRing[txRing_head++] = character; //wraps at 256
+		longFlashString++;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//only moves as many bytes as the Serial buffer can hold, so Serial.write() never blocks
+//Serial's UDRE ISR then sends the Serial buffer in the background
+void debugUSB_txHandler(void)
+{
+	debugUSB_copyLongFlashStringToRing();
+
+	int numBytesAllowed = Serial.availableForWrite();
+
+	while( (numBytesAllowed > 0) && (txRing_tail != txRing_head) )
+	{
+		Serial.write(txRing[txRing_tail++]); //wraps at 256
+		numBytesAllowed--;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
 void debugUSB_displayUptime_seconds(void)
 {
-	Serial.print(F("\nUptime(s): "));
-	Serial.print( String(millis() * 0.001) );
+	debugUSB_recordStart();
+	debugUSB_recordAppend_string(F("\nUptime(s): "));
+	debugUSB_recordAppend_fixedPoint(millis() / 10, TWO_DECIMAL_PLACES);
+	debugUSB_recordCommit();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 void debugUSB_printButtonStates(void)
 {	
-	Serial.print(F("\nButton:"));
-	if(gpio_getButton_momentary() == BUTTON_NOT_PRESSED) { Serial.print(F("UP")); }
-	else                                                 { Serial.print(F("DN")); }
+	debugUSB_recordStart();
 
-	Serial.print(F(", Mode"));
+	debugUSB_recordAppend_string(F("\nButton:"));
+	if(gpio_getButton_momentary() == BUTTON_NOT_PRESSED) { debugUSB_recordAppend_string(F("UP")); }
+	else                                                 { debugUSB_recordAppend_string(F("DN")); }
+
+	debugUSB_recordAppend_string(F(", Mode"));
 	switch(gpio_getButton_toggle() )
 	{
-		case TOGGLE_POSITION0: Serial.print('0'); break;
-		case TOGGLE_POSITION1: Serial.print('1'); break;
-		case TOGGLE_POSITION2: Serial.print('2'); break;
-		case TOGGLE_POSITION3: Serial.print('3'); break;
+		case TOGGLE_POSITION0: debugUSB_recordAppend_char('0'); break;
+		case TOGGLE_POSITION1: debugUSB_recordAppend_char('1'); break;
+		case TOGGLE_POSITION2: debugUSB_recordAppend_char('2'); break;
+		case TOGGLE_POSITION3: debugUSB_recordAppend_char('3'); break;
 	}
 
-	Serial.print(F(", Joystick: "));
-	Serial.print(adc_readJoystick_percent(),DEC);
+	debugUSB_recordAppend_string(F(", Joystick: "));
+	debugUSB_recordAppend_uint(adc_readJoystick_percent());
+
+	debugUSB_recordCommit();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 void debugUSB_printOEMsignals(void)
 {
-	Serial.print(F("\nMAMODE2:"));
-	if(ecm_getMAMODE2_state() == MAMODE2_STATE_IS_ASSIST) { Serial.print(F("Assist,  ")); }
-	else                                                  { Serial.print(F("Reg/Idle,")); }
+	debugUSB_recordStart();
+
+	debugUSB_recordAppend_string(F("\nMAMODE2:"));
+	if(ecm_getMAMODE2_state() == MAMODE2_STATE_IS_ASSIST) { debugUSB_recordAppend_string(F("Assist,  ")); }
+	else                                                  { debugUSB_recordAppend_string(F("Reg/Idle,")); }
 
-	Serial.print(F(" MAMODE1:"));
-	Serial.print(adc_getECM_MAMODE1_percent());
-	Serial.print('%');
+	debugUSB_recordAppend_string(F(" MAMODE1:"));
+	debugUSB_recordAppend_uint(adc_getECM_MAMODE1_percent());
+	debugUSB_recordAppend_char('%');
 	switch( ecm_getMAMODE1_state() )
 	{
-		case MAMODE1_STATE_IS_ERROR_LO:  Serial.print(F("Line LO, ")); break;
-		case MAMODE1_STATE_IS_PRESTART:  Serial.print(F("Prestart,")); break;
-		case MAMODE1_STATE_IS_ASSIST:    Serial.print(F("Assist,  ")); break;
-		case MAMODE1_STATE_IS_REGEN:     Serial.print(F("Regen,   ")); break;
-		case MAMODE1_STATE_IS_IDLE:      Serial.print(F("Standby, ")); break;
-		case MAMODE1_STATE_IS_AUTOSTOP:  Serial.print(F("AutoStop,")); break;
-		case MAMODE1_STATE_IS_START:     Serial.print(F("Starting,")); break;
-		case MAMODE1_STATE_IS_ERROR_HI:  Serial.print(F("Line HI, ")); break;
-		case MAMODE1_STATE_IS_UNDEFINED: Serial.print(F("Error,   ")); break;
+		case MAMODE1_STATE_IS_ERROR_LO:  debugUSB_recordAppend_string(F("Line LO, ")); break;
+		case MAMODE1_STATE_IS_PRESTART:  debugUSB_recordAppend_string(F("Prestart,")); break;
+		case MAMODE1_STATE_IS_ASSIST:    debugUSB_recordAppend_string(F("Assist,  ")); break;
+		case MAMODE1_STATE_IS_REGEN:     debugUSB_recordAppend_string(F("Regen,   ")); break;
+		case MAMODE1_STATE_IS_IDLE:      debugUSB_recordAppend_string(F("Standby, ")); break;
+		case MAMODE1_STATE_IS_AUTOSTOP:  debugUSB_recordAppend_string(F("AutoStop,")); break;
+		case MAMODE1_STATE_IS_START:     debugUSB_recordAppend_string(F("Starting,")); break;
+		case MAMODE1_STATE_IS_ERROR_HI:  debugUSB_recordAppend_string(F("Line HI, ")); break;
+		case MAMODE1_STATE_IS_UNDEFINED: debugUSB_recordAppend_string(F("Error,   ")); break;
+	}
+
+	debugUSB_recordAppend_string(F(" CLUTCH:"));
+	if(gpio_getClutchPosition() == CLUTCH_PEDAL_PRESSED) { debugUSB_recordAppend_string(F("Pressed, ")); }
+	else                                                 { debugUSB_recordAppend_string(F("Released,")); }
+
+	debugUSB_recordAppend_string(F(" BRAKE:"));
+	if(gpio_getBrakePosition_bool() == BRAKE_LIGHTS_ARE_ON) { debugUSB_recordAppend_string(F("Pressed, ")); }
+	else                                                    { debugUSB_recordAppend_string(F("Released,")); }
+
+	debugUSB_recordAppend_string(F(" CMDPWR:"));
+	debugUSB_recordAppend_uint( ecm_getCMDPWR_percent() );
+	debugUSB_recordAppend_char('%');
+
+	debugUSB_recordAppend_string(F(" TPS:"));
+	debugUSB_recordAppend_uint( adc_getECM_TPS_percent() );
+	debugUSB_recordAppend_char('%');
+
+	debugUSB_recordAppend_string(F(" MAP:"));
+	debugUSB_recordAppend_uint( adc_getECM_MAP_percent() );
+	debugUSB_recordAppend_char('%');
+
+	debugUSB_recordAppend_string(F(" RPM:"));
+	debugUSB_recordAppend_uint( engineSignals_getLatestRPM() );
+
+	debugUSB_recordCommit();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//Consistent Overhead Byte Stuffing: removes all 0x00 bytes from payload, so 0x00 can delimit each frame
+//each 0x00 is replaced with the distance to the next 0x00 (the last 'next 0x00' is implied at the end)
+void debugUSB_recordAppend_COBS(const uint8_t *payload, uint8_t numBytes)
+{
+	uint8_t encoded[BINTELEM_ENCODED_SIZE_BYTES];
+	uint8_t codeIndex = 0; //where the distance to the next zero is stored
+	uint8_t encodedIndex = 1;
+	uint8_t distance = 1;
+
+	for(uint8_t ii = 0; ii < numBytes; ii++)
+	{
+		if(payload[ii] == 0)
+		{
+			encoded[codeIndex] = distance;
+			codeIndex = encodedIndex++;
+			distance = 1;
+		}
+		else
+		{
+			encoded[encodedIndex++] = payload[ii];
+			distance++;
+		}
 	}
+	encoded[codeIndex] = distance;
 
-	Serial.print(F(" CLUTCH:"));
-	if(gpio_getClutchPosition() == CLUTCH_PEDAL_PRESSED) { Serial.print(F("Pressed, ")); }
-	else                                                 { Serial.print(F("Released,")); }
+	for(uint8_t ii = 0; ii < encodedIndex; ii++) { debugUSB_recordAppend_char(encoded[ii]); }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
 
-	Serial.print(F(" BRAKE:"));
-	if(gpio_getBrakePosition_bool() == BRAKE_LIGHTS_ARE_ON) { Serial.print(F("Pressed, ")); }
-	else                                                    { Serial.print(F("Released,")); }
+//~30 bytes per record, versus ~130 bytes for debugUSB_printOEMsignals()
+void debugUSB_printBinaryTelemetry(void)
+{
+	static uint8_t sequence = 0;
+	uint8_t payload[BINTELEM_PAYLOAD_SIZE_BYTES];
+	struct binaryTelemetry_record *record = (struct binaryTelemetry_record *)payload;
 
-	Serial.print(F(" CMDPWR:"));
-	Serial.print( ecm_getCMDPWR_percent() );
-	Serial.print('%');
+	uint8_t inputFlags = (gpio_getButton_toggle() << BINTELEM_INPUT_TOGGLE_SHIFT);
+	if(ecm_getMAMODE2_state()       == MAMODE2_STATE_IS_REGEN_STANDBY) { inputFlags |= BINTELEM_INPUT_ECM_MAMODE2_REGEN_STANDBY; }
+	if(gpio_getBrakePosition_bool() == BRAKE_LIGHTS_ARE_ON           ) { inputFlags |= BINTELEM_INPUT_BRAKE_LIGHTS_ON;           }
+	if(gpio_getClutchPosition()     == CLUTCH_PEDAL_PRESSED          ) { inputFlags |= BINTELEM_INPUT_CLUTCH_PRESSED;            }
+	if(gpio_getButton_momentary()   == BUTTON_PRESSED                ) { inputFlags |= BINTELEM_INPUT_BUTTON_PRESSED;            }
 
-	Serial.print(F(" TPS:"));
-	Serial.print( adc_getECM_TPS_percent() );
-	Serial.print('%');
+	record->recordType          = BINTELEM_RECORD_TYPE_V1;
+	record->sequence            = sequence++;
+	record->timestamp_ms        = millis();
+	record->joystick_percent    = adc_readJoystick_percent();
+	record->ECM_MAMODE1_percent = ecm_getMAMODE1_percent();
+	record->ECM_CMDPWR_percent  = ecm_getCMDPWR_percent();
+	record->TPS_percent         = adc_getECM_TPS_percent();
+	record->MAP_percent         = adc_getECM_MAP_percent();
+	record->inputFlags          = inputFlags;
+	record->ECM_MAMODE1_state   = ecm_getMAMODE1_state();
+	record->LiBCM_mode          = LiBCM_getCommandedMode();
+	record->MCM_MAMODE1_percent = gpio_getMCM_MAMODE1_percent();
+	record->MCM_CMDPWR_percent  = gpio_getMCM_CMDPWR_percent();
+	record->outputFlags         = (gpio_getMCM_MAMODE2_bool() == MAMODE2_STATE_IS_REGEN_STANDBY) ? BINTELEM_OUTPUT_MCM_MAMODE2_REGEN_STANDBY : 0;
+	record->engineRPM           = engineSignals_getLatestRPM();
+	record->loopExecution_us    = time_loopExecution_us_get();
 
-	Serial.print(F(" MAP:"));
-	Serial.print( adc_getECM_MAP_percent() );
-	Serial.print('%');
+	uint16_t crc = BINTELEM_CRC_INITIAL_VALUE;
+	for(uint8_t ii = 0; ii < BINTELEM_RECORD_SIZE_BYTES; ii++) { crc = _crc_ccitt_update(crc, payload[ii]); }
+	payload[BINTELEM_RECORD_SIZE_BYTES    ] = lowByte(crc);
+	payload[BINTELEM_RECORD_SIZE_BYTES + 1] = highByte(crc);
 
-	Serial.print(F(" RPM:"));
-	Serial.print( engineSignals_getLatestRPM() );
+	debugUSB_recordStart();
+	debugUSB_recordAppend_char(BINTELEM_FRAME_DELIMITER); //leading delimiter lets host resync after text output
+	debugUSB_recordAppend_COBS(payload, BINTELEM_PAYLOAD_SIZE_BYTES);
+	debugUSB_recordAppend_char(BINTELEM_FRAME_DELIMITER);
+	debugUSB_recordCommit();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-//Sending more than 63 characters per call makes this function blocking (until the buffer empties)!
+//never blocks: if the TX ring is full, the whole record is dropped
 void debugUSB_printLatestData(void)
 {	
 	static uint32_t previousMillis = 0;
 
-	//print message if it's time and there's room in the serial transmit buffer
-	if( (millis() - previousMillis) >= debugUSB_dataUpdatePeriod_ms_get() && (Serial.availableForWrite() > 62) )
+	//periodic data would otherwise interleave with long strings (e.g. '$HELP')
+	if( ((millis() - previousMillis) >= debugUSB_dataUpdatePeriod_ms_get()) && (debugUSB_isLongFlashStringPending() == NO) )
 	{
 		previousMillis = millis();
 
 		if     (debugUSB_dataTypeToStream_get() == DEBUGUSB_STREAM_BUTTON     ) { debugUSB_printButtonStates(); }
 		else if(debugUSB_dataTypeToStream_get() == DEBUGUSB_STREAM_OEM_SIGNALS) { debugUSB_printOEMsignals();   }
+		else if(debugUSB_dataTypeToStream_get() == DEBUGUSB_STREAM_BINARY     ) { debugUSB_printBinaryTelemetry(); }
 	}
+
+	debugUSB_txHandler();
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+/////////////////////////////////////////////////////////////////////////////////////////////
@@ -12,10 +12,30 @@
 	#define DEBUGUSB_STREAM_BUTTON      0x11
 	#define DEBUGUSB_STREAM_OEM_SIGNALS 0x22
 	#define DEBUGUSB_STREAM_NONE        0x44
+	#define DEBUGUSB_STREAM_BINARY      0x88 //see binaryTelemetry.h
+
+	//all debug records are formatted directly into this ring, then moved to the (64 byte) Serial buffer as space allows
+	#define DEBUGUSB_TX_RING_SIZE_BYTES 256 //must be 256 (uint8_t indices wrap naturally)
+
+	void debugUSB_recordStart(void);
+	void debugUSB_recordAppend_char(char character);
+	void debugUSB_recordAppend_string(const __FlashStringHelper *flashString);
+	void debugUSB_recordAppend_uint(uint32_t value);
+	void debugUSB_recordAppend_fixedPoint(uint32_t value, uint8_t numDecimalPlaces);
+	bool debugUSB_recordCommit(void); //returns false (and counts drop) if record didn't fit
+
+	uint16_t debugUSB_droppedRecords_get(void);
+	uint8_t  debugUSB_txRing_bytesFree(void);
+
+	void debugUSB_printLongFlashString(const __FlashStringHelper *flashString); //any length... sent as TX ring empties
+	bool debugUSB_isLongFlashStringPending(void);
+
+	void debugUSB_txHandler(void); //never blocks
 
 	void debugUSB_displayUptime_seconds(void);
 	void debugUSB_printButtonStates(void);
 	void debugUSB_printOEMsignals(void);
+	void debugUSB_printBinaryTelemetry(void);
 
 	void     debugUSB_dataUpdatePeriod_ms_set(uint16_t newPeriod);
 	uint16_t debugUSB_dataUpdatePeriod_ms_get(void);
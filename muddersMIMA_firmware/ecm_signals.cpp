@@ -8,12 +8,14 @@
 uint8_t state_MAMODE1 = MAMODE1_STATE_IS_UNDEFINED;
 bool    state_MAMODE2 = MAMODE2_STATE_IS_REGEN_STANDBY;
 uint8_t percent_CMDPWR = 50;
+uint8_t percent_MAMODE1 = 0;
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-uint8_t ecm_getMAMODE1_state(void)  { return state_MAMODE1;  }
-bool    ecm_getMAMODE2_state(void)  { return state_MAMODE2;  }
-uint8_t ecm_getCMDPWR_percent(void) { return percent_CMDPWR; }
+uint8_t ecm_getMAMODE1_state(void)   { return state_MAMODE1;   }
+bool    ecm_getMAMODE2_state(void)   { return state_MAMODE2;   }
+uint8_t ecm_getCMDPWR_percent(void)  { return percent_CMDPWR;  }
+uint8_t ecm_getMAMODE1_percent(void) { return percent_MAMODE1; }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -59,6 +61,7 @@ void determineState_MAMODE2(void)
 void determineState_MAMODE1(void)
 {
 	uint8_t percent = adc_getECM_MAMODE1_percent();
+	percent_MAMODE1 = percent;
 
 	if     (percent <   10) { state_MAMODE1 = MAMODE1_STATE_IS_ERROR_LO;  } // 0: 10%
 	else if(percent <=  20) { state_MAMODE1 = MAMODE1_STATE_IS_PRESTART;  } //10: 20%
@@ -78,4 +81,8 @@ void ecm_handler()
 	determineState_MAMODE1();
 	determineState_MAMODE2();
 	determinePercent_CMDPWR();
+
+	latency_inputSampled(LATENCY_INPUT_ECM_MAMODE1, state_MAMODE1);
+	latency_inputSampled(LATENCY_INPUT_ECM_MAMODE2, state_MAMODE2);
+	latency_inputSampled(LATENCY_INPUT_ECM_CMDPWR,  percent_CMDPWR);
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//EEPROM writes take 3.3 ms per byte, which is far too long to wait for inside the control loop.
+//Instead, writes are queued here and performed one byte at a time while waiting for the next loop.
+//The 328p performs each write in the background, so the CPU never waits for the EEPROM.
+
+#include "muddersMIMA.h"
+
+struct eepromJob
+{
+	uint16_t eepromAddress;
+	const uint8_t *source;
+	uint8_t numBytes;
+	uint8_t numBytesChecked;
+};
+
+eepromJob jobQueue[EEPROM_JOB_QUEUE_DEPTH];
+uint8_t jobQueue_oldest = 0;
+uint8_t jobQueue_numJobs = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool eeprom_writeBlock_deferred(uint16_t eepromAddress, const void *source, uint8_t numBytes)
+{
+	if(jobQueue_numJobs >= EEPROM_JOB_QUEUE_DEPTH) { return false; }
+	if(numBytes == 0) { return true; }
+
+	uint8_t newest = (jobQueue_oldest + jobQueue_numJobs) % EEPROM_JOB_QUEUE_DEPTH;
+	jobQueue[newest].eepromAddress = eepromAddress;
+	jobQueue[newest].source = (const uint8_t *)source;
+	jobQueue[newest].numBytes = numBytes;
+	jobQueue[newest].numBytesChecked = 0;
+	jobQueue_numJobs++;
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool eeprom_isBlockPending(const void *source)
+{
+	for(uint8_t ii = 0; ii < jobQueue_numJobs; ii++)
+	{
+		if(jobQueue[(jobQueue_oldest + ii) % EEPROM_JOB_QUEUE_DEPTH].source == (const uint8_t *)source) { return true; }
+	}
+
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool eeprom_isIdle(void) { return ( (jobQueue_numJobs == 0) && hal_eeprom_isReady() ); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void eeprom_handler(void)
+{
+	if(jobQueue_numJobs == 0) { return; }
+	if(!hal_eeprom_isReady()) { return; } //previous byte still being written
+
+	eepromJob *job = &jobQueue[jobQueue_oldest];
+
+	//unchanged bytes are skipped (reduces wear), so keep going until one byte is actually written
+	while(job->numBytesChecked < job->numBytes)
+	{
+		uint16_t address = job->eepromAddress + job->numBytesChecked;
+		uint8_t newValue = job->source[job->numBytesChecked];
+
+		job->numBytesChecked++;
+
+		if(hal_eeprom_readByte(address) != newValue)
+		{
+			hal_eeprom_writeByte(address, newValue); //returns immediately; hardware finishes write in background
+			break;
+		}
+	}
+
+	if(job->numBytesChecked >= job->numBytes)
+	{
+		jobQueue_oldest = (jobQueue_oldest + 1) % EEPROM_JOB_QUEUE_DEPTH;
+		jobQueue_numJobs--;
+	}
+}
@@ -0,0 +1,28 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//EEPROM address map and deferred (non-blocking) EEPROM writes
+
+#ifndef eeprom_h
+	#define eeprom_h
+
+	//328p has 1024 bytes EEPROM
+	#define EEPROM_ADDRESS_PARAMETERS       0x000 //reserved for runtime parameters
+	#define EEPROM_ADDRESS_CALIBRATION      0x040 //reserved for joystick calibration
+	#define EEPROM_ADDRESS_EVENTLOG_START   0x080 //event log (circular)
+	#define EEPROM_ADDRESS_EVENTLOG_END     0x400 //one past last byte
+
+	#define EEPROM_JOB_QUEUE_DEPTH 3
+
+	//data is copied from 'source' as each byte is written, so 'source' must not change until eeprom_isBlockPending() returns false
+	//returns false if queue is full (caller should try again later)
+	bool eeprom_writeBlock_deferred(uint16_t eepromAddress, const void *source, uint8_t numBytes);
+
+	bool eeprom_isBlockPending(const void *source);
+	bool eeprom_isIdle(void);
+
+	//writes at most one byte per call, and only if the previous byte has finished (~3.3 ms/byte)
+	//only call during idle time (i.e. while waiting for next loop)
+	void eeprom_handler(void);
+
+#endif
@@ -9,12 +9,27 @@ volatile uint16_t latestEngineRPM = 0;
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-//PCMSK0 is configured so that only D8 causes interrupt (supports D8:D13)
+//both pins cause this interrupt, so each pin's edges are found by comparison
+bool tachometerPin_previous = LOW;
+bool isChipSelected_previous = NO;
+
+//PIN_NEP & PIN_SPI_CS cause this interrupt (see hal_engineRPM_interruptBegin() & hal_spiSlave_begin())
 ISR(PCINT0_vect)
 {
 	static uint32_t tachometerTick_previous_us = 0;
 
-	if(gpio_engineRPM_getPinState() == HIGH)
+	bool tachometerPin = gpio_engineRPM_getPinState();
+	bool isTachometerRisingEdge = ( (tachometerPin == HIGH) && (tachometerPin_previous == LOW) );
+	tachometerPin_previous = tachometerPin;
+
+	bool isChipSelected = hal_spiSlave_isChipSelected();
+	if(isChipSelected != isChipSelected_previous)
+	{
+		isChipSelected_previous = isChipSelected;
+		spiToLiBCM_chipSelectChanged(); //a PIN_NEP edge mid-frame mustn't discard LiBCM's partial frame
+	}
+
+	if(isTachometerRisingEdge == YES)
 	{
 		uint32_t tachometerTick_now_us = micros();
 
@@ -34,10 +49,7 @@ uint16_t engineSignals_getLatestRPM(void) { return latestEngineRPM; }
 
 void engineSignals_begin(void)
 {
-	cli();
-	PCMSK0 = (1<<PCINT0); //only pin D8 will generate a pin change interrupt on ISR PCINT0_vect (which supports D8:D13)
-	PCICR |= (1<<PCIE0); //enable pin change interrupts on port B (D8:D13)
-	sei();
+	hal_engineRPM_interruptBegin();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,363 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Events are queued in RAM, then written to EEPROM (by eeprom_handler) while waiting for the next loop.
+//Records are written round-robin through the entire log area, so each EEPROM byte wears equally.
+
+#include "muddersMIMA.h"
+
+#define LISTING_MAX_RECORDS_PER_LOOP  4
+#define LISTING_MIN_TX_SPACE_BYTES   40 //longest listing line, plus margin
+
+#define HOLDOFF_EXPIRED ((uint32_t)0 - EVENTLOG_REPEAT_HOLDOFF_ms) //first event is always logged
+
+//where the next record goes
+uint8_t  nextSlot = 0;
+uint16_t nextSequence = 0;
+
+//'$LOG' ignores records older than this
+uint16_t clearedSequence = 0;
+bool hasLogBeenCleared = NO;
+
+//records waiting to be written
+eventLog_record pendingRecords[EVENTLOG_QUEUE_DEPTH];
+uint8_t pendingSlots[EVENTLOG_QUEUE_DEPTH];
+uint8_t pending_oldest = 0;
+uint8_t pending_numRecords = 0;
+bool isOldestPendingSubmitted = NO;
+uint8_t numEventsDropped = 0; //queue was full
+
+//'$LOG' only shows records that existed when it started
+bool isListingInProgress = NO;
+uint8_t listingSlotsChecked = 0;
+uint8_t listingStartSlot = 0;
+uint16_t listingEndSequence = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t eventLog_slotToAddress(uint8_t slot) { return EEPROM_ADDRESS_EVENTLOG_START + (uint16_t)slot * EVENTLOG_RECORD_SIZE_BYTES; }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t eventLog_calculateCRC(const eventLog_record *record)
+{
+	const uint8_t *recordBytes = (const uint8_t *)record;
+	uint8_t crc = 0;
+
+	for(uint8_t ii = 0; ii < (EVENTLOG_RECORD_SIZE_BYTES - 1); ii++) { crc = _crc8_ccitt_update(crc, recordBytes[ii]); }
+
+	return crc;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//erased EEPROM reads 0xFF
+bool eventLog_isRecordValid(const eventLog_record *record)
+{
+	if( (record->eventType == 0) || (record->eventType == 0xFF) ) { return false; }
+
+	return (record->crc == eventLog_calculateCRC(record));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//true if sequenceA was written after sequenceB (handles rollover)
+bool eventLog_isSequenceNewer(uint16_t sequenceA, uint16_t sequenceB) { return ((int16_t)(sequenceA - sequenceB) > 0); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void eventLog_findNewestRecord(void)
+{
+	eventLog_record record;
+	bool isAnyRecordValid = NO;
+	uint16_t newestSequence = 0;
+
+	for(uint8_t slot = 0; slot < EVENTLOG_NUM_SLOTS; slot++)
+	{
+		hal_eeprom_readBlock(&record, eventLog_slotToAddress(slot), EVENTLOG_RECORD_SIZE_BYTES);
+
+		if(eventLog_isRecordValid(&record) == false) { continue; }
+
+		if( (isAnyRecordValid == NO) || (eventLog_isSequenceNewer(record.sequence, newestSequence) == true) )
+		{
+			newestSequence = record.sequence;
+			nextSlot = slot + 1;
+			if(nextSlot >= EVENTLOG_NUM_SLOTS) { nextSlot = 0; }
+			isAnyRecordValid = YES;
+		}
+
+		if( (record.eventType == EVENTLOG_TYPE_LOG_CLEARED) &&
+			((hasLogBeenCleared == NO) || (eventLog_isSequenceNewer(record.sequence, clearedSequence) == true)) )
+		{
+			clearedSequence = record.sequence;
+			hasLogBeenCleared = YES;
+		}
+	}
+
+	if(isAnyRecordValid == YES) { nextSequence = newestSequence + 1; }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void eventLog_begin(void)
+{
+	uint8_t resetCause = hal_resetCause_getAndClear();
+
+	eventLog_findNewestRecord();
+
+	if(resetCause & (1 << WDRF)) { eventLog_logEvent(EVENTLOG_TYPE_WATCHDOG_RESET, resetCause); }
+	else                         { eventLog_logEvent(EVENTLOG_TYPE_BOOT,           resetCause); }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void eventLog_logEvent(uint8_t eventType, uint16_t data)
+{
+	if(pending_numRecords >= EVENTLOG_QUEUE_DEPTH)
+	{
+		if(numEventsDropped < 0xFF) { numEventsDropped++; }
+		return;
+	}
+
+	uint8_t newest = (pending_oldest + pending_numRecords) % EVENTLOG_QUEUE_DEPTH;
+	eventLog_record *record = &pendingRecords[newest];
+
+	uint32_t timestamp_s = millis() / 1000;
+	if(timestamp_s > 0xFFFF) { timestamp_s = 0xFFFF; }
+
+	record->sequence = nextSequence++;
+	record->eventType = eventType;
+	record->data = data;
+	record->timestamp_s = (uint16_t)timestamp_s;
+	record->crc = eventLog_calculateCRC(record);
+
+	pendingSlots[newest] = nextSlot++;
+	if(nextSlot >= EVENTLOG_NUM_SLOTS) { nextSlot = 0; }
+
+	pending_numRecords++;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns true (and restarts holdoff) if this event type hasn't been logged recently
+bool eventLog_isHoldoffExpired(uint32_t *lastLogged_ms)
+{
+	if( (millis() - *lastLogged_ms) < EVENTLOG_REPEAT_HOLDOFF_ms ) { return false; }
+
+	*lastLogged_ms = millis();
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool eventLog_isMAMODE1_stateValid(uint8_t state)
+{
+	return ( (state != MAMODE1_STATE_IS_ERROR_LO ) &&
+	         (state != MAMODE1_STATE_IS_ERROR_HI ) &&
+	         (state != MAMODE1_STATE_IS_UNDEFINED)  );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//MAMODE1 is ERROR_LO whenever the key is off, so ERROR_LO is only logged if the signal recovers quickly
+void eventLog_checkMAMODE1(void)
+{
+	static uint8_t previousState = MAMODE1_STATE_IS_UNDEFINED;
+	static uint32_t errorLoStart_ms = 0;
+	static bool wasValidBeforeErrorLo = NO;
+	static uint32_t lastLogged_ms = HOLDOFF_EXPIRED;
+
+	uint8_t state = ecm_getMAMODE1_state();
+	if(state == previousState) { return; }
+
+	bool wasValid = eventLog_isMAMODE1_stateValid(previousState);
+
+	if(state == MAMODE1_STATE_IS_ERROR_LO)
+	{
+		errorLoStart_ms = millis();
+		wasValidBeforeErrorLo = wasValid;
+	}
+	else if(eventLog_isMAMODE1_stateValid(state) == true)
+	{
+		uint32_t errorLoDuration_ms = millis() - errorLoStart_ms;
+
+		if( (previousState == MAMODE1_STATE_IS_ERROR_LO) && (wasValidBeforeErrorLo == YES) &&
+			(errorLoDuration_ms < EVENTLOG_MAMODE1_GLITCH_ms) && (eventLog_isHoldoffExpired(&lastLogged_ms) == true) )
+		{
+			eventLog_logEvent(EVENTLOG_TYPE_MAMODE1_ERROR_LO, (uint16_t)errorLoDuration_ms);
+		}
+
+		wasValidBeforeErrorLo = NO;
+	}
+	else if( (wasValid == YES) && (eventLog_isHoldoffExpired(&lastLogged_ms) == true) )
+	{
+		if(state == MAMODE1_STATE_IS_ERROR_HI) { eventLog_logEvent(EVENTLOG_TYPE_MAMODE1_ERROR_HI,  ecm_getMAMODE1_percent()); }
+		else                                   { eventLog_logEvent(EVENTLOG_TYPE_MAMODE1_UNDEFINED, ecm_getMAMODE1_percent()); }
+	}
+
+	previousState = state;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void eventLog_checkLoopOverrun(void)
+{
+	static uint32_t lastLogged_ms = HOLDOFF_EXPIRED;
+
+	uint32_t loopPeriod_us = (uint32_t)time_loopPeriod_ms_get() * 1000;
+
+	if( (time_loopExecution_us_get() > loopPeriod_us) && (eventLog_isHoldoffExpired(&lastLogged_ms) == true) )
+	{
+		eventLog_logEvent(EVENTLOG_TYPE_LOOP_OVERRUN, time_loopExecution_us_get());
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void eventLog_checkLiBCM(void)
+{
+	static uint32_t lastLogged_ms = HOLDOFF_EXPIRED;
+	static uint16_t numBadFrames_previouslyLogged = 0;
+
+	uint16_t numBadFramesSinceLogged = LiBCM_getNumBadFrames() - numBadFrames_previouslyLogged;
+
+	if( (numBadFramesSinceLogged > 0) && (eventLog_isHoldoffExpired(&lastLogged_ms) == true) )
+	{
+		eventLog_logEvent(EVENTLOG_TYPE_LIBCM_BAD_FRAME, numBadFramesSinceLogged);
+		numBadFrames_previouslyLogged += numBadFramesSinceLogged;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//pass oldest pending record to eeprom_handler(), then wait until it's written
+void eventLog_writePendingRecords(void)
+{
+	if(pending_numRecords == 0) { return; }
+
+	eventLog_record *record = &pendingRecords[pending_oldest];
+
+	if(isOldestPendingSubmitted == NO)
+	{
+		isOldestPendingSubmitted = eeprom_writeBlock_deferred(eventLog_slotToAddress(pendingSlots[pending_oldest]), record, EVENTLOG_RECORD_SIZE_BYTES);
+	}
+	else if(eeprom_isBlockPending(record) == false)
+	{
+		pending_oldest = (pending_oldest + 1) % EVENTLOG_QUEUE_DEPTH;
+		pending_numRecords--;
+		isOldestPendingSubmitted = NO;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void eventLog_printEventType(uint8_t eventType)
+{
+	if     (eventType == EVENTLOG_TYPE_BOOT              ) { debugUSB_recordAppend_string(F("BOOT"              )); }
+	else if(eventType == EVENTLOG_TYPE_WATCHDOG_RESET    ) { debugUSB_recordAppend_string(F("WATCHDOG_RESET"    )); }
+	else if(eventType == EVENTLOG_TYPE_MAMODE1_ERROR_LO  ) { debugUSB_recordAppend_string(F("MAMODE1_ERROR_LO"  )); }
+	else if(eventType == EVENTLOG_TYPE_MAMODE1_ERROR_HI  ) { debugUSB_recordAppend_string(F("MAMODE1_ERROR_HI"  )); }
+	else if(eventType == EVENTLOG_TYPE_MAMODE1_UNDEFINED ) { debugUSB_recordAppend_string(F("MAMODE1_UNDEFINED" )); }
+	else if(eventType == EVENTLOG_TYPE_LOOP_OVERRUN      ) { debugUSB_recordAppend_string(F("LOOP_OVERRUN"      )); }
+	else if(eventType == EVENTLOG_TYPE_LIBCM_BAD_FRAME   ) { debugUSB_recordAppend_string(F("LIBCM_BAD_FRAME"   )); }
+	else if(eventType == EVENTLOG_TYPE_LOG_CLEARED       ) { debugUSB_recordAppend_string(F("LOG_CLEARED"       )); }
+	else if(eventType == EVENTLOG_TYPE_IMAGE_CRC_MISMATCH) { debugUSB_recordAppend_string(F("IMAGE_CRC_MISMATCH")); }
+	else                                                   { debugUSB_recordAppend_uint(eventType);                    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//header is added to caller's debugUSB record //records are sent later by eventLog_listingHandler()
+void eventLog_startListing(void)
+{
+	listingSlotsChecked = 0;
+	listingStartSlot = nextSlot; //oldest record
+	listingEndSequence = nextSequence;
+	isListingInProgress = YES;
+
+	debugUSB_recordAppend_string(F("\n$LOG: "));
+	debugUSB_recordAppend_uint(EVENTLOG_NUM_SLOTS);
+	debugUSB_recordAppend_string(F(" slots, "));
+	debugUSB_recordAppend_uint(numEventsDropped);
+	debugUSB_recordAppend_string(F(" events dropped this boot\nsequence,time_s,event,data"));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//reads a few records each loop, oldest first
+//EEPROM can't be read while a byte is being written, so this waits instead of blocking
+void eventLog_listingHandler(void)
+{
+	uint8_t numRecordsAllowed = LISTING_MAX_RECORDS_PER_LOOP;
+
+	while( (numRecordsAllowed > 0) && hal_eeprom_isReady() && (debugUSB_txRing_bytesFree() >= LISTING_MIN_TX_SPACE_BYTES) )
+	{
+		if(listingSlotsChecked >= EVENTLOG_NUM_SLOTS)
+		{
+			debugUSB_recordStart();
+			debugUSB_recordAppend_string(F("\nEnd of $LOG"));
+			if(pending_numRecords > 0)
+			{
+				debugUSB_recordAppend_string(F(" (plus "));
+				debugUSB_recordAppend_uint(pending_numRecords);
+				debugUSB_recordAppend_string(F(" not yet written)"));
+			}
+			debugUSB_recordCommit();
+			isListingInProgress = NO;
+			return;
+		}
+
+		uint8_t slot = (uint8_t)((listingStartSlot + listingSlotsChecked) % EVENTLOG_NUM_SLOTS);
+		listingSlotsChecked++;
+
+		eventLog_record record;
+		hal_eeprom_readBlock(&record, eventLog_slotToAddress(slot), EVENTLOG_RECORD_SIZE_BYTES);
+
+		uint16_t sequenceAge = listingEndSequence - record.sequence; //1 is newest
+
+		if(eventLog_isRecordValid(&record) == false)                 { continue; } //erased or interrupted by power loss
+		if( (sequenceAge == 0) || (sequenceAge > EVENTLOG_NUM_SLOTS) ) { continue; } //logged after '$LOG' started, or stale (slot is about to be overwritten)
+		if( (hasLogBeenCleared == YES) && (eventLog_isSequenceNewer(clearedSequence, record.sequence) == true) ) { continue; }
+
+		debugUSB_recordStart();
+		debugUSB_recordAppend_char('\n');
+		debugUSB_recordAppend_uint(record.sequence);
+		debugUSB_recordAppend_char(',');
+		debugUSB_recordAppend_uint(record.timestamp_s);
+		debugUSB_recordAppend_char(',');
+		eventLog_printEventType(record.eventType);
+		debugUSB_recordAppend_char(',');
+		debugUSB_recordAppend_uint(record.data);
+		debugUSB_recordCommit();
+
+		numRecordsAllowed--;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//older records stay in EEPROM (and are eventually overwritten), but '$LOG' no longer shows them
+void eventLog_clear(void)
+{
+	clearedSequence = nextSequence;
+	hasLogBeenCleared = YES;
+
+	eventLog_logEvent(EVENTLOG_TYPE_LOG_CLEARED, 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void eventLog_handler(void)
+{
+	eventLog_checkMAMODE1();
+	eventLog_checkLoopOverrun();
+	eventLog_checkLiBCM();
+
+	eventLog_writePendingRecords();
+
+	if(isListingInProgress == YES) { eventLog_listingHandler(); }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool eventLog_isIdle(void) { return ( (pending_numRecords == 0) && (isListingInProgress == NO) ); }
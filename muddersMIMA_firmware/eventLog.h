@@ -0,0 +1,51 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//persistent event/fault log, stored in EEPROM ('$LOG' to view, '$LOGCLR' to clear)
+
+#ifndef eventLog_h
+	#define eventLog_h
+
+	//each record is written to the next slot in a circular buffer, so every slot wears equally
+	//sequence increments with each record, so the newest record is found at boot (even after sequence rolls over)
+	//CRC is the last byte written, so a record interrupted by power loss is ignored
+	struct __attribute__((packed)) eventLog_record
+	{
+		uint16_t sequence;
+		uint8_t  eventType;   //EVENTLOG_TYPE_xxx
+		uint16_t data;        //meaning depends on eventType
+		uint16_t timestamp_s; //seconds since LiControl powered on (saturates)
+		uint8_t  crc;         //CRC8 of all previous bytes
+	};
+
+	#define EVENTLOG_RECORD_SIZE_BYTES (sizeof(struct eventLog_record))
+	#define EVENTLOG_NUM_SLOTS ((EEPROM_ADDRESS_EVENTLOG_END - EEPROM_ADDRESS_EVENTLOG_START) / EVENTLOG_RECORD_SIZE_BYTES) //112
+
+	#define EVENTLOG_QUEUE_DEPTH 4 //records waiting to be written to EEPROM
+
+	#define EVENTLOG_REPEAT_HOLDOFF_ms 60000 //noisy events are logged at most once per minute
+	#define EVENTLOG_MAMODE1_GLITCH_ms  1000 //ERROR_LO lasting longer than this is assumed to be keyOFF (not logged)
+
+	//eventType    //data
+	#define EVENTLOG_TYPE_BOOT               1 //MCUSR (reset cause)
+	#define EVENTLOG_TYPE_WATCHDOG_RESET     2 //MCUSR
+	#define EVENTLOG_TYPE_MAMODE1_ERROR_LO   3 //glitch duration (ms)
+	#define EVENTLOG_TYPE_MAMODE1_ERROR_HI   4 //MAMODE1 duty cycle (percent)
+	#define EVENTLOG_TYPE_MAMODE1_UNDEFINED  5 //MAMODE1 duty cycle (percent)
+	#define EVENTLOG_TYPE_LOOP_OVERRUN       6 //loop execution time (us)
+	#define EVENTLOG_TYPE_LIBCM_BAD_FRAME    7 //number of bad frames since previous record
+	#define EVENTLOG_TYPE_LOG_CLEARED        8 //'$LOG' only shows records after the latest LOG_CLEARED record
+	#define EVENTLOG_TYPE_IMAGE_CRC_MISMATCH 9 //actual CRC (see imageCheck.h)
+
+	void eventLog_begin(void); //call once at boot, before anything else logs an event
+
+	//record is queued in RAM, then written to EEPROM while waiting for next loop
+	void eventLog_logEvent(uint8_t eventType, uint16_t data);
+
+	void eventLog_handler(void); //call once per loop
+	bool eventLog_isIdle(void); //no records waiting to be written (or listed)
+
+	void eventLog_startListing(void);
+	void eventLog_clear(void);
+
+#endif
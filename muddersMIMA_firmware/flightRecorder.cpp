@@ -0,0 +1,273 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//RAM flight recorder
+//Samples are delta encoded (only changed fields are stored), so steady signals only cost one byte per loop.
+//The oldest samples are overwritten, so the buffer always contains the most recent history.
+//When a sample is overwritten, its values are applied to 'baseSample', so the oldest remaining sample can still be decoded.
+
+#include "muddersMIMA.h"
+
+#define BUFFER_INDEX_MASK (FLIGHTRECORDER_BUFFER_SIZE_BYTES - 1)
+
+#define DUMP_MAX_SAMPLES_PER_LOOP  4
+#define DUMP_MIN_TX_SPACE_BYTES   48 //longest dump line, plus margin
+
+uint8_t recorderBuffer[FLIGHTRECORDER_BUFFER_SIZE_BYTES];
+uint16_t bufferHead = 0; //next byte is stored here
+uint16_t bufferTail = 0; //oldest sample starts here
+uint16_t numBytesUsed = 0;
+uint16_t numSamplesStored = 0;
+
+uint8_t baseSample[FLIGHTRECORDER_NUM_FIELDS];   //values immediately before oldest stored sample
+uint8_t latestSample[FLIGHTRECORDER_NUM_FIELDS]; //values in newest stored sample
+
+uint8_t triggerReason = FLIGHTRECORDER_TRIGGER_NONE;
+uint8_t triggerMarker = 0; //FLIGHTRECORDER_MASK_TRIGGER when next sample is the trigger sample
+uint8_t postTriggerSamplesRemaining = 0;
+uint16_t postTriggerBytesRemaining = 0;
+bool isRecorderFrozen = NO;
+
+bool isDumpInProgress = NO;
+uint16_t dumpIndex = 0;
+uint16_t dumpSampleNumber = 0;
+uint8_t dumpSample[FLIGHTRECORDER_NUM_FIELDS];
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void flightRecorder_rearm(void)
+{
+	bufferHead = 0;
+	bufferTail = 0;
+	numBytesUsed = 0;
+	numSamplesStored = 0;
+
+	for(uint8_t ii = 0; ii < FLIGHTRECORDER_NUM_FIELDS; ii++) { baseSample[ii] = 0; latestSample[ii] = 0; }
+
+	triggerReason = FLIGHTRECORDER_TRIGGER_NONE;
+	triggerMarker = 0;
+	isRecorderFrozen = NO;
+	isDumpInProgress = NO;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void flightRecorder_trigger(uint8_t reason)
+{
+	if( (triggerReason != FLIGHTRECORDER_TRIGGER_NONE) || (isRecorderFrozen == YES) ) { return; } //already triggered
+
+	triggerReason = reason;
+	triggerMarker = FLIGHTRECORDER_MASK_TRIGGER;
+	postTriggerSamplesRemaining = FLIGHTRECORDER_POST_TRIGGER_SAMPLES;
+	postTriggerBytesRemaining = FLIGHTRECORDER_POST_TRIGGER_BYTES;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//apply oldest sample to baseSample, then remove it from buffer
+void flightRecorder_discardOldestSample(void)
+{
+	uint8_t mask = recorderBuffer[bufferTail];
+	bufferTail = (bufferTail + 1) & BUFFER_INDEX_MASK;
+	numBytesUsed--;
+
+	for(uint8_t ii = 0; ii < FLIGHTRECORDER_NUM_FIELDS; ii++)
+	{
+		if(mask & (1 << ii))
+		{
+			baseSample[ii] = recorderBuffer[bufferTail];
+			bufferTail = (bufferTail + 1) & BUFFER_INDEX_MASK;
+			numBytesUsed--;
+		}
+	}
+
+	numSamplesStored--;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void flightRecorder_storeSample(const uint8_t *sample)
+{
+	uint8_t mask = triggerMarker;
+	uint8_t numBytes = 1; //mask byte
+
+	for(uint8_t ii = 0; ii < FLIGHTRECORDER_NUM_FIELDS; ii++)
+	{
+		if(sample[ii] != latestSample[ii]) { mask |= (1 << ii); numBytes++; }
+	}
+
+	while( (FLIGHTRECORDER_BUFFER_SIZE_BYTES - numBytesUsed) < numBytes ) { flightRecorder_discardOldestSample(); }
+
+	recorderBuffer[bufferHead] = mask;
+	bufferHead = (bufferHead + 1) & BUFFER_INDEX_MASK;
+
+	for(uint8_t ii = 0; ii < FLIGHTRECORDER_NUM_FIELDS; ii++)
+	{
+		if(mask & (1 << ii))
+		{
+			recorderBuffer[bufferHead] = sample[ii];
+			bufferHead = (bufferHead + 1) & BUFFER_INDEX_MASK;
+			latestSample[ii] = sample[ii];
+		}
+	}
+
+	numBytesUsed += numBytes;
+	numSamplesStored++;
+	triggerMarker = 0;
+
+	if(triggerReason != FLIGHTRECORDER_TRIGGER_NONE) { postTriggerBytesRemaining -= numBytes; }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//reads present signal values into sample[FLIGHTRECORDER_NUM_FIELDS]
+void flightRecorder_takeSample(uint8_t *sample)
+{
+	uint8_t flags = 0;
+	if(gpio_getBrakePosition_bool() == BRAKE_LIGHTS_ARE_ON           ) { flags |= FLIGHTRECORDER_FLAG_BRAKE;             }
+	if(gpio_getClutchPosition()     == CLUTCH_PEDAL_PRESSED          ) { flags |= FLIGHTRECORDER_FLAG_CLUTCH;            }
+	if(gpio_getButton_momentary()   == BUTTON_PRESSED                ) { flags |= FLIGHTRECORDER_FLAG_BUTTON;            }
+	if(ecm_getMAMODE2_state()       == MAMODE2_STATE_IS_REGEN_STANDBY) { flags |= FLIGHTRECORDER_FLAG_ECM_MAMODE2_REGEN; }
+	if(gpio_getMCM_MAMODE2_bool()   == MAMODE2_STATE_IS_REGEN_STANDBY) { flags |= FLIGHTRECORDER_FLAG_MCM_MAMODE2_REGEN; }
+
+	uint16_t engineRPM = engineSignals_getLatestRPM() >> FLIGHTRECORDER_RPM_SHIFT;
+	if(engineRPM > 0xFF) { engineRPM = 0xFF; }
+
+	sample[FLIGHTRECORDER_FIELD_JOYSTICK   ] = adc_getLatestJoystick_percent(); //doesn't start new conversion
+	sample[FLIGHTRECORDER_FIELD_ECM_CMDPWR ] = ecm_getCMDPWR_percent();
+	sample[FLIGHTRECORDER_FIELD_ECM_MAMODE1] = ecm_getMAMODE1_state();
+	sample[FLIGHTRECORDER_FIELD_MCM_CMDPWR ] = gpio_getMCM_CMDPWR_percent();
+	sample[FLIGHTRECORDER_FIELD_MCM_MAMODE1] = gpio_getMCM_MAMODE1_percent();
+	sample[FLIGHTRECORDER_FIELD_RPM        ] = (uint8_t)engineRPM;
+	sample[FLIGHTRECORDER_FIELD_FLAGS      ] = flags;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void flightRecorder_checkTriggers(const uint8_t *sample)
+{
+	static uint8_t MAMODE1_state_previous = MAMODE1_STATE_IS_UNDEFINED;
+	static bool wasRPM_belowLimit = YES;
+	static uint32_t buttonPressStart_ms = 0;
+	static bool wasButtonPressed = NO;
+
+	uint8_t MAMODE1_state = sample[FLIGHTRECORDER_FIELD_ECM_MAMODE1];
+	bool isMAMODE1_invalid  = ( (MAMODE1_state          == MAMODE1_STATE_IS_ERROR_LO) || (MAMODE1_state          == MAMODE1_STATE_IS_ERROR_HI) || (MAMODE1_state          == MAMODE1_STATE_IS_UNDEFINED) );
+	bool wasMAMODE1_invalid = ( (MAMODE1_state_previous == MAMODE1_STATE_IS_ERROR_LO) || (MAMODE1_state_previous == MAMODE1_STATE_IS_ERROR_HI) || (MAMODE1_state_previous == MAMODE1_STATE_IS_UNDEFINED) );
+	if( (isMAMODE1_invalid == true) && (wasMAMODE1_invalid == false) ) { flightRecorder_trigger(FLIGHTRECORDER_TRIGGER_MAMODE1_ERROR); }
+	MAMODE1_state_previous = MAMODE1_state;
+
+	bool isRPM_belowLimit = (engineSignals_getLatestRPM() < param.maxRPM);
+	if( (isRPM_belowLimit == NO) && (wasRPM_belowLimit == YES) ) { flightRecorder_trigger(FLIGHTRECORDER_TRIGGER_RPM_CUT); }
+	wasRPM_belowLimit = isRPM_belowLimit;
+
+	bool isButtonPressed = (sample[FLIGHTRECORDER_FIELD_FLAGS] & FLIGHTRECORDER_FLAG_BUTTON);
+	if     (isButtonPressed == NO)  { ; }
+	else if(wasButtonPressed == NO) { buttonPressStart_ms = millis(); }
+	else if( (millis() - buttonPressStart_ms) > FLIGHTRECORDER_BUTTON_HOLD_ms) { flightRecorder_trigger(FLIGHTRECORDER_TRIGGER_BUTTON); }
+	wasButtonPressed = isButtonPressed;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//header is added to caller's debugUSB record //samples are sent later by flightRecorder_dumpHandler()
+void flightRecorder_startDump(void)
+{
+	if(isRecorderFrozen == NO)
+	{
+		//user wants to see data now
+		flightRecorder_trigger(FLIGHTRECORDER_TRIGGER_USER);
+
+		if(triggerMarker != 0)
+		{
+			//trigger sample isn't stored yet, so store it now (otherwise dump has no TRIGGER reference)
+			uint8_t sample[FLIGHTRECORDER_NUM_FIELDS];
+			flightRecorder_takeSample(sample);
+			flightRecorder_storeSample(sample);
+		}
+
+		isRecorderFrozen = YES;
+	}
+
+	dumpIndex = bufferTail;
+	dumpSampleNumber = 0;
+	for(uint8_t ii = 0; ii < FLIGHTRECORDER_NUM_FIELDS; ii++) { dumpSample[ii] = baseSample[ii]; }
+	isDumpInProgress = YES;
+
+	debugUSB_recordAppend_string(F("\n$DUMP: "));
+	debugUSB_recordAppend_uint(numSamplesStored);
+	debugUSB_recordAppend_string(F(" samples @ "));
+	debugUSB_recordAppend_uint(time_loopPeriod_ms_get());
+	debugUSB_recordAppend_string(F(" ms, trigger: "));
+	debugUSB_recordAppend_uint(triggerReason);
+	debugUSB_recordAppend_string(F("\nsample,joystick%,ECM_CMDPWR%,ECM_MAMODE1,MCM_CMDPWR%,MCM_MAMODE1%,RPM,flags"));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//decodes a few samples each loop, as TX ring space allows
+void flightRecorder_dumpHandler(void)
+{
+	uint8_t numSamplesAllowed = DUMP_MAX_SAMPLES_PER_LOOP;
+
+	while( (numSamplesAllowed > 0) && (debugUSB_txRing_bytesFree() >= DUMP_MIN_TX_SPACE_BYTES) )
+	{
+		if(dumpSampleNumber >= numSamplesStored)
+		{
+			debugUSB_recordStart();
+			debugUSB_recordAppend_string(F("\nEnd of $DUMP. Type '$REC' to restart recorder"));
+			debugUSB_recordCommit();
+			isDumpInProgress = NO;
+			return;
+		}
+
+		uint8_t mask = recorderBuffer[dumpIndex];
+		dumpIndex = (dumpIndex + 1) & BUFFER_INDEX_MASK;
+
+		for(uint8_t ii = 0; ii < FLIGHTRECORDER_NUM_FIELDS; ii++)
+		{
+			if(mask & (1 << ii))
+			{
+				dumpSample[ii] = recorderBuffer[dumpIndex];
+				dumpIndex = (dumpIndex + 1) & BUFFER_INDEX_MASK;
+			}
+		}
+
+		debugUSB_recordStart();
+		debugUSB_recordAppend_char('\n');
+		debugUSB_recordAppend_uint(dumpSampleNumber++);
+		for(uint8_t ii = 0; ii < FLIGHTRECORDER_NUM_FIELDS; ii++)
+		{
+			debugUSB_recordAppend_char(',');
+			if(ii == FLIGHTRECORDER_FIELD_RPM) { debugUSB_recordAppend_uint((uint16_t)dumpSample[ii] << FLIGHTRECORDER_RPM_SHIFT); }
+			else                               { debugUSB_recordAppend_uint(dumpSample[ii]); }
+		}
+		if(mask & FLIGHTRECORDER_MASK_TRIGGER) { debugUSB_recordAppend_string(F(",TRIGGER")); }
+		debugUSB_recordCommit();
+
+		numSamplesAllowed--;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void flightRecorder_handler(void)
+{
+	if(isDumpInProgress == YES) { flightRecorder_dumpHandler(); return; }
+	if(isRecorderFrozen == YES) { return; }
+
+	uint8_t sample[FLIGHTRECORDER_NUM_FIELDS];
+	flightRecorder_takeSample(sample);
+
+	flightRecorder_checkTriggers(sample);
+
+	flightRecorder_storeSample(sample);
+
+	if(triggerReason != FLIGHTRECORDER_TRIGGER_NONE)
+	{
+		//freeze before the next sample could overwrite the trigger sample or the history before it
+		if     (postTriggerSamplesRemaining == 0                           ) { isRecorderFrozen = YES; }
+		else if(postTriggerBytesRemaining < FLIGHTRECORDER_MAX_SAMPLE_BYTES) { isRecorderFrozen = YES; }
+		else                                                                 { postTriggerSamplesRemaining--; }
+	}
+}
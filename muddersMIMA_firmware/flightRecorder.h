@@ -0,0 +1,47 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//RAM flight recorder: continuously records control signals, then freezes after a trigger ('$DUMP' to view)
+
+#ifndef flightRecorder_h
+	#define flightRecorder_h
+
+	#define FLIGHTRECORDER_BUFFER_SIZE_BYTES  512 //must be a power of two //~5 seconds when signals are steady
+	#define FLIGHTRECORDER_POST_TRIGGER_SAMPLES 100 //samples recorded after trigger (i.e. 1 second @ 10 ms loop)
+	#define FLIGHTRECORDER_POST_TRIGGER_BYTES   (FLIGHTRECORDER_BUFFER_SIZE_BYTES / 2) //stops sooner when signals change quickly, so pre-trigger history isn't overwritten
+	#define FLIGHTRECORDER_BUTTON_HOLD_ms      2000 //holding momentary button this long triggers recorder
+
+	//each sample is: [mask byte][one byte for each field whose bit is set in mask]
+	//a field is only stored when it differs from the previous sample
+	#define FLIGHTRECORDER_FIELD_JOYSTICK     0 //percent
+	#define FLIGHTRECORDER_FIELD_ECM_CMDPWR   1 //percent
+	#define FLIGHTRECORDER_FIELD_ECM_MAMODE1  2 //MAMODE1_STATE_IS_xxx
+	#define FLIGHTRECORDER_FIELD_MCM_CMDPWR   3 //percent
+	#define FLIGHTRECORDER_FIELD_MCM_MAMODE1  4 //percent
+	#define FLIGHTRECORDER_FIELD_RPM          5 //RPM/32
+	#define FLIGHTRECORDER_FIELD_FLAGS        6 //FLIGHTRECORDER_FLAG_xxx
+	#define FLIGHTRECORDER_NUM_FIELDS         7
+	#define FLIGHTRECORDER_MAX_SAMPLE_BYTES   (1 + FLIGHTRECORDER_NUM_FIELDS) //mask byte + every field changed
+	#define FLIGHTRECORDER_MASK_TRIGGER    0x80 //set in mask byte of the sample where trigger occurred
+
+	#define FLIGHTRECORDER_RPM_SHIFT 5 //stored RPM = RPM >> 5 //32 RPM resolution, up to 8160 RPM
+
+	#define FLIGHTRECORDER_FLAG_BRAKE               0x01
+	#define FLIGHTRECORDER_FLAG_CLUTCH              0x02
+	#define FLIGHTRECORDER_FLAG_BUTTON              0x04
+	#define FLIGHTRECORDER_FLAG_ECM_MAMODE2_REGEN   0x08 //regen/standby
+	#define FLIGHTRECORDER_FLAG_MCM_MAMODE2_REGEN   0x10 //regen/standby
+
+	#define FLIGHTRECORDER_TRIGGER_NONE          0
+	#define FLIGHTRECORDER_TRIGGER_MAMODE1_ERROR 1
+	#define FLIGHTRECORDER_TRIGGER_RPM_CUT       2
+	#define FLIGHTRECORDER_TRIGGER_BUTTON        3
+	#define FLIGHTRECORDER_TRIGGER_USER          4 //'$DUMP' before any other trigger
+
+	void flightRecorder_handler(void); //call once per loop, after outputs are set
+
+	void flightRecorder_trigger(uint8_t reason);
+	void flightRecorder_rearm(void);
+	void flightRecorder_startDump(void);
+
+#endif
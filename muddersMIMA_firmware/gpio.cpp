@@ -3,10 +3,13 @@
 
 //all digitalRead(), digitalWrite(), analogWrite() functions live here
 //JTS2doLater: Replace Arduino fcns with low level
+//timer registers are configured in hal_avr.cpp
 
 #include "muddersMIMA.h"
 
 uint8_t mcmCMDPWR_Percent = 50;
+uint8_t mcmMAMODE1_Percent = 50;
+bool    mcmMAMODE2_bool = MAMODE2_STATE_IS_REGEN_STANDBY;
 
 ////////////////////////////////////////////////////////////////////////////////////
 
@@ -29,13 +32,7 @@ void gpio_begin(void)
     analogWrite(PIN_MAMODE1_MCM, 127); //8b counter set to 50% PWM
     digitalWrite(PIN_MAMODE2_MCM, MAMODE2_STATE_IS_REGEN_STANDBY);
 
-    // Pins D9 and D10 @ 2 kHz
-  	//TCCR1A = 0b00000011; // 10bit
-  	TCCR1B = 0b00001010; // x8 fast pwm
-
-  	// Pins D3 and D11 - 31.4 kHz (OEM is 20 kHz, but this is close enough)
-  	TCCR2B = 0b00000001; // x1 8bit
-  	TCCR2A = 0b00000001; // phase correct
+    hal_pwmTimers_begin();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -56,6 +53,9 @@ uint8_t gpio_getButton_toggle(void)
 
 void gpio_setMCM_MAMODE1_percent(uint8_t newPercent)
 {
+	if(newPercent != mcmMAMODE1_Percent) { latency_outputChanged(); }
+	mcmMAMODE1_Percent = newPercent;
+
 	uint16_t counts = (uint16_t)newPercent * 2.55; //output PWM uses 8b counter (percent*255/100)
 
 	if(counts > 255) { counts = 255; }
@@ -67,6 +67,7 @@ void gpio_setMCM_MAMODE1_percent(uint8_t newPercent)
 
 void gpio_setMCM_CMDPWR_percent(uint8_t newPercent)
 {
+	if(newPercent != mcmCMDPWR_Percent) { latency_outputChanged(); }
 	mcmCMDPWR_Percent = newPercent;
 
 	uint16_t counts = (uint16_t)newPercent * 2.55; //output PWM uses 8b counter (percent*255/100)
@@ -78,16 +79,32 @@ void gpio_setMCM_CMDPWR_percent(uint8_t newPercent)
 
 ////////////////////////////////////////////////////////////////////////////////////
 
-uint8_t gpio_getMCM_CMDPWR_percent(void) { return mcmCMDPWR_Percent; }
+uint8_t gpio_getMCM_CMDPWR_percent(void)  { return mcmCMDPWR_Percent;  }
+uint8_t gpio_getMCM_MAMODE1_percent(void) { return mcmMAMODE1_Percent; }
+bool    gpio_getMCM_MAMODE2_bool(void)    { return mcmMAMODE2_bool;    }
 
 ////////////////////////////////////////////////////////////////////////////////////
 
 bool gpio_getECM_MAMODE2_bool(void) { return digitalRead(PIN_MAMODE2_ECM); } //signal read from ECM
-void gpio_setMCM_MAMODE2_bool(bool mode) { digitalWrite(PIN_MAMODE2_MCM, mode); } //signal sent to MCM
+void gpio_setMCM_MAMODE2_bool(bool mode) //signal sent to MCM
+{
+	if(mode != mcmMAMODE2_bool) { latency_outputChanged(); }
+	mcmMAMODE2_bool = mode;
+	digitalWrite(PIN_MAMODE2_MCM, mode);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+//published by brakeLights (from ISR), once BRAKE_uC has settled
+volatile bool brakePosition = BRAKE_LIGHTS_ARE_OFF;
+
+bool gpio_getBrakePosition_bool(void) { return brakePosition; }
+void gpio_setBrakePosition_bool(bool position) { brakePosition = position; }
 
 ////////////////////////////////////////////////////////////////////////////////////
 
-bool gpio_getBrakePosition_bool(void)
+//instantaneous pin state //only valid when pin has settled
+bool gpio_readBrakePin_bool(void)
 {
 	if(digitalRead(PIN_BRAKE) == LOW) { return BRAKE_LIGHTS_ARE_OFF; }
 	else                              { return BRAKE_LIGHTS_ARE_ON;  }
@@ -118,6 +135,14 @@ void gpio_brakeLights_floatPin(void)
 
 ////////////////////////////////////////////////////////////////////////////////////
 
+//analogWrite() is too slow for an ISR (and its TCCR0A read-modify-write isn't atomic), so the PWM is connected once...
+void gpio_brakeLights_connectPWM(void) { hal_brakePWM_connect(); }
+
+//...then only OCR0B is written //digitalWrite() (e.g. gpio_brakeLights_turnOff()) disconnects PWM
+void gpio_brakeLights_setPWM(uint8_t counts) { hal_brakePWM_setCounts(counts); }
+
+////////////////////////////////////////////////////////////////////////////////////
+
 bool gpio_getClutchPosition(void)
 {
 	if(digitalRead(PIN_CLUTCH) == LOW) { return CLUTCH_PEDAL_RELEASED; }
@@ -27,12 +27,16 @@
 	void gpio_setMCM_CMDPWR_percent(uint8_t newPercent);
 
 	uint8_t gpio_getMCM_CMDPWR_percent(void);
+	uint8_t gpio_getMCM_MAMODE1_percent(void);
+	bool    gpio_getMCM_MAMODE2_bool(void);
 
 	bool gpio_getECM_MAMODE2_bool(void);
 	
 	void gpio_setMCM_MAMODE2_bool(bool mode);
 
-	bool gpio_getBrakePosition_bool(void);
+	bool gpio_getBrakePosition_bool(void); //latest settled value (see brakeLights_handler())
+	void gpio_setBrakePosition_bool(bool position);
+	bool gpio_readBrakePin_bool(void);
 
 	void gpio_brakeLights_turnOn(void);
 
@@ -40,6 +44,9 @@
 
 	void gpio_brakeLights_floatPin(void);
 
+	void gpio_brakeLights_connectPWM(void);
+	void gpio_brakeLights_setPWM(uint8_t counts); //safe in an ISR, once connected
+
 	bool gpio_getClutchPosition(void);
 
 	bool gpio_engineRPM_getPinState(void);
@@ -0,0 +1,56 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//hardware abstraction layer: every direct AVR register/peripheral access lives behind these functions
+//hal_avr.cpp is the ATmega328p backend
+//../HostTools/firmwareHost/hal_host.cpp is the Linux backend (which also provides the Arduino core subset used here)
+
+#ifndef hal_h
+	#define hal_h
+
+	void hal_pwmTimers_begin(void); //sets Timer1 & Timer2 PWM frequencies (Timer0 is left to millis())
+
+	void hal_engineRPM_interruptBegin(void); //pin change interrupt (PCINT0_vect) on PIN_NEP
+
+	void    hal_spiSlave_begin(void); //SPI_STC_vect fires once per received byte //PIN_SPI_CS edges also fire PCINT0_vect
+	bool    hal_spiSlave_isChipSelected(void);
+	uint8_t hal_spiSlave_getReceivedByte(void); //call from SPI_STC_vect
+
+	void hal_timer1Overflow_enableInterrupt(void); //TIMER1_OVF_vect //first interrupt occurs at next overflow
+	void hal_timer1Overflow_disableInterrupt(void);
+
+	void hal_timer0CompareA_enableInterrupt(uint8_t compareCounts); //TIMER0_COMPA_vect //once per Timer0 overflow
+	void hal_timer0CompareA_disableInterrupt(void);
+
+	//brake light PWM (PIN_BRAKE is OC0B, on Timer0)
+	//connect from main code while TIMER0_COMPA_vect is disabled //then _setCounts() is a single register write, so ISRs can call it
+	void hal_brakePWM_connect(void); //pin becomes an output, at 0 counts
+	void hal_brakePWM_setCounts(uint8_t counts); //Timer0 is fast PWM, so 0 counts is still high for 1/256 of each period
+
+	uint8_t hal_resetCause_getAndClear(void); //MCUSR bits
+
+	//firmware's own flash image (see imageCheck.cpp)
+	uint16_t hal_flash_imageSize_bytes(void); //from address 0 through the last programmed byte (code & initialized data)
+	uint8_t  hal_flash_readByte(uint16_t flashAddress);
+
+	void hal_idle(void); //called repeatedly while waiting for next loop //returns at the next interrupt (at most ~1 ms: Timer0 overflow)
+
+	//power-down sleep (see powerSave.cpp): ADC, Timer1, Timer2, SPI & TWI are off, and millis() doesn't advance
+	//wakes on a pin change (PIN_MAMODE1_ECM, PIN_MAMODE2_ECM, PIN_USER_MOMENTARY, or USB RX), or after HAL_POWERDOWN_WATCHDOG_ms
+	//returns YES if a pin changed (the USB character that woke the CPU is lost), or NO if the watchdog woke it
+	#define HAL_POWERDOWN_WATCHDOG_ms 16 //shortest watchdog period
+	bool hal_powerDown_untilPinChange(void);
+
+	bool    hal_eeprom_isReady(void);
+	uint8_t hal_eeprom_readByte(uint16_t eepromAddress);
+	void    hal_eeprom_writeByte(uint16_t eepromAddress, uint8_t value); //returns immediately; poll hal_eeprom_isReady()
+	void    hal_eeprom_readBlock(void *destination, uint16_t eepromAddress, uint8_t numBytes);
+
+	//benchmark cycle counter (see benchmark.cpp): Timer1 counts CPU cycles, and all interrupt sources are masked until _end()
+	void     hal_cycleCounter_begin(void); //flush Serial first (its interrupts are masked too)
+	uint32_t hal_cycleCounter_get(void); //valid up to 131071 cycles (i.e. one Timer1 overflow)
+	void     hal_cycleCounter_end(void); //restores Timer1 PWM and all interrupt masks
+
+	void hal_halt(void); //never returns //simavr exits when the CPU sleeps with interrupts disabled
+
+#endif
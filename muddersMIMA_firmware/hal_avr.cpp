@@ -0,0 +1,250 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//ATmega328p backend for hal.h (the host build replaces this file with ../HostTools/firmwareHost/hal_host.cpp)
+
+#include "muddersMIMA.h"
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hal_pwmTimers_begin(void)
+{
+	// Pins D9 and D10 @ 2 kHz
+	//TCCR1A = 0b00000011; // 10bit
+	TCCR1B = 0b00001010; // x8 fast pwm
+
+	// Pins D3 and D11 - 31.4 kHz (OEM is 20 kHz, but this is close enough)
+	TCCR2B = 0b00000001; // x1 8bit
+	TCCR2A = 0b00000001; // phase correct
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hal_engineRPM_interruptBegin(void)
+{
+	cli();
+	PCMSK0 |= (1<<PCINT0); //pin D8 will generate a pin change interrupt on ISR PCINT0_vect (which supports D8:D13)
+	PCICR |= (1<<PCIE0); //enable pin change interrupts on port B (D8:D13)
+	sei();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Enable SPI in Slave mode, with interrupt on each received byte
+// CS (D10) edges also interrupt, so each transaction's start and end are known
+void hal_spiSlave_begin(void)
+{
+	cli();
+	SPCR = (1 << SPE) | (1 << SPIE);
+	PCMSK0 |= (1<<PCINT2);
+	PCICR |= (1<<PCIE0);
+	sei();
+}
+
+bool hal_spiSlave_isChipSelected(void) { return ((PINB & (1 << PINB2)) == 0); } //CS is active low
+
+uint8_t hal_spiSlave_getReceivedByte(void) { return SPDR; }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hal_timer1Overflow_enableInterrupt(void)
+{
+	TIFR1 = (1 << TOV1); //first interrupt occurs at next overflow (not a stale one)
+	TIMSK1 |= (1 << TOIE1);
+}
+
+void hal_timer1Overflow_disableInterrupt(void) { TIMSK1 &= ~(1 << TOIE1); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hal_timer0CompareA_enableInterrupt(uint8_t compareCounts)
+{
+	OCR0A = compareCounts;
+	TIFR0 = (1 << OCF0A); //clear stale flag
+	TIMSK0 |= (1 << OCIE0A);
+}
+
+void hal_timer0CompareA_disableInterrupt(void) { TIMSK0 &= ~(1 << OCIE0A); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hal_brakePWM_connect(void)
+{
+	OCR0B = 0;
+	TCCR0A |= (1 << COM0B1); //non-inverting //Arduino core already set Timer0 to fast PWM
+	DDRD |= (1 << DDD5);
+}
+
+void hal_brakePWM_setCounts(uint8_t counts) { OCR0B = counts; }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//optiboot clears MCUSR before jumping here, but first copies it to GPIOR0
+uint8_t hal_resetCause_getAndClear(void)
+{
+	uint8_t resetCause = MCUSR;
+	if(resetCause == 0) { resetCause = GPIOR0; } //MCUSR is only non-zero if the bootloader didn't run (e.g. ISP upload)
+	MCUSR = 0;
+	GPIOR0 = 0;
+
+	return resetCause;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+extern char __data_load_end[]; //linker script: end of initialized data's flash copy, which follows the code
+
+uint16_t hal_flash_imageSize_bytes(void)            { return (uint16_t)(uintptr_t)__data_load_end; }
+uint8_t  hal_flash_readByte(uint16_t flashAddress) { return pgm_read_byte(flashAddress); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//idle mode stops the CPU clock only, so timers, UART, SPI & EEPROM keep running
+//any interrupt wakes the CPU, and Timer0's overflow (millis()) occurs every 1.024 ms
+void hal_idle(void)
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	cli();
+	sleep_enable();
+	sei(); //next instruction always executes, so an interrupt that's already pending can't be missed
+	sleep_cpu();
+	sleep_disable();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+volatile bool hal_wasWokenByPinChange = NO;
+
+ISR(PCINT1_vect) { hal_wasWokenByPinChange = YES; } //PIN_MAMODE1_ECM or PIN_USER_MOMENTARY
+ISR(PCINT2_vect) { hal_wasWokenByPinChange = YES; } //PIN_MAMODE2_ECM or USB RX
+EMPTY_INTERRUPT(WDT_vect);
+
+#if (HAL_POWERDOWN_WATCHDOG_ms != 16)
+	#error "hal_powerDown_untilPinChange() sets the watchdog's prescaler for 16 ms"
+#endif
+
+bool hal_powerDown_untilPinChange(void)
+{
+	uint8_t saved_ADCSRA = ADCSRA;
+	uint8_t saved_PRR    = PRR;
+	uint8_t saved_PCICR  = PCICR;
+	uint8_t saved_ACSR   = ACSR;
+
+	ADCSRA &= ~(1 << ADEN); //ADC must be disabled before it's shut down
+	ACSR |= (1 << ACD); //analog comparator (unused)
+	PRR |= (1 << PRADC) | (1 << PRTIM1) | (1 << PRTIM2) | (1 << PRSPI) | (1 << PRTWI);
+
+	cli();
+	hal_wasWokenByPinChange = NO;
+	PCMSK1 = (1 << PCINT9)  | (1 << PCINT11); //A1 & A3
+	PCMSK2 = (1 << PCINT16) | (1 << PCINT20); //D0 (RX) & D4
+	PCIFR  = (1 << PCIF1) | (1 << PCIF2); //only edges from now on wake the CPU
+	PCICR |= (1 << PCIE1) | (1 << PCIE2);
+
+	wdt_reset();
+	WDTCSR = (1 << WDCE) | (1 << WDE);
+	WDTCSR = (1 << WDIE); //interrupt (not reset) after 2048 watchdog oscillator cycles (16 ms)
+
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+	sleep_bod_disable(); //must be followed by sleep_cpu() within three cycles
+	sei(); //next instruction always executes, so an interrupt that's already pending can't be missed
+	sleep_cpu();
+	sleep_disable();
+
+	cli();
+	wdt_reset();
+	WDTCSR = (1 << WDCE) | (1 << WDE);
+	WDTCSR = 0;
+	PCICR = saved_PCICR;
+	PCMSK1 = 0;
+	PCMSK2 = 0;
+	sei();
+
+	PRR = saved_PRR;
+	ACSR = saved_ACSR;
+	ADCSRA = saved_ADCSRA; //the first conversion after re-enabling takes 25 ADC clocks (analogRead() waits)
+
+	return hal_wasWokenByPinChange;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool    hal_eeprom_isReady(void)                                    { return eeprom_is_ready(); }
+uint8_t hal_eeprom_readByte(uint16_t eepromAddress)                 { return eeprom_read_byte((const uint8_t *)eepromAddress); }
+void    hal_eeprom_writeByte(uint16_t eepromAddress, uint8_t value) { eeprom_write_byte((uint8_t *)eepromAddress, value); }
+
+void hal_eeprom_readBlock(void *destination, uint16_t eepromAddress, uint8_t numBytes)
+{
+	eeprom_read_block(destination, (const void *)eepromAddress, numBytes);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t cycleCounter_saved_TCCR1A;
+uint8_t cycleCounter_saved_TCCR1B;
+uint8_t cycleCounter_saved_TIMSK0;
+uint8_t cycleCounter_saved_TIMSK1;
+uint8_t cycleCounter_saved_TIMSK2;
+uint8_t cycleCounter_saved_PCICR;
+uint8_t cycleCounter_saved_SPCR;
+uint8_t cycleCounter_saved_UCSR0B;
+
+void hal_cycleCounter_begin(void)
+{
+	cycleCounter_saved_TCCR1A = TCCR1A;
+	cycleCounter_saved_TCCR1B = TCCR1B;
+	cycleCounter_saved_TIMSK0 = TIMSK0;
+	cycleCounter_saved_TIMSK1 = TIMSK1;
+	cycleCounter_saved_TIMSK2 = TIMSK2;
+	cycleCounter_saved_PCICR  = PCICR;
+	cycleCounter_saved_SPCR   = SPCR;
+	cycleCounter_saved_UCSR0B = UCSR0B;
+
+	//nothing can interrupt the code under test (ISRs re-enable interrupts when called directly, via 'reti')
+	TIMSK0 = 0;
+	TIMSK1 = 0;
+	TIMSK2 = 0;
+	PCICR  = 0;
+	SPCR   &= ~(1 << SPIE);
+	UCSR0B &= ~((1 << RXCIE0) | (1 << UDRIE0));
+
+	TCCR1A = 0; //normal mode (counts 0:65535)
+	TCCR1B = (1 << CS10); //no prescaler: one count per CPU cycle
+	TCNT1 = 0;
+	TIFR1 = (1 << TOV1);
+}
+
+uint32_t hal_cycleCounter_get(void)
+{
+	uint16_t counts = TCNT1;
+
+	//TOV1 with a small count means the overflow happened before TCNT1 was read
+	if( (TIFR1 & (1 << TOV1)) && (counts < 0x8000) ) { return 0x10000UL + counts; }
+
+	return counts;
+}
+
+void hal_cycleCounter_end(void)
+{
+	TCCR1A = cycleCounter_saved_TCCR1A;
+	TCCR1B = cycleCounter_saved_TCCR1B;
+	TIMSK0 = cycleCounter_saved_TIMSK0;
+	TIMSK1 = cycleCounter_saved_TIMSK1;
+	TIMSK2 = cycleCounter_saved_TIMSK2;
+	PCICR  = cycleCounter_saved_PCICR;
+	SPCR   = cycleCounter_saved_SPCR;
+	UCSR0B = cycleCounter_saved_UCSR0B;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void hal_halt(void)
+{
+	cli();
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	sleep_enable();
+	while(1) { sleep_cpu(); }
+}
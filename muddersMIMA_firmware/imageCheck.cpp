@@ -0,0 +1,108 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Flash is read a little each loop, so boot isn't delayed and the control loop keeps its timing.
+//The header is PROGMEM, and it's read by imageCheck_begin(), so the linker keeps it (and imageStamp can find it).
+
+#include "muddersMIMA.h"
+
+const imageCheck_header imageCheck_headerInFlash PROGMEM =
+{
+	{ 'L', 'i', 'C', (char)0xA5 }, //IMAGECHECK_MAGIC
+	IMAGECHECK_CRC_UNSTAMPED,
+	FW_VERSION "," BUILD_DATE
+};
+
+uint8_t  imageCheckStatus = IMAGECHECK_STATUS_CHECKING;
+uint16_t imageCheck_expectedCRC = IMAGECHECK_CRC_UNSTAMPED;
+uint16_t imageCheck_actualCRC = IMAGECHECK_CRC_INITIAL_VALUE;
+uint16_t imageCheck_nextAddress = 0;
+uint16_t imageCheck_imageSize_bytes = 0;
+uint16_t imageCheck_crcFieldAddress = 0; //these two bytes aren't included
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void imageCheck_restart(void)
+{
+	imageCheck_nextAddress = 0;
+	imageCheck_actualCRC = IMAGECHECK_CRC_INITIAL_VALUE;
+	imageCheckStatus = IMAGECHECK_STATUS_CHECKING;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void imageCheck_begin(void)
+{
+	imageCheck_expectedCRC = pgm_read_word(&imageCheck_headerInFlash.crc);
+	imageCheck_crcFieldAddress = (uint16_t)(uintptr_t)&imageCheck_headerInFlash.crc;
+	imageCheck_imageSize_bytes = hal_flash_imageSize_bytes();
+	imageCheck_restart();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void imageCheck_handler(void)
+{
+	if(imageCheckStatus != IMAGECHECK_STATUS_CHECKING) { return; }
+
+	uint16_t numBytesRemaining = imageCheck_imageSize_bytes - imageCheck_nextAddress;
+	uint8_t numBytesThisLoop = (numBytesRemaining < IMAGECHECK_BYTES_PER_LOOP) ? (uint8_t)numBytesRemaining : IMAGECHECK_BYTES_PER_LOOP;
+
+	for(uint8_t ii = 0; ii < numBytesThisLoop; ii++)
+	{
+		if( (uint16_t)(imageCheck_nextAddress - imageCheck_crcFieldAddress) >= sizeof(imageCheck_headerInFlash.crc) ) { imageCheck_actualCRC = _crc_ccitt_update(imageCheck_actualCRC, hal_flash_readByte(imageCheck_nextAddress)); }
+		imageCheck_nextAddress++;
+	}
+
+	if(imageCheck_nextAddress < imageCheck_imageSize_bytes) { return; }
+
+	if     (imageCheck_expectedCRC == IMAGECHECK_CRC_UNSTAMPED) { imageCheckStatus = IMAGECHECK_STATUS_UNSTAMPED; }
+	else if(imageCheck_expectedCRC == imageCheck_actualCRC)                { imageCheckStatus = IMAGECHECK_STATUS_OK;        }
+	else
+	{
+		imageCheckStatus = IMAGECHECK_STATUS_MISMATCH;
+		eventLog_logEvent(EVENTLOG_TYPE_IMAGE_CRC_MISMATCH, imageCheck_actualCRC);
+	}
+
+	debugUSB_recordStart();
+	imageCheck_printStatus();
+	debugUSB_recordCommit();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t imageCheck_status_get(void) { return imageCheckStatus; }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void imageCheck_printHex(uint16_t value)
+{
+	debugUSB_recordAppend_string(F("0x"));
+	for(int8_t shift = 12; shift >= 0; shift -= 4)
+	{
+		uint8_t nibble = (value >> shift) & 0x0F;
+		debugUSB_recordAppend_char((nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void imageCheck_printStatus(void)
+{
+	debugUSB_recordAppend_string(F("\nImage v"));
+	debugUSB_recordAppend_string(reinterpret_cast<const __FlashStringHelper *>(imageCheck_headerInFlash.version));
+	debugUSB_recordAppend_string(F(", CRC "));
+
+	if(imageCheckStatus == IMAGECHECK_STATUS_CHECKING) { debugUSB_recordAppend_string(F("check in progress")); return; }
+
+	imageCheck_printHex(imageCheck_actualCRC);
+
+	if     (imageCheckStatus == IMAGECHECK_STATUS_OK)        { debugUSB_recordAppend_string(F(" OK")); }
+	else if(imageCheckStatus == IMAGECHECK_STATUS_UNSTAMPED) { debugUSB_recordAppend_string(F(" (unstamped, see HostTools/imageStamp)")); }
+	else
+	{
+		debugUSB_recordAppend_string(F(" MISMATCH (expected "));
+		imageCheck_printHex(imageCheck_expectedCRC);
+		debugUSB_recordAppend_string(F("): flash is corrupted, reflash firmware"));
+	}
+}
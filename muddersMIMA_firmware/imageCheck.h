@@ -0,0 +1,43 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//firmware image version & CRC check
+//this file is also used by the host stamping tool (../HostTools/imageStamp), so it must only use <stdint.h> types
+
+//the Arduino build can't calculate the image's CRC, so the header's CRC is IMAGECHECK_CRC_UNSTAMPED until imageStamp patches the .hex file
+//CRC16: _crc_ccitt_update(), initial value 0xFFFF, over every flash byte from address 0 to the end of the image, except the header's CRC field
+
+#ifndef imageCheck_h
+	#define imageCheck_h
+
+	#define IMAGECHECK_MAGIC "LiC\xA5" //imageStamp finds the header by searching for this (must only occur once)
+	#define IMAGECHECK_MAGIC_BYTES 4
+	#define IMAGECHECK_VERSION_BYTES 24 //FW_VERSION "," BUILD_DATE, null terminated
+	#define IMAGECHECK_CRC_UNSTAMPED 0xFFFF //imageStamp refuses images whose actual CRC is this value
+	#define IMAGECHECK_CRC_INITIAL_VALUE 0xFFFF
+
+	struct __attribute__((packed)) imageCheck_header
+	{
+		char     magic[IMAGECHECK_MAGIC_BYTES];
+		uint16_t crc; //little endian
+		char     version[IMAGECHECK_VERSION_BYTES];
+	};
+
+	//the whole image is checked in the background over the first few seconds after boot
+	//~260 us per loop: estimated at ~32 cycles per byte (_crc_ccitt_update ~17, LPM 3, CRC field check & loop ~12), not yet measured on AVR
+	//run the "imageCheck_handler" benchmark (../HostTools/avrBenchmark) to measure it
+	#define IMAGECHECK_BYTES_PER_LOOP 128
+
+	#define IMAGECHECK_STATUS_CHECKING  0
+	#define IMAGECHECK_STATUS_OK        1
+	#define IMAGECHECK_STATUS_MISMATCH  2 //logged as EVENTLOG_TYPE_IMAGE_CRC_MISMATCH
+	#define IMAGECHECK_STATUS_UNSTAMPED 3 //e.g. uploaded directly from the Arduino application
+
+	void imageCheck_begin(void);
+	void imageCheck_restart(void); //checks the whole image again (e.g. benchmark)
+	void imageCheck_handler(void); //call once per loop //prints the result when the check completes
+
+	uint8_t imageCheck_status_get(void);
+	void imageCheck_printStatus(void); //adds version & CRC status to caller's record
+
+#endif
@@ -0,0 +1,218 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Joystick neutral and endpoints vary between units, so the nominal ±5% neutral band wastes resolution.
+//'$CAL' measures this unit's neutral position (and its noise), then its endpoints.
+//The result is a two-slope fixed-point map (one multiply-shift per reading), stored in EEPROM.
+
+#include "muddersMIMA.h"
+
+#define CAL_STATE_IDLE      0
+#define CAL_STATE_NEUTRAL   1 //user leaves joystick centered
+#define CAL_STATE_ENDPOINTS 2 //user moves joystick to both ends
+
+joystickCalibration calibration;   //map used by adc_readJoystick_percent()
+joystickCalibration storedCalibration; //written to EEPROM (in background)
+bool isCalibrationValid = NO;
+
+uint8_t calState = CAL_STATE_IDLE;
+uint8_t calNumSamples = 0;
+uint16_t calSum_counts = 0;
+uint16_t calMin_counts = 0;
+uint16_t calMax_counts = 0;
+uint8_t calNoise_counts = 0; //neutral peak-to-peak
+uint32_t calEndpointsStart_ms = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t joystickCal_calculateCRC(const joystickCalibration *cal)
+{
+	const uint8_t *calBytes = (const uint8_t *)cal;
+	uint16_t crc = 0xFFFF;
+
+	for(uint8_t ii = 0; ii < offsetof(joystickCalibration, crc); ii++) { crc = _crc_ccitt_update(crc, calBytes[ii]); }
+
+	return crc;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void joystickCal_begin(void)
+{
+	hal_eeprom_readBlock(&calibration, EEPROM_ADDRESS_CALIBRATION, sizeof(calibration));
+
+	isCalibrationValid = ( (calibration.version == JOYSTICK_CAL_VERSION) &&
+	                       (calibration.crc     == joystickCal_calculateCRC(&calibration)) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool joystickCal_isCalibrated(void) { return isCalibrationValid; }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t joystickCal_countsToPercent(uint16_t counts)
+{
+	if(counts >= calibration.neutral_counts)
+	{
+		uint16_t offset_percent = (uint16_t)(((uint32_t)(counts - calibration.neutral_counts) * calibration.gainAbove + JOYSTICK_CAL_ROUNDING) >> JOYSTICK_CAL_GAIN_SHIFT);
+		if(offset_percent > (100 - JOYSTICK_NEUTRAL_NOM_PERCENT)) { return 100; }
+		return JOYSTICK_NEUTRAL_NOM_PERCENT + (uint8_t)offset_percent;
+	}
+	else
+	{
+		uint16_t offset_percent = (uint16_t)(((uint32_t)(calibration.neutral_counts - counts) * calibration.gainBelow + JOYSTICK_CAL_ROUNDING) >> JOYSTICK_CAL_GAIN_SHIFT);
+		if(offset_percent > JOYSTICK_NEUTRAL_NOM_PERCENT) { return 0; }
+		return JOYSTICK_NEUTRAL_NOM_PERCENT - (uint8_t)offset_percent;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//'$CAL' starts calibration //'$CAL=CLR' reverts to nominal joystick
+void joystickCal_start(const uint8_t *argument)
+{
+	if(argument != NULL)
+	{
+		if(strcmp_P((const char *)argument, PSTR("CLR")) != 0) { debugUSB_recordAppend_string(F("\nError: Use '$CAL' or '$CAL=CLR'")); return; }
+		if(eeprom_isBlockPending(&storedCalibration) == true)  { debugUSB_recordAppend_string(F("\nError: EEPROM busy. Try again")); return; }
+
+		isCalibrationValid = NO;
+		storedCalibration.version = 0; //invalid
+		if(eeprom_writeBlock_deferred(EEPROM_ADDRESS_CALIBRATION, &storedCalibration, 1) == false) { debugUSB_recordAppend_string(F("\nError: EEPROM busy. Try again")); return; }
+
+		debugUSB_recordAppend_string(F("\nJoystick calibration cleared (nominal joystick assumed)"));
+		return;
+	}
+
+	//the joystick commands real assist/regen while the key is on
+	if(time_keyOffDuration_ms() == 0) { debugUSB_recordAppend_string(F("\nError: Turn key OFF first. Calibration not started")); return; }
+
+	calState = CAL_STATE_NEUTRAL;
+	calNumSamples = 0;
+	calSum_counts = 0;
+	calMin_counts = ADC_NUM_COUNTS_10b;
+	calMax_counts = 0;
+
+	debugUSB_recordAppend_string(F("\nCalibrating joystick neutral (turning key ON cancels). Don't touch joystick..."));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void joystickCal_finishNeutral(void)
+{
+	uint16_t neutral_counts = calSum_counts >> JOYSTICK_CAL_NEUTRAL_SHIFT;
+	uint16_t noise_counts = calMax_counts - calMin_counts;
+
+	debugUSB_recordStart();
+	debugUSB_recordAppend_string(F("\nNeutral: "));
+	debugUSB_recordAppend_uint(neutral_counts);
+	debugUSB_recordAppend_string(F(" counts, noise: "));
+	debugUSB_recordAppend_uint(noise_counts);
+	debugUSB_recordAppend_string(F(" counts peak-to-peak"));
+
+	if( (neutral_counts < JOYSTICK_CAL_NEUTRAL_MIN_COUNTS) || (neutral_counts > JOYSTICK_CAL_NEUTRAL_MAX_COUNTS) )
+	{
+		debugUSB_recordAppend_string(F("\nError: Joystick isn't centered. Calibration cancelled"));
+		calState = CAL_STATE_IDLE;
+	}
+	else
+	{
+		storedCalibration.neutral_counts = neutral_counts;
+		calNoise_counts = (noise_counts > 0xFF) ? 0xFF : (uint8_t)noise_counts;
+
+		debugUSB_recordAppend_string(F("\nNow move joystick to full assist and full regen..."));
+		calMin_counts = neutral_counts;
+		calMax_counts = neutral_counts;
+		calEndpointsStart_ms = millis();
+		calState = CAL_STATE_ENDPOINTS;
+	}
+
+	debugUSB_recordCommit();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void joystickCal_finishEndpoints(void)
+{
+	uint16_t neutral_counts = storedCalibration.neutral_counts;
+
+	calState = CAL_STATE_IDLE;
+
+	debugUSB_recordStart();
+	debugUSB_recordAppend_string(F("\nEndpoints: "));
+	debugUSB_recordAppend_uint(calMin_counts);
+	debugUSB_recordAppend_string(F(" to "));
+	debugUSB_recordAppend_uint(calMax_counts);
+	debugUSB_recordAppend_string(F(" counts"));
+
+	if( ((calMax_counts - neutral_counts) < JOYSTICK_CAL_MIN_SPAN_COUNTS) ||
+		((neutral_counts - calMin_counts) < JOYSTICK_CAL_MIN_SPAN_COUNTS)  )
+	{
+		debugUSB_recordAppend_string(F("\nError: Joystick wasn't moved to both ends. Calibration cancelled"));
+		debugUSB_recordCommit();
+		return;
+	}
+
+	if(eeprom_isBlockPending(&storedCalibration) == true)
+	{
+		debugUSB_recordAppend_string(F("\nError: EEPROM busy. Calibration cancelled"));
+		debugUSB_recordCommit();
+		return;
+	}
+
+	storedCalibration.version = JOYSTICK_CAL_VERSION;
+	storedCalibration.gainAbove = (uint16_t)(((uint32_t)(JOYSTICK_CAL_ENDPOINT_HIGH_PERCENT - JOYSTICK_NEUTRAL_NOM_PERCENT) << JOYSTICK_CAL_GAIN_SHIFT) / (calMax_counts - neutral_counts));
+	storedCalibration.gainBelow = (uint16_t)(((uint32_t)(JOYSTICK_NEUTRAL_NOM_PERCENT - JOYSTICK_CAL_ENDPOINT_LOW_PERCENT ) << JOYSTICK_CAL_GAIN_SHIFT) / (neutral_counts - calMin_counts));
+	storedCalibration.crc = joystickCal_calculateCRC(&storedCalibration);
+
+	calibration = storedCalibration;
+	isCalibrationValid = YES;
+
+	if(eeprom_writeBlock_deferred(EEPROM_ADDRESS_CALIBRATION, &storedCalibration, sizeof(storedCalibration)) == false)
+	{
+		debugUSB_recordAppend_string(F("\nError: EEPROM busy. Calibration used until keyOFF, but not saved"));
+	}
+	else { debugUSB_recordAppend_string(F("\nCalibration saved")); }
+
+	//neutral band only needs to cover noise (in percent, using the steeper side), plus one percent margin
+	uint16_t steeperGain = (storedCalibration.gainAbove > storedCalibration.gainBelow) ? storedCalibration.gainAbove : storedCalibration.gainBelow;
+	uint16_t deadband_percent = (uint16_t)((((uint32_t)calNoise_counts * steeperGain) >> JOYSTICK_CAL_GAIN_SHIFT) + 1 + 1); //round up, plus margin
+	if(deadband_percent > JOYSTICK_DEADBAND_DEFAULT_PERCENT) { deadband_percent = JOYSTICK_DEADBAND_DEFAULT_PERCENT; }
+
+	param.joystickDeadband_percent = (uint8_t)deadband_percent;
+	debugUSB_recordAppend_string(F("\nJDEADBAND set to "));
+	debugUSB_recordAppend_uint(deadband_percent);
+	debugUSB_recordAppend_string(F("%. Type '$SAVE' to keep it"));
+
+	debugUSB_recordCommit();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void joystickCal_handler(void)
+{
+	if(calState == CAL_STATE_IDLE) { return; }
+
+	if(time_keyOffDuration_ms() == 0)
+	{
+		calState = CAL_STATE_IDLE;
+		debugUSB_recordStart();
+		debugUSB_recordAppend_string(F("\nError: Key turned ON. Calibration cancelled"));
+		debugUSB_recordCommit();
+		return;
+	}
+
+	uint16_t counts = adc_readJoystick_counts();
+
+	if(counts < calMin_counts) { calMin_counts = counts; }
+	if(counts > calMax_counts) { calMax_counts = counts; }
+
+	if(calState == CAL_STATE_NEUTRAL)
+	{
+		calSum_counts += counts; //64 * 1023 fits in 16 bits
+
+		if(++calNumSamples >= JOYSTICK_CAL_NEUTRAL_NUM_SAMPLES) { joystickCal_finishNeutral(); }
+	}
+	else if( (millis() - calEndpointsStart_ms) > JOYSTICK_CAL_ENDPOINTS_DURATION_ms) { joystickCal_finishEndpoints(); }
+}
@@ -0,0 +1,43 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//per-unit joystick calibration ('$CAL')
+
+#ifndef joystickCalibration_h
+	#define joystickCalibration_h
+
+	#define JOYSTICK_CAL_VERSION 1
+
+	#define JOYSTICK_CAL_NEUTRAL_NUM_SAMPLES  64 //must be a power of two //one sample per loop
+	#define JOYSTICK_CAL_NEUTRAL_SHIFT         6 //log2(JOYSTICK_CAL_NEUTRAL_NUM_SAMPLES)
+	#define JOYSTICK_CAL_ENDPOINTS_DURATION_ms 5000 //time user has to move joystick to both ends
+
+	//calibrated endpoints map to the nominal joystick output range, so JOYSTICK_MIN/MAX_ALLOWED_PERCENT still detect wiring faults
+	#define JOYSTICK_CAL_ENDPOINT_LOW_PERCENT  10
+	#define JOYSTICK_CAL_ENDPOINT_HIGH_PERCENT 90
+
+	#define JOYSTICK_CAL_MIN_SPAN_COUNTS      100 //each side of neutral (also limits gain to 16 bits)
+	#define JOYSTICK_CAL_NEUTRAL_MIN_COUNTS   358 //35% //neutral must be roughly centered
+	#define JOYSTICK_CAL_NEUTRAL_MAX_COUNTS   665 //65%
+
+	#define JOYSTICK_CAL_GAIN_SHIFT 16 //percent = neutral + ((counts - neutral_counts) * gain) >> 16
+	#define JOYSTICK_CAL_ROUNDING ((uint32_t)1 << (JOYSTICK_CAL_GAIN_SHIFT - 1))
+
+	struct __attribute__((packed)) joystickCalibration
+	{
+		uint8_t  version;        //JOYSTICK_CAL_VERSION
+		uint16_t neutral_counts; //raw ADC counts (before INVERT_JOYSTICK_DIRECTION)
+		uint16_t gainAbove;      //used when counts > neutral_counts
+		uint16_t gainBelow;      //used when counts < neutral_counts
+		uint16_t crc;
+	};
+
+	void joystickCal_begin(void); //loads calibration from EEPROM
+
+	bool joystickCal_isCalibrated(void);
+	uint8_t joystickCal_countsToPercent(uint16_t counts); //only valid if joystickCal_isCalibrated()
+
+	void joystickCal_start(const uint8_t *argument); //'$CAL' (key must be OFF) or '$CAL=CLR'
+	void joystickCal_handler(void); //call once per loop //cancels calibration if key turns ON
+
+#endif
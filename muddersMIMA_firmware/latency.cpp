@@ -0,0 +1,141 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Only the first input change is timed: later changes (before any output changes) are part of the same event.
+//Disabled by default, so the control loop only pays for one comparison per input.
+
+#include "muddersMIMA.h"
+
+bool isLatencyEnabled = NO;
+bool isInputChangePending = NO;
+uint32_t inputChanged_us = 0;
+uint8_t previousInputValues[LATENCY_NUM_INPUTS];
+#if (LATENCY_NUM_INPUTS > 8)
+	#error "isPreviousValueValid has one bit per input"
+#endif
+uint8_t isPreviousValueValid = 0; //one bit per input //every uint8_t value is a real sample (e.g. MAMODE1_STATE_IS_UNDEFINED is 255)
+
+uint16_t latencyBins[LATENCY_NUM_BINS];
+uint16_t numNoResponse = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void latency_start(void)
+{
+	for(uint8_t ii = 0; ii < LATENCY_NUM_BINS; ii++) { latencyBins[ii] = 0; }
+	numNoResponse = 0;
+	isInputChangePending = NO;
+	isPreviousValueValid = 0;
+	isLatencyEnabled = YES; //first sample of each input only stores its value (see below)
+}
+
+void latency_stop(void) { isLatencyEnabled = NO; }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void latency_inputSampled(uint8_t input, uint8_t value)
+{
+	if(isLatencyEnabled == NO) { return; }
+
+	uint8_t inputBit = (1 << input);
+	if( (isPreviousValueValid & inputBit) == 0 )
+	{
+		previousInputValues[input] = value;
+		isPreviousValueValid |= inputBit;
+		return;
+	}
+
+	uint8_t previousValue = previousInputValues[input];
+	uint8_t minChange = ( (input == LATENCY_INPUT_ECM_CMDPWR) || (input == LATENCY_INPUT_JOYSTICK) ) ? LATENCY_MIN_CHANGE_PERCENT : 1;
+	uint8_t change = (value > previousValue) ? (value - previousValue) : (previousValue - value);
+
+	if(change < minChange) { return; }
+	previousInputValues[input] = value;
+
+	if(isInputChangePending == NO)
+	{
+		inputChanged_us = micros();
+		isInputChangePending = YES;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void latency_outputChanged(void)
+{
+	if(isInputChangePending == NO) { return; } //also true when disabled
+
+	uint32_t latency_us = micros() - inputChanged_us;
+	uint8_t bin = 0;
+
+	while( (latency_us > 1) && (bin < (LATENCY_NUM_BINS - 1)) ) { latency_us >>= 1; bin++; }
+
+	if(latencyBins[bin] < UINT16_MAX) { latencyBins[bin]++; }
+	isInputChangePending = NO;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void latency_handler(void)
+{
+	if(isInputChangePending == NO) { return; }
+
+	if( (micros() - inputChanged_us) > (LATENCY_NO_RESPONSE_TIMEOUT_ms * 1000UL) )
+	{
+		if(numNoResponse < UINT16_MAX) { numNoResponse++; }
+		isInputChangePending = NO;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//percentiles are the upper edge of the bin containing that sample
+//the last bin is open ended, so a percentile there is printed as its lower edge (e.g. 'p99>=32768')
+void latency_printPercentile(const __FlashStringHelper *name, uint8_t bin)
+{
+	debugUSB_recordAppend_string(name);
+
+	if(bin == (LATENCY_NUM_BINS - 1)) { debugUSB_recordAppend_string(F(">=")); debugUSB_recordAppend_uint(1UL << bin);       }
+	else                              { debugUSB_recordAppend_char('<');       debugUSB_recordAppend_uint(1UL << (bin + 1)); }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void latency_printHistogram(void)
+{
+	uint32_t numSamples = 0;
+	for(uint8_t ii = 0; ii < LATENCY_NUM_BINS; ii++) { numSamples += latencyBins[ii]; }
+
+	debugUSB_recordAppend_string(isLatencyEnabled ? F("\nLatency (running)") : F("\nLatency (stopped)"));
+	debugUSB_recordAppend_string(F(", input change to MCM output change (us):"));
+
+	uint32_t numSamplesBelow = 0;
+	uint8_t p50_bin = LATENCY_NUM_BINS; //LATENCY_NUM_BINS: no samples
+	uint8_t p99_bin = LATENCY_NUM_BINS;
+
+	for(uint8_t ii = 0; ii < LATENCY_NUM_BINS; ii++)
+	{
+		if(latencyBins[ii] == 0) { continue; }
+
+		uint32_t binEnd_us = (1UL << (ii + 1));
+
+		numSamplesBelow += latencyBins[ii];
+		if( (p50_bin == LATENCY_NUM_BINS) && ((numSamplesBelow * 100) >= (numSamples * 50)) ) { p50_bin = ii; }
+		if( (p99_bin == LATENCY_NUM_BINS) && ((numSamplesBelow * 100) >= (numSamples * 99)) ) { p99_bin = ii; }
+
+		debugUSB_recordAppend_string((ii == (LATENCY_NUM_BINS - 1)) ? F("\n >=") : F("\n <"));
+		debugUSB_recordAppend_uint((ii == (LATENCY_NUM_BINS - 1)) ? (binEnd_us / 2) : binEnd_us);
+		debugUSB_recordAppend_string(F(": "));
+		debugUSB_recordAppend_uint(latencyBins[ii]);
+	}
+
+	debugUSB_recordAppend_string(F("\n samples: "));
+	debugUSB_recordAppend_uint(numSamples);
+	if(numSamples > 0)
+	{
+		latency_printPercentile(F(", p50"), p50_bin);
+		latency_printPercentile(F(", p99"), p99_bin);
+	}
+	debugUSB_recordAppend_string(F(", no response: "));
+	debugUSB_recordAppend_uint(numNoResponse);
+}
@@ -0,0 +1,34 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//input->output latency histogram ('$LAT=ON' to start, '$LAT' to view)
+//measures time from when LiControl first sees an input change, until an MCM output changes
+//time before LiControl sees a change (RC filter, loop period) and after (PWM period) isn't included... see ../HostTools/latencyHarness
+
+#ifndef latency_h
+	#define latency_h
+
+	#define LATENCY_INPUT_ECM_MAMODE1 0 //state
+	#define LATENCY_INPUT_ECM_MAMODE2 1 //state
+	#define LATENCY_INPUT_ECM_CMDPWR  2 //percent
+	#define LATENCY_INPUT_JOYSTICK    3 //percent
+	#define LATENCY_NUM_INPUTS        4
+
+	#define LATENCY_MIN_CHANGE_PERCENT 2 //smaller CMDPWR/joystick changes are ADC noise
+
+	//bin N counts latencies from 2^N to (2^(N+1) - 1) us (bin 0 also counts 0 us) //last bin also counts anything longer
+	#define LATENCY_NUM_BINS 16
+
+	//an input change that hasn't changed any output by then (e.g. joystick in OEM mode) is counted as 'no response'
+	#define LATENCY_NO_RESPONSE_TIMEOUT_ms 250
+
+	void latency_inputSampled(uint8_t input, uint8_t value); //call wherever an input is read
+	void latency_outputChanged(void); //call whenever an MCM output changes
+
+	void latency_handler(void);
+
+	void latency_start(void); //also clears histogram
+	void latency_stop(void);
+	void latency_printHistogram(void); //adds to caller's record
+
+#endif
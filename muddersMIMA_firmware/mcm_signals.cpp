@@ -13,6 +13,18 @@ void mcm_setCMDPWR_percent(uint8_t newPercent) { gpio_setMCM_CMDPWR_percent (new
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
+//limit stage: LiBCM can reduce assist and regen, regardless of which mode generated the request
+uint8_t mcm_applyLimits_CMDPWR_percent(uint8_t MAMODE1_state, uint8_t CMDPWR_percent)
+{
+	if( (MAMODE1_state == MAMODE1_STATE_IS_ASSIST) ||
+		(MAMODE1_state == MAMODE1_STATE_IS_REGEN )  ) { CMDPWR_percent = LiBCM_limitCMDPWR_percent(CMDPWR_percent); }
+	//else { ; } //don't modify CMDPWR during prestart, autostop, start, etc
+
+	return CMDPWR_percent;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
 void mcm_setAllSignals(uint8_t newState, uint16_t CMDPWR_percent)
 {
 	mcm_setMAMODE1_state(newState);
@@ -20,9 +32,11 @@ void mcm_setAllSignals(uint8_t newState, uint16_t CMDPWR_percent)
 	if(CMDPWR_percent > 90) { CMDPWR_percent = 90; }
 	if(CMDPWR_percent < 10) { CMDPWR_percent = 10; }
 
+	CMDPWR_percent = mcm_applyLimits_CMDPWR_percent(newState, CMDPWR_percent);
+
 	if     (newState == MAMODE1_STATE_IS_ASSIST) { mcm_setMAMODE2_state(MAMODE2_STATE_IS_ASSIST);        mcm_setCMDPWR_percent(CMDPWR_percent); }
 	else if(newState == MAMODE1_STATE_IS_REGEN)  { mcm_setMAMODE2_state(MAMODE2_STATE_IS_REGEN_STANDBY); mcm_setCMDPWR_percent(CMDPWR_percent); }
-	else if(newState == MAMODE1_STATE_IS_IDLE)   { mcm_setMAMODE2_state(MAMODE2_STATE_IS_REGEN_STANDBY); mcm_setCMDPWR_percent(50);             }
+	else if(newState == MAMODE1_STATE_IS_IDLE)   { mcm_setMAMODE2_state(MAMODE2_STATE_IS_REGEN_STANDBY); mcm_setCMDPWR_percent(MCM_CMDPWR_NEUTRAL_PERCENT); }
 	else
 	{
 		; //add additional states if needed
@@ -32,9 +46,24 @@ void mcm_setAllSignals(uint8_t newState, uint16_t CMDPWR_percent)
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
+//LiBCM limits still apply
 void mcm_passUnmodifiedSignals_fromECM(void)
 {
 	mcm_setMAMODE1_state  (ecm_getMAMODE1_state()  );
 	mcm_setMAMODE2_state  (ecm_getMAMODE2_state()  );
-	mcm_setCMDPWR_percent (ecm_getCMDPWR_percent() );
-}
\ No newline at end of file
+	mcm_setCMDPWR_percent (mcm_applyLimits_CMDPWR_percent(ecm_getMAMODE1_state(), ecm_getCMDPWR_percent()) );
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//based on signals actually sent to MCM, so it's correct in every operating mode
+uint8_t mcm_getRegenStrength_percent(void)
+{
+	if(gpio_getMCM_MAMODE1_percent() != MAMODE1_STATE_IS_REGEN) { return 0; }
+
+	uint8_t CMDPWR_percent = gpio_getMCM_CMDPWR_percent();
+	if(CMDPWR_percent >= MCM_CMDPWR_NEUTRAL_PERCENT) { return 0; }
+	if(CMDPWR_percent <= 10) { return 100; }
+
+	return (uint8_t)(((uint16_t)(MCM_CMDPWR_NEUTRAL_PERCENT - CMDPWR_percent) * 100) / (MCM_CMDPWR_NEUTRAL_PERCENT - 10));
+}
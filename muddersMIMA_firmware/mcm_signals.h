@@ -9,6 +9,8 @@
 	#define MCM_MAMODE2_STATE_IS_ASSIST        0
 	#define MCM_MAMODE2_STATE_IS_REGEN_STANDBY 1
 
+	#define MCM_CMDPWR_NEUTRAL_PERCENT 50
+
 	void mcm_setMAMODE1_state(uint8_t newState);
 	void mcm_setMAMODE2_state(uint8_t newState);
 	void mcm_setCMDPWR_percent(uint8_t newPercent);
@@ -16,4 +18,6 @@
 	void mcm_setAllSignals(uint8_t newState, uint16_t CMDPWR_percent);
 	void mcm_passUnmodifiedSignals_fromECM(void);
 
+	uint8_t mcm_getRegenStrength_percent(void); //0: no regen //100: CMDPWR at 10% (strongest regen)
+
 #endif
\ No newline at end of file
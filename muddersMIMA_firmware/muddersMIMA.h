@@ -15,13 +15,19 @@
   //define standard libraries used by LiBCM
   #include <Arduino.h>
   #include <avr/wdt.h>
+  #include <util/crc16.h>
 
   //Define LiBCM system include files.  Note: Do not alter order.
   #include "config.h"
   #include "cpu_map.h"
+  #include "hal.h"
+  #include "eeprom.h"
+  #include "parameters.h"
+  #include "binaryTelemetry.h"
   #include "debugUSB.h"
   #include "gpio.h"
   #include "adc.h"
+  #include "joystickCalibration.h"
   #include "time.h"
   #include "USB_userInterface.h"
   #include "ecm_signals.h"
@@ -29,6 +35,13 @@
   #include "spiToLiBCM.h"
   #include "operatingModes.h"
   #include "brakeLights.h"
+  #include "brakeLightEffects.h"
   #include "engine_signals.h"
+  #include "flightRecorder.h"
+  #include "eventLog.h"
+  #include "latency.h"
+  #include "imageCheck.h"
+  #include "powerSave.h"
+  #include "benchmark.h"
 
 #endif
\ No newline at end of file
@@ -12,29 +12,45 @@
 	//3 : In the 'Tools' menu, select "Board:_________" -> "Arduino AVR Boards" -> "Arduino Nano"
 	//4a: In the 'Tools' menu, select "Port" -> <<your device's COM port>>
     //4b: If device not shown, install CH340 driver (learn.sparkfun.com/tutorials/how-to-install-ch340-drivers)
-	//5a: Push the momentary button down with your finger
+	//5a: Push the momentary button down with your finger (optional; only needed if upload doesn't start)
 	//5b: Keep holding this button down until the upload process completes
 	//6 : Click the upload button
 	//7 : Wait for the upload to complete
 	//8 : Release the momentary button
+	//Note: opening the serial port (upload, Serial Monitor, HostTools) resets LiControl, and the MCM outputs aren't driven for ~1 second
+	//      (the bootloader waits for an upload). Don't connect while the IMA is assisting or regenerating.
 
 void setup()  
 {
+	eventLog_begin(); //must run first, before anything else can log an event
+	imageCheck_begin();
+	parameters_begin();
+	joystickCal_begin();
 	gpio_begin();
 	engineSignals_begin();
   spiToLiBCM_begin();
 	Serial.begin(115200); //USB
-	Serial.print(F("\n\nWelcome to LiControl v" FW_VERSION ", " BUILD_DATE "\nType '$HELP' for more info\n"));
+	Serial.print(F("\n\nWelcome to LiControl v" FW_VERSION ", " BUILD_DATE "\nType '$HELP' for more info (including image CRC check)\n"));
+
+	#ifdef RUN_BENCHMARKS
+		benchmark_run(); //never returns
+	#endif
 }
 
 void loop()
 {
 	ecm_handler();
 	time_handler();
-	brakeLights_handler();
+	LiBCM_handler(); //must run before operatingModes_handler(), so LiBCM limits apply this loop
 	operatingModes_handler();
+	brakeLights_handler(); //must run after operatingModes_handler(), so brake lights follow this loop's regen request
+	flightRecorder_handler(); //must run after outputs are set
+	latency_handler();
+	imageCheck_handler(); //must run before eventLog_handler(), so a CRC mismatch is logged this loop
+	eventLog_handler();
+	parameters_handler();
+	joystickCal_handler();
 	USB_userInterface_handler();
-  LiBCM_handler();
 	
 	debugUSB_printLatestData();
 
@@ -4,20 +4,9 @@
 
 #include "muddersMIMA.h"
 
-uint8_t joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;
-bool useStoredJoystickValue = NO; //JTS2doLater: I'm not convinced this is required
-
-// Variables to track clutch state, release time, and ramp up
-bool clutchPressed = false;
-uint32_t clutchReleaseTime = 0;
-bool rampingUp = false;
-uint32_t rampStartTime = 0;
-bool derating = false;
-uint32_t derateStartTime = 0;
-
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-void mode_OEM(void)
+void mode_OEM::run(void)
 {
 	brakeLights_setControlMode(BRAKE_LIGHT_OEM); 
 	mcm_passUnmodifiedSignals_fromECM();
@@ -27,9 +16,9 @@ void mode_OEM(void)
 
 //PHEV mode
 //JTS2doNow: implement manual regen
-void mode_INWORK_manualRegen_autoAssist(void)
+void mode_INWORK_manualRegen_autoAssist::run(void)
 {
-	brakeLights_setControlMode(BRAKE_LIGHT_OEM);
+	brakeLights_setControlMode(BRAKE_LIGHT_BEHAVIOR);
 
 	if(ecm_getMAMODE1_state() == MAMODE1_STATE_IS_REGEN) { mcm_setAllSignals(MAMODE1_STATE_IS_IDLE, JOYSTICK_NEUTRAL_NOM_PERCENT); } //ignore regen request
 	else /* (ECM not requesting regen) */                { mcm_passUnmodifiedSignals_fromECM(); } //pass all other signals through
@@ -38,9 +27,9 @@ void mode_INWORK_manualRegen_autoAssist(void)
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 //LiControl completely ignores ECM signals (including autostop, autostart, prestart, etc)
-void mode_manualAssistRegen_ignoreECM(void)
+void mode_manualAssistRegen_ignoreECM::run(void)
 {
-	brakeLights_setControlMode(BRAKE_LIGHT_AUTOMATIC);
+	brakeLights_setControlMode(BRAKE_LIGHT_BEHAVIOR);
 
 	uint16_t joystick_percent = adc_readJoystick_percent();
 
@@ -53,9 +42,9 @@ void mode_manualAssistRegen_ignoreECM(void)
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-void mode_manualAssistRegen_withAutoStartStop(void)
+void mode_manualAssistRegen_withAutoStartStop::run(void)
 {
-	brakeLights_setControlMode(BRAKE_LIGHT_AUTOMATIC);
+	brakeLights_setControlMode(BRAKE_LIGHT_BEHAVIOR);
 
 	if( (ecm_getMAMODE1_state() == MAMODE1_STATE_IS_REGEN ) ||
 		(ecm_getMAMODE1_state() == MAMODE1_STATE_IS_IDLE  ) ||
@@ -69,25 +58,24 @@ void mode_manualAssistRegen_withAutoStartStop(void)
 		if(gpio_getButton_momentary() == BUTTON_PRESSED)
 		{
 			//store joystick value when button is pressed
-			joystick_percent_stored = joystick_percent;
-			useStoredJoystickValue = YES;
+			stored.percent = joystick_percent;
+			stored.isUsed = YES;
 		}
 
 		//disable stored joystick value if user is braking
 		//JTS2doLater: Add clutch disable
 		if(gpio_getBrakePosition_bool() == BRAKE_LIGHTS_ARE_ON)
 		{
-			useStoredJoystickValue = NO;
-			joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;
+			stored.clear();
 		} 
 
 		//use stored joystick value if conditions are right
-		if( (useStoredJoystickValue == YES                ) && //user previously pushed button
+		if( (stored.isUsed == YES                         ) && //user previously pushed button
 			(joystick_percent > JOYSTICK_NEUTRAL_MIN_PERCENT) && //joystick is neutral
 			(joystick_percent < JOYSTICK_NEUTRAL_MAX_PERCENT)  ) //joystick is neutral
 		{
 			//replace actual joystick position with previously stored value
-			joystick_percent = joystick_percent_stored;
+			joystick_percent = stored.percent;
 		}
 		
 		//send assist/idle/regen value to MCM
@@ -108,13 +96,13 @@ void mode_manualAssistRegen_withAutoStartStop(void)
 
 		//Therefore, we need to honor the ECM's PRESTART request for the first few seconds after keyON (so the HVDC bus voltage can charge to the pack voltage).
 
-		//JTS2doNow: if SoC too low (get from LiBCM), pass through unmodified signal (which will disable DCDC) 
-		if(millis() < (time_latestKeyOn_ms() + PERIOD_AFTER_KEYON_WHERE_PRESTART_ALLOWED_ms)) { mcm_passUnmodifiedSignals_fromECM(); } //key hasn't been on long enough
+		//If SoC is too low (per LiBCM), we also pass through unmodified signal (which will disable DCDC)
+		if     (millis() < (time_latestKeyOn_ms() + PERIOD_AFTER_KEYON_WHERE_PRESTART_ALLOWED_ms)) { mcm_passUnmodifiedSignals_fromECM(); } //key hasn't been on long enough
+		else if(LiBCM_isSoC_tooLowToEnableDCDC() == true)                                            { mcm_passUnmodifiedSignals_fromECM(); } //protect pack
 		else { mcm_setAllSignals(MAMODE1_STATE_IS_AUTOSTOP, JOYSTICK_NEUTRAL_NOM_PERCENT); } //JTS2doLater: This prevents user from manually assist-starting IMA
 
 		//clear stored assist/idle/regen setpoint
-		joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;
-		useStoredJoystickValue = NO;
+		stored.clear();
 	}
 	else //ECM is sending autostop, start, or undefined signal
 	{
@@ -122,8 +110,7 @@ void mode_manualAssistRegen_withAutoStartStop(void)
 		mcm_passUnmodifiedSignals_fromECM();
 
 		//clear stored assist/idle/regen setpoint
-		joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;
-		useStoredJoystickValue = NO;
+		stored.clear();
 	}
 
 	//JTS2doLater: New feature: When the key is on and the engine is off, pushing momentary button starts engine.
@@ -143,9 +130,9 @@ void mode_manualAssistRegen_withAutoStartStop(void)
 	//manual joystick regen request always overrides ECM regen request
 //MAMODE1 prestart
 	//modified to always enable DCDC when key is on
-void mode_INWORK_PHEV_mudder(void)
+void mode_INWORK_PHEV_mudder::run(void)
 {
-	brakeLights_setControlMode(BRAKE_LIGHT_MONITOR_ONLY); //JTS2doLater: if possible, add strong regen brake lights
+	brakeLights_setControlMode(BRAKE_LIGHT_BEHAVIOR);
 
 	if( (ecm_getMAMODE1_state() == MAMODE1_STATE_IS_REGEN ) ||
 		(ecm_getMAMODE1_state() == MAMODE1_STATE_IS_IDLE  ) ||
@@ -161,16 +148,15 @@ void mode_INWORK_PHEV_mudder(void)
 		if(gpio_getButton_momentary() == BUTTON_PRESSED)
 		{
 			//store joystick value when button is pressed
-			joystick_percent_stored = joystick_percent;
-			useStoredJoystickValue = YES;
+			stored.percent = joystick_percent;
+			stored.isUsed = YES;
 		}
 
 		//disable stored joystick value if user is braking
 		//JTS2doLater: Add clutch disable
 		if(gpio_getBrakePosition_bool() == BRAKE_LIGHTS_ARE_ON)
 		{
-			useStoredJoystickValue = NO;
-			joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;	
+			stored.clear();	
 		} 
 
 		//Use ECM regen request when user is braking AND joystick is neutral
@@ -183,12 +169,12 @@ void mode_INWORK_PHEV_mudder(void)
 		}
 
 		//use stored joystick value if conditions are right
-		if( (useStoredJoystickValue == YES                  ) && //user previously pushed button
+		if( (stored.isUsed == YES                           ) && //user previously pushed button
 			(joystick_percent > JOYSTICK_NEUTRAL_MIN_PERCENT) && //joystick is neutral
 			(joystick_percent < JOYSTICK_NEUTRAL_MAX_PERCENT)  ) //joystick is neutral
 		{
 			//replace actual joystick position with previously stored value
-			joystick_percent = joystick_percent_stored;
+			joystick_percent = stored.percent;
 		}
 		
 		//send assist/idle/regen value to MCM
@@ -209,13 +195,13 @@ void mode_INWORK_PHEV_mudder(void)
 
 		//Therefore, we need to honor the ECM's PRESTART request for the first few seconds after keyON (so the HVDC bus voltage can charge to the pack voltage).
 
-		//JTS2doNow: if SoC too low (get from LiBCM), pass through unmodified signal (which will disable DCDC) 
-		if(millis() < (time_latestKeyOn_ms() + PERIOD_AFTER_KEYON_WHERE_PRESTART_ALLOWED_ms)) { mcm_passUnmodifiedSignals_fromECM(); } //key hasn't been on long enough
+		//If SoC is too low (per LiBCM), we also pass through unmodified signal (which will disable DCDC)
+		if     (millis() < (time_latestKeyOn_ms() + PERIOD_AFTER_KEYON_WHERE_PRESTART_ALLOWED_ms)) { mcm_passUnmodifiedSignals_fromECM(); } //key hasn't been on long enough
+		else if(LiBCM_isSoC_tooLowToEnableDCDC() == true)                                            { mcm_passUnmodifiedSignals_fromECM(); } //protect pack
 		else { mcm_setAllSignals(MAMODE1_STATE_IS_AUTOSTOP, JOYSTICK_NEUTRAL_NOM_PERCENT); } //JTS2doLater: This prevents user from manually assist-starting IMA
 
 		//clear stored assist/idle/regen setpoint
-		joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;
-		useStoredJoystickValue = NO;
+		stored.clear();
 	}
 	else //ECM is sending autostop, start, or undefined signal
 	{
@@ -223,8 +209,7 @@ void mode_INWORK_PHEV_mudder(void)
 		mcm_passUnmodifiedSignals_fromECM();
 
 		//clear stored assist/idle/regen setpoint
-		joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;
-		useStoredJoystickValue = NO;
+		stored.clear();
 	}
 
 	//JTS2doLater: New feature: When the key is on and the engine is off, pushing momentary button starts engine.
@@ -233,9 +218,9 @@ void mode_INWORK_PHEV_mudder(void)
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 //Heavily based on Mudders code above. Added a max RPM to prevent redline, derating logic under 2k RPM and ramp-up logic to smoothly transition between states. 
-void mode_INWORK_PHEV_AfterEffect(void)
+void mode_INWORK_PHEV_AfterEffect::run(void)
 {
-    brakeLights_setControlMode(BRAKE_LIGHT_MONITOR_ONLY);
+    brakeLights_setControlMode(BRAKE_LIGHT_BEHAVIOR);
 
     // Check if ECM is sending assist, idle, or regen signal
     if( (ecm_getMAMODE1_state() == MAMODE1_STATE_IS_REGEN ) ||
@@ -253,16 +238,16 @@ void mode_INWORK_PHEV_AfterEffect(void)
         // Handle clutch interaction
         if (gpio_getClutchPosition() == CLUTCH_PEDAL_PRESSED)
         {
-            clutchPressed = true;
-            clutchReleaseTime = millis();
+            isClutchDelayActive = true;
+            clutchReleased_ms = millis();
         }
-        else if (clutchPressed && (millis() - clutchReleaseTime > CLUTCH_DELAY))
+        else if (isClutchDelayActive && (millis() - clutchReleased_ms > param.clutchDelay_ms))
         {
-            clutchPressed = false;
+            isClutchDelayActive = false;
         }
 
         // Disable assist if clutch is pressed
-        if (clutchPressed)
+        if (isClutchDelayActive)
         {
             joystick_percent = JOYSTICK_NEUTRAL_NOM_PERCENT; // No assist when clutch is pressed
         }
@@ -270,22 +255,26 @@ void mode_INWORK_PHEV_AfterEffect(void)
         // Handle maximum RPM logic
         uint16_t currentRPM = engineSignals_getLatestRPM();
 
-        if (currentRPM >= MAX_RPM)
+        // Derated assist must stay above the neutral band ('$SET=JDEADBAND' can raise it above DERATEPCT's minimum)
+        uint8_t deratePercent = param.deratePercent;
+        if (deratePercent < JOYSTICK_NEUTRAL_MAX_PERCENT) { deratePercent = JOYSTICK_NEUTRAL_MAX_PERCENT; }
+
+        if (currentRPM >= param.maxRPM)
         {
             joystick_percent = JOYSTICK_NEUTRAL_NOM_PERCENT; // Disable assist at max RPM
         }
-        else if (currentRPM < (DERATE_UNDER_RPM - 100))
+        else if (currentRPM < (param.derateUnderRPM - 100))
         {
             // Remap only the assist range to DERATE_PERCENT, keep neutral and regen ranges intact
             if (joystick_percent > JOYSTICK_NEUTRAL_MAX_PERCENT)
             {
-                joystick_percent = map(joystick_percent, JOYSTICK_NEUTRAL_MAX_PERCENT, 100, JOYSTICK_NEUTRAL_MAX_PERCENT, DERATE_PERCENT);
+                joystick_percent = map(joystick_percent, JOYSTICK_NEUTRAL_MAX_PERCENT, 100, JOYSTICK_NEUTRAL_MAX_PERCENT, deratePercent);
             }
         } 
-        else if (currentRPM < DERATE_UNDER_RPM) 
+        else if (currentRPM < param.derateUnderRPM) 
         {
             // Scale DERATE_PERCENT from its value to 100% as currentRPM approaches DERATE_UNDER_RPM
-            int scaledPercent = map(currentRPM, DERATE_UNDER_RPM - 100, DERATE_UNDER_RPM, DERATE_PERCENT, 100);
+            int scaledPercent = map(currentRPM, param.derateUnderRPM - 100, param.derateUnderRPM, deratePercent, 100);
             if (joystick_percent > JOYSTICK_NEUTRAL_MAX_PERCENT)
             {
                 joystick_percent = map(joystick_percent, JOYSTICK_NEUTRAL_MAX_PERCENT, 100, JOYSTICK_NEUTRAL_MAX_PERCENT, scaledPercent);
@@ -326,43 +315,53 @@ void mode_INWORK_PHEV_AfterEffect(void)
     else if (ecm_getMAMODE1_state() == MAMODE1_STATE_IS_PRESTART)
     {
         // Handle prestart logic
-        if (millis() < (time_latestKeyOn_ms() + PERIOD_AFTER_KEYON_WHERE_PRESTART_ALLOWED_ms)) { 
+        if ( (millis() < (time_latestKeyOn_ms() + PERIOD_AFTER_KEYON_WHERE_PRESTART_ALLOWED_ms)) ||
+             (LiBCM_isSoC_tooLowToEnableDCDC() == true) ) { 
             mcm_passUnmodifiedSignals_fromECM(); 
         } else { 
             mcm_setAllSignals(MAMODE1_STATE_IS_AUTOSTOP, JOYSTICK_NEUTRAL_NOM_PERCENT); 
         }
-
-        // Clear stored joystick value
-        joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;
-        useStoredJoystickValue = NO;
     }
     else
     {
         // Pass through other signals unmodified
         mcm_passUnmodifiedSignals_fromECM();
-
-        // Clear stored joystick value
-        joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;
-        useStoredJoystickValue = NO;
     }
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//selected mode's begin() runs whenever toggle position or LiBCM mode changes (even if both map to the same mode)
+template<class Mode> void operatingModes_run(bool isModeChanged)
+{
+	Mode &mode = operatingMode<Mode>::instance;
+
+	if(isModeChanged == YES) { mode.begin(); }
+	mode.run();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
 void operatingModes_handler(void)
 {
 	uint8_t toggleState = gpio_getButton_toggle();
 	static uint8_t toggleState_previous = TOGGLE_UNDEFINED;
 
-	if(toggleState != toggleState_previous)
-	{
-		//clear previously stored joystick value (from the last time we were in manual mode)
-		joystick_percent_stored = JOYSTICK_NEUTRAL_NOM_PERCENT;
-		useStoredJoystickValue = NO;
-	}
+	uint8_t LiBCM_mode = LiBCM_getCommandedMode(); //MODE_NONE when LiBCM data is stale
+	static uint8_t LiBCM_mode_previous = MODE_NONE;
+
+	//e.g. clears previously stored joystick value (from the last time we were in manual mode)
+	bool isModeChanged = ( (toggleState != toggleState_previous) || (LiBCM_mode != LiBCM_mode_previous) );
 
-	if     (toggleState == TOGGLE_POSITION0) { MODE0_BEHAVIOR(); } //see #define substitutions in config.h
-	else if(toggleState == TOGGLE_POSITION1) { MODE1_BEHAVIOR(); }
-	else if(toggleState == TOGGLE_POSITION2) { MODE2_BEHAVIOR(); }
-	else /* hidden 'mode3' (unsupported) */  { MODE0_BEHAVIOR(); }
+	if     (LiBCM_mode == MODE_OEM         ) { operatingModes_run<LIBCM_MODE_OEM_BEHAVIOR         >(isModeChanged); } //LiBCM overrides toggle position
+	else if(LiBCM_mode == MODE_BLENDED     ) { operatingModes_run<LIBCM_MODE_BLENDED_BEHAVIOR     >(isModeChanged); }
+	else if(LiBCM_mode == MODE_MANUAL_REGEN) { operatingModes_run<LIBCM_MODE_MANUAL_REGEN_BEHAVIOR>(isModeChanged); }
+	else if(LiBCM_mode == MODE_OLD         ) { operatingModes_run<LIBCM_MODE_OLD_BEHAVIOR         >(isModeChanged); }
+	else if(toggleState == TOGGLE_POSITION0) { operatingModes_run<MODE0_BEHAVIOR>(isModeChanged); } //see #define substitutions in config.h
+	else if(toggleState == TOGGLE_POSITION1) { operatingModes_run<MODE1_BEHAVIOR>(isModeChanged); }
+	else if(toggleState == TOGGLE_POSITION2) { operatingModes_run<MODE2_BEHAVIOR>(isModeChanged); }
+	else /* hidden 'mode3' (unsupported) */  { operatingModes_run<MODE0_BEHAVIOR>(isModeChanged); }
 
 	toggleState_previous = toggleState;
+	LiBCM_mode_previous = LiBCM_mode;
 }
\ No newline at end of file
@@ -4,6 +4,76 @@
 #ifndef modes_h
 	#define modes_h
 
+	//Each mode is a class: run() sets all MCM signals (once per loop), and begin() runs whenever the mode is (re)selected.
+	//State only one mode needs is a member of that mode's class.
+	//config.h maps toggle positions & LiBCM modes to these classes, and only mapped classes are instantiated (see operatingMode<>),
+	//so unmapped modes use no RAM (and the linker discards their code).
+
+	//momentary button stores joystick position, which replaces neutral joystick until user brakes or changes modes
+	struct storedJoystick
+	{
+		uint8_t percent;
+		bool isUsed; //JTS2doLater: I'm not convinced this is required
+
+		void clear(void) { percent = JOYSTICK_NEUTRAL_NOM_PERCENT; isUsed = NO; }
+	};
+
+	class mode_OEM
+	{
+		public:
+			void begin(void) { ; }
+			void run(void);
+	};
+
+	class mode_INWORK_manualRegen_autoAssist
+	{
+		public:
+			void begin(void) { ; }
+			void run(void);
+	};
+
+	class mode_manualAssistRegen_ignoreECM
+	{
+		public:
+			void begin(void) { ; }
+			void run(void);
+	};
+
+	class mode_manualAssistRegen_withAutoStartStop
+	{
+		public:
+			void begin(void) { stored.clear(); }
+			void run(void);
+
+		private:
+			storedJoystick stored;
+	};
+
+	class mode_INWORK_PHEV_mudder
+	{
+		public:
+			void begin(void) { stored.clear(); }
+			void run(void);
+
+		private:
+			storedJoystick stored;
+	};
+
+	class mode_INWORK_PHEV_AfterEffect
+	{
+		public:
+			void begin(void) { ; } //clutch delay continues across mode changes
+			void run(void);
+
+		private:
+			bool     isClutchDelayActive; //assist disabled until CLUTCHDLY after clutch release
+			uint32_t clutchReleased_ms;
+	};
+
+	//one instance per mapped mode (shared if config.h maps the same mode more than once)
+	template<class Mode> struct operatingMode { static Mode instance; };
+	template<class Mode> Mode operatingMode<Mode>::instance;
+
 	void operatingModes_handler(void);
 
-#endif
\ No newline at end of file
+#endif
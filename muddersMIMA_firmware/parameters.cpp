@@ -0,0 +1,248 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Parameters live in RAM (so control code reads them with a single load).
+//'$SAVE' writes them to EEPROM (in the background), where they're reloaded at boot.
+
+#include "muddersMIMA.h"
+
+//EEPROM image: [version][numBytes][parameterValues][CRC16]
+struct __attribute__((packed)) parameterImage
+{
+	uint8_t version;
+	uint8_t numBytes;
+	parameterValues values;
+	uint16_t crc;
+};
+
+parameterValues param; //changed by '$SET'
+
+parameterImage storedImage; //copy of param written by '$SAVE' (so '$SET' can't corrupt an in-progress EEPROM write)
+
+const parameterInfo parameterTable[] PROGMEM = {
+	//name         units  offset                                                  numBytes  default                               min   max
+	{ "MAXRPM",    "rpm", offsetof(parameterValues, maxRPM),                             2, MAX_RPM_DEFAULT,                      1000, 8000 },
+	{ "CLUTCHDLY", "ms",  offsetof(parameterValues, clutchDelay_ms),                     2, CLUTCH_DELAY_DEFAULT_ms,                 0, 5000 },
+	{ "DERATERPM", "rpm", offsetof(parameterValues, derateUnderRPM),                     2, DERATE_UNDER_RPM_DEFAULT,              100, 5000 },
+	{ "DERATEPCT", "%",   offsetof(parameterValues, deratePercent),                      1, DERATE_PERCENT_DEFAULT, JOYSTICK_NEUTRAL_MAX_DEFAULT_PERCENT, 100 }, //below this is inside the neutral band
+	{ "RAMPUP",    "ms",  offsetof(parameterValues, rampUpDuration_ms),                  2, RAMP_UP_DURATION_DEFAULT_ms,             0, 5000 },
+	{ "JDEADBAND", "%",   offsetof(parameterValues, joystickDeadband_percent),           1, JOYSTICK_DEADBAND_DEFAULT_PERCENT,       1,   20 },
+	{ "BRAKEON",   "%",   offsetof(parameterValues, brakeLightsOnAboveRegen_percent),    1, BRAKE_LIGHTS_ON_ABOVE_REGEN_DEFAULT_PERCENT,  1,  100 },
+	{ "BRAKEOFF",  "%",   offsetof(parameterValues, brakeLightsOffBelowRegen_percent),   1, BRAKE_LIGHTS_OFF_BELOW_REGEN_DEFAULT_PERCENT, 0,  100 },
+	{ "BRAKEMIN",  "ms",  offsetof(parameterValues, brakeLightsMinOnTime_ms),            2, BRAKE_LIGHTS_MIN_ON_TIME_DEFAULT_ms,           0, 5000 },
+};
+
+#define NUM_PARAMETERS (sizeof(parameterTable) / sizeof(parameterTable[0]))
+
+bool isListingInProgress_parameters = NO;
+uint8_t listingIndex = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t parameters_getValue(const parameterInfo *info)
+{
+	const uint8_t *field = (const uint8_t *)&param + info->offset;
+
+	if(info->numBytes == 1) { return *field; }
+	else                    { return *(const uint16_t *)field; }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void parameters_setValue(const parameterInfo *info, uint16_t value)
+{
+	uint8_t *field = (uint8_t *)&param + info->offset;
+
+	if(info->numBytes == 1) { *field = (uint8_t)value; }
+	else                    { *(uint16_t *)field = value; }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t parameters_calculateCRC(const parameterImage *image)
+{
+	const uint8_t *imageBytes = (const uint8_t *)image;
+	uint16_t crc = 0xFFFF;
+
+	for(uint8_t ii = 0; ii < offsetof(parameterImage, crc); ii++) { crc = _crc_ccitt_update(crc, imageBytes[ii]); }
+
+	return crc;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//limits that depend on more than one parameter
+bool parameters_isBrakeHysteresisValid(void) { return (param.brakeLightsOffBelowRegen_percent < param.brakeLightsOnAboveRegen_percent); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void parameters_begin(void)
+{
+	parameterInfo info;
+
+	hal_eeprom_readBlock(&storedImage, EEPROM_ADDRESS_PARAMETERS, sizeof(storedImage));
+
+	bool isImageValid = ( (storedImage.version  == PARAMETERS_VERSION     ) &&
+	                      (storedImage.numBytes == sizeof(parameterValues)) &&
+	                      (storedImage.crc      == parameters_calculateCRC(&storedImage)) );
+
+	if(isImageValid == YES) { param = storedImage.values; }
+
+	//out of range values (e.g. limits changed without incrementing PARAMETERS_VERSION) revert to default
+	for(uint8_t ii = 0; ii < NUM_PARAMETERS; ii++)
+	{
+		memcpy_P(&info, &parameterTable[ii], sizeof(info));
+
+		uint16_t value = parameters_getValue(&info);
+
+		if( (isImageValid == NO) || (value < info.minValue) || (value > info.maxValue) ) { parameters_setValue(&info, info.defaultValue); }
+	}
+
+	//BRAKEOFF at or above BRAKEON removes the hysteresis (e.g. stored before this check existed) //BRAKEON's minimum is 1
+	if(parameters_isBrakeHysteresisValid() == NO) { param.brakeLightsOffBelowRegen_percent = param.brakeLightsOnAboveRegen_percent - 1; }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//returns NUM_PARAMETERS if not found
+//nameLength allows matching 'NAME' in 'NAME=___'
+uint8_t parameters_find(const uint8_t *name, uint8_t nameLength)
+{
+	if(nameLength > PARAMETER_NAME_MAX_LENGTH) { return NUM_PARAMETERS; }
+
+	for(uint8_t ii = 0; ii < NUM_PARAMETERS; ii++)
+	{
+		if( (strncmp_P((const char *)name, parameterTable[ii].name, nameLength) == 0) &&
+			(pgm_read_byte(&parameterTable[ii].name[nameLength]) == STRING_TERMINATION_CHARACTER) ) { return ii; }
+	}
+
+	return NUM_PARAMETERS;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void parameters_printOne(uint8_t index)
+{
+	parameterInfo info;
+	memcpy_P(&info, &parameterTable[index], sizeof(info));
+
+	debugUSB_recordAppend_char('\n');
+	debugUSB_recordAppend_string((const __FlashStringHelper *)parameterTable[index].name);
+	debugUSB_recordAppend_char('=');
+	debugUSB_recordAppend_uint(parameters_getValue(&info));
+	debugUSB_recordAppend_char(' ');
+	debugUSB_recordAppend_string((const __FlashStringHelper *)parameterTable[index].units);
+	debugUSB_recordAppend_string(F(" (range "));
+	debugUSB_recordAppend_uint(info.minValue);
+	debugUSB_recordAppend_string(F(" to "));
+	debugUSB_recordAppend_uint(info.maxValue);
+	debugUSB_recordAppend_string(F(", default "));
+	debugUSB_recordAppend_uint(info.defaultValue);
+	debugUSB_recordAppend_char(')');
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//'$GET' lists all parameters (a few each loop) //'$GET=NAME' prints one
+void parameters_get(const uint8_t *argument)
+{
+	if(argument == NULL)
+	{
+		listingIndex = 0;
+		isListingInProgress_parameters = YES;
+		debugUSB_recordAppend_string(F("\nParameters ('$SET=NAME=___' to change, '$SAVE' to keep after keyOFF):"));
+		return;
+	}
+
+	uint8_t index = parameters_find(argument, strlen((const char *)argument));
+
+	if(index >= NUM_PARAMETERS) { debugUSB_recordAppend_string(F("\nError: Unknown parameter")); }
+	else                        { parameters_printOne(index); }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//'$SET=NAME=___' //new value is used immediately, but is lost at keyOFF unless '$SAVE' is used
+void parameters_set(const uint8_t *argument)
+{
+	if(argument == NULL) { debugUSB_recordAppend_string(F("\nError: Use '$SET=NAME=___'")); return; }
+
+	const uint8_t *value = argument;
+	while( (*value != '=') && (*value != STRING_TERMINATION_CHARACTER) ) { value++; }
+	if(*value != '=') { debugUSB_recordAppend_string(F("\nError: Use '$SET=NAME=___'")); return; }
+
+	uint8_t index = parameters_find(argument, (uint8_t)(value - argument));
+	if(index >= NUM_PARAMETERS) { debugUSB_recordAppend_string(F("\nError: Unknown parameter")); return; }
+	value++; //skip '='
+
+	parameterInfo info;
+	memcpy_P(&info, &parameterTable[index], sizeof(info));
+
+	uint32_t newValue = 0;
+	uint8_t parseResult = USB_userInterface_parseUnsigned(value, info.minValue, info.maxValue, &newValue);
+
+	if     (parseResult == USER_PARSE_ERROR_NOT_A_NUMBER) { debugUSB_recordAppend_string(F("\nError: Not a number")); }
+	else if(parseResult == USER_PARSE_ERROR_OUT_OF_RANGE)
+	{
+		debugUSB_recordAppend_string(F("\nError: Valid range is "));
+		debugUSB_recordAppend_uint(info.minValue);
+		debugUSB_recordAppend_string(F(" to "));
+		debugUSB_recordAppend_uint(info.maxValue);
+	}
+	else
+	{
+		uint16_t previousValue = parameters_getValue(&info);
+		parameters_setValue(&info, (uint16_t)newValue);
+
+		if(parameters_isBrakeHysteresisValid() == NO)
+		{
+			parameters_setValue(&info, previousValue);
+			debugUSB_recordAppend_string(F("\nError: BRAKEOFF must be less than BRAKEON"));
+			return;
+		}
+
+		parameters_printOne(index);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+//EEPROM is written in the background (~3.3 ms per changed byte)
+void parameters_save(void)
+{
+	if(eeprom_isBlockPending(&storedImage) == true) { debugUSB_recordAppend_string(F("\nError: Previous '$SAVE' still in progress")); return; }
+
+	storedImage.version = PARAMETERS_VERSION;
+	storedImage.numBytes = sizeof(parameterValues);
+	storedImage.values = param;
+	storedImage.crc = parameters_calculateCRC(&storedImage);
+
+	if(eeprom_writeBlock_deferred(EEPROM_ADDRESS_PARAMETERS, &storedImage, sizeof(storedImage)) == false)
+	{
+		debugUSB_recordAppend_string(F("\nError: EEPROM busy. Try again"));
+		return;
+	}
+
+	debugUSB_recordAppend_string(F("\nParameters saved"));
+	brakeLights_flash(PARAMETERS_SAVED_BRAKE_FLASHES);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void parameters_handler(void)
+{
+	if(isListingInProgress_parameters == NO) { return; }
+
+	uint8_t numAllowed = PARAMETERS_MAX_PER_LOOP;
+
+	while( (numAllowed > 0) && (debugUSB_txRing_bytesFree() >= PARAMETERS_MIN_TX_SPACE_BYTES) )
+	{
+		if(listingIndex >= NUM_PARAMETERS) { isListingInProgress_parameters = NO; return; }
+
+		debugUSB_recordStart();
+		parameters_printOne(listingIndex++);
+		debugUSB_recordCommit();
+
+		numAllowed--;
+	}
+}
@@ -0,0 +1,59 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//runtime tunable parameters ('$GET', '$SET', '$SAVE')
+//default values are in config.h
+
+#ifndef parameters_h
+	#define parameters_h
+
+	#define PARAMETERS_VERSION 2 //increment whenever parameterValues changes (stored values are then ignored)
+
+	#define PARAMETER_NAME_MAX_LENGTH  9
+	#define PARAMETER_UNITS_MAX_LENGTH 3
+
+	#define PARAMETERS_MAX_PER_LOOP     2 //'$GET' listing
+	#define PARAMETERS_MIN_TX_SPACE_BYTES 64 //longest listing line, plus margin
+
+	#define PARAMETERS_SAVED_BRAKE_FLASHES 2 //'$SAVE' flashes brake lights to confirm the save
+
+	//code reads these directly (e.g. 'param.maxRPM')
+	//add new parameters to the end, and also to parameterInfo[]
+	struct __attribute__((packed)) parameterValues
+	{
+		uint16_t maxRPM;
+		uint16_t clutchDelay_ms;
+		uint16_t derateUnderRPM;
+		uint8_t  deratePercent;
+		uint16_t rampUpDuration_ms;
+		uint8_t  joystickDeadband_percent;
+		uint8_t  brakeLightsOnAboveRegen_percent;
+		uint8_t  brakeLightsOffBelowRegen_percent;
+		uint16_t brakeLightsMinOnTime_ms;
+	};
+
+	extern parameterValues param;
+
+	//describes each parameterValues field
+	struct parameterInfo
+	{
+		char     name[PARAMETER_NAME_MAX_LENGTH + 1];
+		char     units[PARAMETER_UNITS_MAX_LENGTH + 1];
+		uint8_t  offset; //offsetof(parameterValues, ___)
+		uint8_t  numBytes;
+		uint16_t defaultValue;
+		uint16_t minValue;
+		uint16_t maxValue;
+	};
+
+	//loads stored values (or defaults, if EEPROM is blank/corrupt/older version)
+	void parameters_begin(void);
+
+	void parameters_handler(void); //call once per loop
+
+	//argument is text after '$GET=' or '$SET=' (NULL if none)
+	void parameters_get(const uint8_t *argument);
+	void parameters_set(const uint8_t *argument);
+	void parameters_save(void);
+
+#endif
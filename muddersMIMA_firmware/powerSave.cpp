@@ -0,0 +1,77 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//Sleep is only allowed once everything queued has been sent over USB and written to EEPROM.
+//MAMODE1's RC filtered voltage at keyON (e.g. 15% during prestart) doesn't cross the pin's logic threshold, so a pin change can't be relied on.
+//Instead, the watchdog wakes LiControl just long enough to read the ECM signals (~0.4 ms, plus ~1 ms crystal startup, every 16 ms).
+
+#include "muddersMIMA.h"
+
+bool isSleeping = NO; //YES from the sleep message until LiControl wakes
+uint32_t stayAwake_start_ms = 0;
+uint32_t stayAwake_duration_ms = POWERSAVE_USB_HOLDOFF_ms; //a laptop might be connected at boot
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void powerSave_stayAwake(uint32_t duration_ms)
+{
+	stayAwake_start_ms = millis();
+	stayAwake_duration_ms = duration_ms;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void powerSave_usbActivity(void) { powerSave_stayAwake(POWERSAVE_USB_HOLDOFF_ms); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+bool powerSave_isSleepAllowed(void)
+{
+	if(time_keyOffDuration_ms() < POWERSAVE_KEYOFF_DELAY_ms)            { return NO; }
+	if((millis() - stayAwake_start_ms) < stayAwake_duration_ms)         { return NO; }
+	if(debugUSB_txRing_bytesFree() < (DEBUGUSB_TX_RING_SIZE_BYTES - 1)) { return NO; } //not sent yet
+	if(debugUSB_isLongFlashStringPending() == YES)                      { return NO; }
+	if( (eventLog_isIdle() == NO) || (eeprom_isIdle() == NO) )          { return NO; } //power-down would stop an EEPROM write
+
+	return YES;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+void powerSave_handler(void)
+{
+	#ifdef POWER_DOWN_AT_KEYOFF
+		if(powerSave_isSleepAllowed() == NO) { return; }
+
+		if(isSleeping == NO)
+		{
+			isSleeping = YES;
+			debugUSB_recordStart();
+			debugUSB_recordAppend_string(F("\nKey OFF: LiControl sleeping until keyON (press 'Enter' to wake)"));
+			debugUSB_recordCommit();
+			return; //sleep once this message is sent
+		}
+
+		//safe state for an unpowered MCM
+		gpio_setMCM_CMDPWR_percent(0);
+		gpio_setMCM_MAMODE1_percent(0);
+		gpio_setMCM_MAMODE2_bool(LOW);
+		gpio_brakeLights_floatPin();
+
+		Serial.flush(); //the UART stops while asleep
+
+		while(hal_powerDown_untilPinChange() == NO)
+		{
+			//watchdog
+			ecm_handler();
+			time_handler();
+			if(time_keyOffDuration_ms() == 0) { break; } //keyON
+		}
+
+		isSleeping = NO;
+		powerSave_stayAwake(POWERSAVE_KEYOFF_DELAY_ms); //if key is still off: e.g. button pressed, or user about to type
+		debugUSB_recordStart();
+		debugUSB_recordAppend_string(F("\nLiControl awake"));
+		debugUSB_recordCommit();
+	#endif
+}
@@ -0,0 +1,22 @@
+//Copyright 2022-2023(c) John Sullivan
+
+
+//key-off power-down (see POWER_DOWN_AT_KEYOFF in config.h)
+//once the key has been off for a while, LiControl sleeps until keyON, instead of sampling & printing every loop
+//the MCM is unpowered at keyOFF, so MCM outputs are driven low (and the brake light pin floats) while asleep
+
+#ifndef powerSave_h
+	#define powerSave_h
+
+	#define POWERSAVE_KEYOFF_DELAY_ms 10000 //key must be off this long //much longer than EVENTLOG_MAMODE1_GLITCH_ms
+	#define POWERSAVE_USB_HOLDOFF_ms  60000 //stays awake this long after each character typed (and after boot)
+
+	//sleeps at the end of time_waitForLoopPeriod(), so the next loop starts as soon as LiControl wakes
+	//keyON is seen at the next watchdog poll once MAMODE1's RC filter settles (~9 ms), so LiControl wakes 9 to 25 ms after keyON (plus ~1 ms crystal startup)
+	//(see ../HostTools/imaSimulator/scenarios/keyOffSleep.txt) //the MCM ignores its inputs for its first ~500 ms
+	//the first character typed only wakes LiControl (it's lost), so press 'Enter' first
+	void powerSave_handler(void);
+
+	void powerSave_usbActivity(void); //call whenever a character is received
+
+#endif
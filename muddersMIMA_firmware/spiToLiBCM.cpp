@@ -6,15 +6,26 @@
 
 ////////////////////////////////////////////////////////////////////////////////////
 
-enum Mode {
-    MODE_NONE,
-    MODE_OEM,
-    MODE_BLENDED,
-    MODE_MANUAL_REGEN,
-    MODE_OLD
-};
+//written by SPI & chip select ISRs
+volatile uint8_t frame_fromISR[LIBCM_FRAME_LENGTH_BYTES];
+volatile uint8_t frameBytesReceived = 0;
+volatile bool    isNewFrameAvailable = NO;
+volatile uint8_t transactionBytesReceived = 0; //since CS was asserted (saturates)
+volatile uint8_t firstByteInTransaction = 0;
+volatile uint8_t legacyMode_fromISR = MODE_NONE;
+volatile bool    isNewLegacyModeAvailable = NO;
 
-Mode receivedMode = MODE_NONE;
+//validated LiBCM data (only used by main loop)
+Mode    receivedMode = MODE_NONE;
+uint8_t assistLimit_percent = LIBCM_LIMIT_NONE_PERCENT;
+uint8_t regenLimit_percent  = LIBCM_LIMIT_NONE_PERCENT;
+uint8_t stateOfCharge_percent = LIBCM_SOC_UNKNOWN;
+uint32_t latestValidMessage_ms = 0;
+bool isLiBCM_dataFresh = NO;
+bool isLatestMessageFrame = NO; //legacy bytes are ignored until frames go stale
+uint16_t numBadFrames = 0; //checksum or range error
+
+////////////////////////////////////////////////////////////////////////////////////
 
 void spiToLiBCM_begin() {
   // Configure SPI pins
@@ -23,44 +34,203 @@ void spiToLiBCM_begin() {
     pinMode(PIN_SPI_SCK, INPUT);
     pinMode(PIN_SPI_CS, INPUT);  // CS is handled by the master
 
-    // Enable SPI in Slave mode
-    SPCR = (1 << SPE);
+    hal_spiSlave_begin();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+//LiBCM can send bytes faster than the main loop runs, so frames are assembled here
+ISR(SPI_STC_vect)
+{
+    uint8_t receivedData = hal_spiSlave_getReceivedByte();
+
+    if(transactionBytesReceived == 0) { firstByteInTransaction = receivedData; }
+    if(transactionBytesReceived < 0xFF) { transactionBytesReceived++; }
+
+    if(frameBytesReceived == 0)
+    {
+        if(receivedData == LIBCM_FRAME_SYNC) { frame_fromISR[frameBytesReceived++] = receivedData; } //start of new frame
+        //else { ; } //legacy byte (checked when CS deasserts), or not a valid message... wait for next sync byte
+    }
+    else
+    {
+        frame_fromISR[frameBytesReceived++] = receivedData;
+
+        if(frameBytesReceived >= LIBCM_FRAME_LENGTH_BYTES)
+        {
+            isNewFrameAvailable = YES; //main loop checks checksum
+            frameBytesReceived = 0;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+//called from PCINT0_vect only when PIN_SPI_CS changes level (PIN_NEP edges also cause PCINT0_vect, but don't call this)
+//a partial frame is discarded, so a lost byte can't shift the next transaction's bytes into frame fields
+//a legacy mode byte must be the only byte in its transaction (so a frame's mode or limit byte is never mistaken for one)
+void spiToLiBCM_chipSelectChanged(void)
+{
+    if( (hal_spiSlave_isChipSelected() == NO) && (transactionBytesReceived == 1) && (firstByteInTransaction <= MODE_OLD) )
+    {
+        legacyMode_fromISR = firstByteInTransaction;
+        isNewLegacyModeAvailable = YES;
+    }
+
+    frameBytesReceived = 0;
+    transactionBytesReceived = 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////////
+
 void handleReceivedMode(Mode mode) {
-    Serial.print("Received Mode: ");
+    debugUSB_recordStart();
+    debugUSB_recordAppend_string(F("\nReceived Mode: "));
     switch (mode) {
         case MODE_NONE:
-            Serial.println("MODE_NONE");
+            debugUSB_recordAppend_string(F("MODE_NONE"));
             break;
         case MODE_OEM:
-            Serial.println("MODE_OEM");
+            debugUSB_recordAppend_string(F("MODE_OEM"));
             break;
         case MODE_BLENDED:
-            Serial.println("MODE_BLENDED");
+            debugUSB_recordAppend_string(F("MODE_BLENDED"));
             break;
         case MODE_MANUAL_REGEN:
-            Serial.println("MODE_MANUAL_REGEN");
+            debugUSB_recordAppend_string(F("MODE_MANUAL_REGEN"));
             break;
         case MODE_OLD:
-            Serial.println("MODE_OLD");
+            debugUSB_recordAppend_string(F("MODE_OLD"));
             break;
         default:
-            Serial.println("Unknown Mode");
+            debugUSB_recordAppend_string(F("Unknown Mode"));
             break;
     }
+    debugUSB_recordCommit();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+//returns true if frame is valid
+bool LiBCM_validateFrame(const uint8_t *frame)
+{
+    uint8_t checksum = 0;
+
+    for(uint8_t ii = 1; ii < LIBCM_FRAME_LENGTH_BYTES; ii++) { checksum += frame[ii]; } //includes checksum byte
+
+    if(checksum != 0)                               { return false; } //corrupted frame
+    if(frame[1] > MODE_OLD)                         { return false; } //unknown mode
+    if(frame[2] > 100)                              { return false; } //assist limit out of range
+    if(frame[3] > 100)                              { return false; } //regen  limit out of range
+    if( (frame[4] > 100) && (frame[4] != LIBCM_SOC_UNKNOWN) ) { return false; } //SoC out of range
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+void LiBCM_restoreDefaults(void)
+{
+    receivedMode = MODE_NONE;
+    assistLimit_percent = LIBCM_LIMIT_NONE_PERCENT;
+    regenLimit_percent  = LIBCM_LIMIT_NONE_PERCENT;
+    stateOfCharge_percent = LIBCM_SOC_UNKNOWN;
 }
 
+////////////////////////////////////////////////////////////////////////////////////
+
 void LiBCM_handler() {
-    // Wait for reception complete (SPIF flag set)
-    if (SPSR & (1 << SPIF)) {
-        // Read received data from SPI Data Register
-        uint8_t receivedData = SPDR;
+    uint8_t frame[LIBCM_FRAME_LENGTH_BYTES];
+    bool isFrameNew = NO;
+    bool isLegacyModeNew = NO;
+    uint8_t legacyMode = MODE_NONE;
+    Mode previousMode = receivedMode;
+
+    //copy data from ISR
+    cli();
+    if(isNewFrameAvailable == YES)
+    {
+        for(uint8_t ii = 0; ii < LIBCM_FRAME_LENGTH_BYTES; ii++) { frame[ii] = frame_fromISR[ii]; }
+        isNewFrameAvailable = NO;
+        isFrameNew = YES;
+    }
+    if(isNewLegacyModeAvailable == YES)
+    {
+        legacyMode = legacyMode_fromISR;
+        isNewLegacyModeAvailable = NO;
+        isLegacyModeNew = YES;
+    }
+    sei();
+
+    bool isFrameValid = NO;
+    if(isFrameNew == YES)
+    {
+        isFrameValid = LiBCM_validateFrame(frame);
+        if(isFrameValid == NO) { numBadFrames++; } //logged by eventLog_handler()
+    }
+
+    if(isFrameValid == YES)
+    {
+        receivedMode          = static_cast<Mode>(frame[1]);
+        assistLimit_percent   = frame[2];
+        regenLimit_percent    = frame[3];
+        stateOfCharge_percent = frame[4];
+        latestValidMessage_ms = millis();
+        isLiBCM_dataFresh = YES;
+        isLatestMessageFrame = YES;
+    }
+    else if( (isLegacyModeNew == YES) && ((isLiBCM_dataFresh == NO) || (isLatestMessageFrame == NO)) )
+    {
+        //legacy message only contains mode
+        LiBCM_restoreDefaults();
+        receivedMode = static_cast<Mode>(legacyMode);
+        latestValidMessage_ms = millis();
+        isLiBCM_dataFresh = YES;
+        isLatestMessageFrame = NO;
+    }
+
+    if( (isLiBCM_dataFresh == YES) && ((millis() - latestValidMessage_ms) > LIBCM_MESSAGE_TIMEOUT_ms) )
+    {
+        //LiBCM stopped sending data
+        LiBCM_restoreDefaults();
+        isLiBCM_dataFresh = NO;
+    }
 
-        // Cast received data to Mode enum
-        receivedMode = static_cast<Mode>(receivedData);
+    if(receivedMode != previousMode) { handleReceivedMode(receivedMode); }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t LiBCM_getCommandedMode(void)      { return receivedMode;          }
+uint8_t LiBCM_getAssistLimit_percent(void) { return assistLimit_percent;   }
+uint8_t LiBCM_getRegenLimit_percent(void)  { return regenLimit_percent;    }
+uint8_t LiBCM_getSoC_percent(void)         { return stateOfCharge_percent; }
+uint16_t LiBCM_getNumBadFrames(void)       { return numBadFrames;          }
+
+////////////////////////////////////////////////////////////////////////////////////
+
+bool LiBCM_isSoC_tooLowToEnableDCDC(void)
+{
+    if(stateOfCharge_percent == LIBCM_SOC_UNKNOWN) { return false; } //no data from LiBCM
 
-        // Handle received mode
-        handleReceivedMode(receivedMode);
+    return (stateOfCharge_percent < LIBCM_SOC_MIN_FOR_DCDC_ENABLE_PERCENT);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+//scale assist/regen magnitude (i.e. distance from neutral) by LiBCM's limits
+uint8_t LiBCM_limitCMDPWR_percent(uint8_t CMDPWR_percent)
+{
+    if(CMDPWR_percent > MCM_CMDPWR_NEUTRAL_PERCENT)
+    {
+        uint16_t assistMagnitude = CMDPWR_percent - MCM_CMDPWR_NEUTRAL_PERCENT;
+        CMDPWR_percent = MCM_CMDPWR_NEUTRAL_PERCENT + (uint8_t)((assistMagnitude * assistLimit_percent) / 100);
     }
-}
\ No newline at end of file
+    else if(CMDPWR_percent < MCM_CMDPWR_NEUTRAL_PERCENT)
+    {
+        uint16_t regenMagnitude = MCM_CMDPWR_NEUTRAL_PERCENT - CMDPWR_percent;
+        CMDPWR_percent = MCM_CMDPWR_NEUTRAL_PERCENT - (uint8_t)((regenMagnitude * regenLimit_percent) / 100);
+    }
+
+    return CMDPWR_percent;
+}
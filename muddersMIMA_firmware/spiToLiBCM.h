@@ -1,8 +1,43 @@
 #ifndef spiToLiBCM_h
 #define spiToLiBCM_h
 
-void spiToLiBCM_begin(void);
+    //LiBCM can send either a single legacy mode byte (MODE_NONE:MODE_OLD), or a complete frame:
+    //[LIBCM_FRAME_SYNC][mode][maxAssist_percent][maxRegen_percent][SoC_percent][checksum]
+    //checksum is chosen so that the sum of all bytes after LIBCM_FRAME_SYNC equals zero
+    //a legacy byte is only accepted if it's the only byte sent while CS is low, and only if no valid frame arrived in the last LIBCM_MESSAGE_TIMEOUT_ms
+    #define LIBCM_FRAME_SYNC         0xA5
+    #define LIBCM_FRAME_LENGTH_BYTES 6
 
-void LiBCM_handler(void);
+    #define LIBCM_MESSAGE_TIMEOUT_ms 500 //revert to toggle position and remove limits if LiBCM stops sending data
+
+    #define LIBCM_LIMIT_NONE_PERCENT 100 //assist/regen cap when LiBCM hasn't sent a limit
+
+    //below this SoC, LiControl honors the ECM's PRESTART request (which disables DCDC)
+    #define LIBCM_SOC_MIN_FOR_DCDC_ENABLE_PERCENT 20
+    #define LIBCM_SOC_UNKNOWN 255
+
+    enum Mode {
+        MODE_NONE,
+        MODE_OEM,
+        MODE_BLENDED,
+        MODE_MANUAL_REGEN,
+        MODE_OLD
+    };
+
+    void spiToLiBCM_begin(void);
+    void spiToLiBCM_chipSelectChanged(void); //call from PCINT0_vect, only when PIN_SPI_CS level changed
+
+    void LiBCM_handler(void);
+
+    //all getters return the default (unlimited) values when LiBCM data is stale
+    uint8_t LiBCM_getCommandedMode(void);
+    uint8_t LiBCM_getAssistLimit_percent(void);
+    uint8_t LiBCM_getRegenLimit_percent(void);
+    uint8_t LiBCM_getSoC_percent(void);
+    bool    LiBCM_isSoC_tooLowToEnableDCDC(void);
+
+    uint16_t LiBCM_getNumBadFrames(void); //total since boot (rolls over)
+
+    uint8_t LiBCM_limitCMDPWR_percent(uint8_t CMDPWR_percent);
 
 #endif
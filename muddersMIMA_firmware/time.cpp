@@ -6,8 +6,11 @@
 #include "muddersMIMA.h"
 
 uint8_t loopPeriod_ms = 10;
+uint16_t loopExecutionTime_us = 0; //time spent in loop() before waiting, during previous loop
 
 uint32_t lastTimeMAMODE1_wasInvalid = 0;
+uint32_t lastTimeMAMODE1_wasValid = 0;
+bool isKeyOff = YES;
 
 ////////////////////////////////////////////////////////////////////////////////////
 
@@ -16,13 +19,30 @@ uint8_t time_loopPeriod_ms_get(void) { return loopPeriod_ms; }
 
 ////////////////////////////////////////////////////////////////////////////////////
 
+uint16_t time_loopExecution_us_get(void) { return loopExecutionTime_us; }
+
+////////////////////////////////////////////////////////////////////////////////////
+
 void time_waitForLoopPeriod(void)
 {
     static uint32_t timestamp_previousLoopStart_ms = millis();
+    static uint32_t timestamp_previousLoopStart_us = micros();
+
+    uint32_t loopExecutionTime_us_32b = micros() - timestamp_previousLoopStart_us;
+    if(loopExecutionTime_us_32b > 0xFFFF) { loopExecutionTime_us = 0xFFFF; }
+    else                                  { loopExecutionTime_us = (uint16_t)loopExecutionTime_us_32b; }
+
+    while( (millis() - timestamp_previousLoopStart_ms ) < time_loopPeriod_ms_get() )
+    {
+        debugUSB_txHandler(); //keep serial buffer full while waiting to start next loop
+        eeprom_handler();     //EEPROM writes only start here, so they never delay loop()
+        hal_idle();
+    }
 
-    while( (millis() - timestamp_previousLoopStart_ms ) < time_loopPeriod_ms_get() ) { ; } //wait here to start next loop
+    powerSave_handler(); //might sleep until keyON, so it runs before the next loop's timestamp is stored
 
     timestamp_previousLoopStart_ms = millis(); //placed at end to prevent delay at keyON event
+    timestamp_previousLoopStart_us = micros();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////
@@ -38,9 +58,11 @@ void time_stopwatch(bool timerAction)
     else
     {
         uint32_t stopTime = millis();
-        Serial.print(F("\nDelta: "));
-        Serial.print(stopTime - startTime);
-        Serial.print(F(" ms\n"));
+        debugUSB_recordStart();
+        debugUSB_recordAppend_string(F("\nDelta: "));
+        debugUSB_recordAppend_uint(stopTime - startTime);
+        debugUSB_recordAppend_string(F(" ms\n"));
+        debugUSB_recordCommit();
     }
 }
 
@@ -62,6 +84,15 @@ uint32_t time_latestKeyOn_ms(void) { return lastTimeMAMODE1_wasInvalid; }
 
 ////////////////////////////////////////////////////////////////////////////////////
 
+uint32_t time_keyOffDuration_ms(void)
+{
+    if(isKeyOff == NO) { return 0; }
+
+    return millis() - lastTimeMAMODE1_wasValid;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
 void time_handler(void)
 {
     //LiControl can't directly read when the key turns on.
@@ -72,5 +103,6 @@ void time_handler(void)
     //Specifically, continuously store the last time the data WASN'T valid, which is immediately before the key turned on.
     if( (ecm_getMAMODE1_state() == MAMODE1_STATE_IS_ERROR_LO ) ||
         (ecm_getMAMODE1_state() == MAMODE1_STATE_IS_ERROR_HI ) ||
-        (ecm_getMAMODE1_state() == MAMODE1_STATE_IS_UNDEFINED)  ) { lastTimeMAMODE1_wasInvalid = millis(); } //ECM is unpowered (i.e. key is OFF)
+        (ecm_getMAMODE1_state() == MAMODE1_STATE_IS_UNDEFINED)  ) { lastTimeMAMODE1_wasInvalid = millis(); isKeyOff = YES; } //ECM is unpowered (i.e. key is OFF)
+    else                                                          { lastTimeMAMODE1_wasValid   = millis(); isKeyOff = NO;  }
 }
\ No newline at end of file
@@ -1,5 +1,3 @@
-//JTS2doLater: eeprom.h isn't wrapped into MVP yet
-
 #ifndef time_h
 #define time_h
 
@@ -17,7 +15,10 @@
 	void time_loopPeriod_ms_set(uint8_t period_ms);
 	uint8_t time_loopPeriod_ms_get(void);
 
+	uint16_t time_loopExecution_us_get(void);
+
 	uint32_t time_latestKeyOn_ms(void);
+	uint32_t time_keyOffDuration_ms(void); //0 while key is on
 
 	void time_handler(void);
 